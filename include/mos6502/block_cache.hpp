@@ -0,0 +1,234 @@
+/**
+ * Copyright (c) 2012 Roy van Dam <roy@8bit.cx>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#ifndef _MOS6502_BLOCK_CACHE_HPP_
+#define _MOS6502_BLOCK_CACHE_HPP_
+
+#include <inttypes.h>
+
+#include <string.h>
+
+#include <vector>
+
+namespace mos6502 {
+
+    /**
+     * Pre-decoded instruction: the specialised handler, its operand, the
+     * address of the instruction that follows it, its base cycles and
+     * whether it writes to memory.
+     */
+    template <class core_t>
+    struct microop_t
+    {
+        void        (*handler)(core_t *self);
+        uint16_t    operand;
+        uint16_t    next;
+        uint8_t     cycles;
+        bool        store;
+    };
+
+    /**
+     * Straight line run of instructions ending at a branch, jump,
+     * subroutine call or return, or an interrupt. A block never leaves
+     * the 256 byte page it starts in and remembers the host memory that
+     * backed that page, so a bank switch simply makes it miss. The link
+     * names the block that ran after it last time.
+     */
+    template <class core_t>
+    struct block_t
+    {
+        uint16_t                            address;
+        uint16_t                            end;
+        const uint8_t                      *page;
+        uint32_t                            chain;
+        uint32_t                            link;
+        std::vector<microop_t<core_t> >     microops;
+    };
+
+    /**
+     * Block cache statistics
+     */
+    struct block_stats_t
+    {
+        unsigned long   hits;
+        unsigned long   misses;
+        unsigned long   fallbacks;
+        unsigned long   invalidations;
+        unsigned long   blocks;
+    };
+
+    /**
+     * Block cache keyed by start address and backing page
+     *
+     * Blocks built at the same address from different banks are chained,
+     * the most recent first, so switching back to a bank finds its
+     * blocks again without rebuilding them. The index has a table of
+     * 256 entries for every page holding code, allocated on the first
+     * block built there, instead of one entry for each address.
+     *
+     * Most blocks are followed by the same block every time, a wait loop
+     * of two instructions by itself, so a lookup first tries the link of
+     * the block it returned before and only then walks the index.
+     */
+    template <class core_t>
+    class block_cache_t
+    {
+        private:
+            std::vector<block_t<core_t> >   _blocks;
+            std::vector<uint32_t>           _index;
+            uint16_t                        _directory[0x100];  // Table of a page plus one, or 0.
+            uint32_t                        _last;              // Block plus one, or 0.
+            block_stats_t                   _stats;
+
+            block_t<core_t> *_follow    (uint32_t index);
+
+        public:
+                            block_cache_t(void);
+
+            block_t<core_t> *lookup(uint16_t address, const uint8_t *page);
+            block_t<core_t> *insert(const block_t<core_t> &block);
+            void            invalidate(void);
+
+            void            fallback(void);
+            block_stats_t   stats(void) const;
+    };
+
+    template <class core_t>
+    block_cache_t<core_t>::block_cache_t(void)
+    {
+        memset(this->_directory, 0, sizeof this->_directory);
+        memset(&this->_stats, 0, sizeof this->_stats);
+        this->_last = 0;
+    }
+
+    /**
+     * Link the previously returned block to the given one and make that
+     * the previous one.
+     */
+    template <class core_t>
+    block_t<core_t> *
+    block_cache_t<core_t>::_follow(uint32_t index)
+    {
+        if (this->_last != 0) {
+            this->_blocks[this->_last - 1].link = index;
+        }
+
+        this->_last = index;
+        return (&this->_blocks[index - 1]);
+    }
+
+    template <class core_t>
+    block_t<core_t> *
+    block_cache_t<core_t>::lookup(uint16_t address, const uint8_t *page)
+    {
+        uint32_t table, index;
+
+        if (this->_last != 0 && (index = this->_blocks[this->_last - 1].link) != 0) {
+            block_t<core_t> &block = this->_blocks[index - 1];
+
+            if (block.address == address && block.page == page) {
+                this->_stats.hits++;
+                this->_last = index;
+                return (&block);
+            }
+        }
+
+        table = this->_directory[address >> 8];
+
+        if (table == 0) {
+            this->_stats.misses++;
+            return (NULL);
+        }
+
+        index = this->_index[(table - 1) * 0x100 + (address & 0xff)];
+
+        for (; index != 0; index = this->_blocks[index - 1].chain) {
+            if (this->_blocks[index - 1].page == page) {
+                this->_stats.hits++;
+                return (this->_follow(index));
+            }
+        }
+
+        this->_stats.misses++;
+        return (NULL);
+    }
+
+    template <class core_t>
+    block_t<core_t> *
+    block_cache_t<core_t>::insert(const block_t<core_t> &block)
+    {
+        uint16_t &table = this->_directory[block.address >> 8];
+
+        if (table == 0) {
+            this->_index.resize(this->_index.size() + 0x100, 0);
+            table = this->_index.size() / 0x100;
+        }
+
+        uint32_t &head = this->_index[(table - 1) * 0x100 + (block.address & 0xff)];
+
+        this->_blocks.push_back(block);
+        this->_blocks.back().chain = head;
+        this->_blocks.back().link = 0;
+        head = this->_blocks.size();
+        this->_stats.blocks = this->_blocks.size();
+
+        return (this->_follow(head));
+    }
+
+    template <class core_t>
+    void
+    block_cache_t<core_t>::invalidate(void)
+    {
+        if (this->_blocks.empty()) {
+            return;
+        }
+
+        this->_blocks.clear();
+        this->_index.clear();
+        memset(this->_directory, 0, sizeof this->_directory);
+        this->_last = 0;
+
+        this->_stats.invalidations++;
+        this->_stats.blocks = 0;
+    }
+
+    template <class core_t>
+    void
+    block_cache_t<core_t>::fallback(void)
+    {
+        this->_stats.fallbacks++;
+    }
+
+    template <class core_t>
+    block_stats_t
+    block_cache_t<core_t>::stats(void) const
+    {
+        return (this->_stats);
+    }
+
+} // namespace mos6502
+
+#endif // _MOS6502_BLOCK_CACHE_HPP_
\ No newline at end of file
@@ -0,0 +1,203 @@
+/**
+ * Copyright (c) 2009 Roy van Dam <roy@8bit.cx>
+ * Copyright (c) 2009 Ed Schouten <ed@80386.nl> (original mos6502 emulator in c)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#ifndef _MOS6502_CORE_ADDRESS_HPP_
+#define _MOS6502_CORE_ADDRESS_HPP_
+
+namespace mos6502 {
+
+template <class bus_t>
+uint16_t
+core_t<bus_t>::_addr_abs (void)
+{
+	return this->_progress_word();
+}
+
+template <class bus_t>
+uint16_t
+core_t<bus_t>::_addr_absx (void)
+{
+	uint16_t base;
+	base = this->_addr_abs();
+
+	uint16_t address;
+	address = base + this->_index_x;
+
+	this->_page_cross = (base ^ address) >> 8 != 0;
+	return address;
+}
+
+template <class bus_t>
+uint16_t
+core_t<bus_t>::_addr_absy (void)
+{
+	uint16_t base;
+	base = this->_addr_abs();
+
+	uint16_t address;
+	address = base + this->_index_y;
+
+	this->_page_cross = (base ^ address) >> 8 != 0;
+	return address;
+}
+
+template <class bus_t>
+uint16_t
+core_t<bus_t>::_addr_xind (void)
+{
+	return this->_read_word (this->_addr_zpgx());
+}
+
+template <class bus_t>
+uint16_t
+core_t<bus_t>::_addr_indy (void)
+{
+	uint16_t base;
+	base = this->_read_word (this->_addr_zpg());
+
+	uint16_t address;
+	address = base + this->_index_y;
+
+	this->_page_cross = (base ^ address) >> 8 != 0;
+	return address;
+}
+
+template <class bus_t>
+uint16_t
+core_t<bus_t>::_addr_zpg (void)
+{
+	return (uint16_t) this->_progress_byte ();
+}
+
+template <class bus_t>
+uint16_t
+core_t<bus_t>::_addr_zpgx (void)
+{
+	return (uint16_t) (this->_addr_zpg () + this->_index_x);
+}
+
+template <class bus_t>
+uint16_t
+core_t<bus_t>::_addr_zpgy (void)
+{
+	return (uint16_t) (this->_addr_zpg () + this->_index_y);
+}
+
+template <class bus_t>
+uint8_t
+core_t<bus_t>::_block_byte (void)
+{
+	return (uint8_t) this->_operand;
+}
+
+template <class bus_t>
+uint16_t
+core_t<bus_t>::_block_word (void)
+{
+	return this->_operand;
+}
+
+template <class bus_t>
+uint16_t
+core_t<bus_t>::_block_abs (void)
+{
+	return this->_block_word();
+}
+
+template <class bus_t>
+uint16_t
+core_t<bus_t>::_block_absx (void)
+{
+	uint16_t base;
+	base = this->_block_abs();
+
+	uint16_t address;
+	address = base + this->_index_x;
+
+	this->_page_cross = (base ^ address) >> 8 != 0;
+	return address;
+}
+
+template <class bus_t>
+uint16_t
+core_t<bus_t>::_block_absy (void)
+{
+	uint16_t base;
+	base = this->_block_abs();
+
+	uint16_t address;
+	address = base + this->_index_y;
+
+	this->_page_cross = (base ^ address) >> 8 != 0;
+	return address;
+}
+
+template <class bus_t>
+uint16_t
+core_t<bus_t>::_block_xind (void)
+{
+	return this->_read_word (this->_block_zpgx());
+}
+
+template <class bus_t>
+uint16_t
+core_t<bus_t>::_block_indy (void)
+{
+	uint16_t base;
+	base = this->_read_word (this->_block_zpg());
+
+	uint16_t address;
+	address = base + this->_index_y;
+
+	this->_page_cross = (base ^ address) >> 8 != 0;
+	return address;
+}
+
+template <class bus_t>
+uint16_t
+core_t<bus_t>::_block_zpg (void)
+{
+	return (uint16_t) this->_block_byte ();
+}
+
+template <class bus_t>
+uint16_t
+core_t<bus_t>::_block_zpgx (void)
+{
+	return (uint16_t) (this->_block_zpg () + this->_index_x);
+}
+
+template <class bus_t>
+uint16_t
+core_t<bus_t>::_block_zpgy (void)
+{
+	return (uint16_t) (this->_block_zpg () + this->_index_y);
+}
+
+} // namespace mos6502
+
+#endif // _MOS6502_CORE_ADDRESS_HPP_
\ No newline at end of file
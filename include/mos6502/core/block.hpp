@@ -0,0 +1,268 @@
+/**
+ * Copyright (c) 2012 Roy van Dam <roy@8bit.cx>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#ifndef _MOS6502_CORE_BLOCK_HPP_
+#define _MOS6502_CORE_BLOCK_HPP_
+
+#include <algorithm>
+
+#include "trace.hpp"
+#include "mos6502/opcodes.hpp"
+
+namespace mos6502 {
+
+/**
+ * Control flow leaves a basic block at branches, jumps, subroutine
+ * calls and returns, and at software interrupts.
+ */
+template <class bus_t>
+bool
+core_t<bus_t>::_ends_block(uint8_t instruction)
+{
+    switch (instruction) {
+        case 0x00:  // BRK
+        case 0x10:  // BPL
+        case 0x20:  // JSR
+        case 0x30:  // BMI
+        case 0x40:  // RTI
+        case 0x4c:  // JMP abs
+        case 0x50:  // BVC
+        case 0x60:  // RTS
+        case 0x6c:  // JMP ind
+        case 0x70:  // BVS
+        case 0x90:  // BCC
+        case 0xb0:  // BCS
+        case 0xd0:  // BNE
+        case 0xf0:  // BEQ
+            return (true);
+
+        default:
+            return (false);
+    }
+}
+
+template <class bus_t>
+typename core_t<bus_t>::_block_t *
+core_t<bus_t>::_build_block(uint16_t address)
+{
+    _block_t block;
+    uint16_t location;
+
+    block.address = address;
+    block.page = this->_code_page(address);
+    block.chain = 0;
+    block.link = 0;
+    location = address;
+
+    for (;;) {
+        uint8_t instruction;
+        instruction = this->_read_byte(location);
+
+        _handler_t handler;
+        handler = _block_dispatch[instruction];
+
+        uint8_t length;
+        length = _length[instruction];
+
+        if (handler == NULL || ((location + length - 1) ^ address) & 0xff00 ||
+            !this->_read_only(location + length - 1)) {
+            break;
+        }
+
+        microop_t<core_t> microop;
+        microop.handler = handler;
+        microop.next = location + length;
+        microop.cycles = _base_cycles[instruction];
+        microop.store = _stores[instruction];
+
+        switch (length) {
+            case 2:
+                microop.operand = this->_read_byte(location + 1);
+                break;
+
+            case 3:
+                microop.operand = this->_read_word(location + 1);
+                break;
+
+            default:
+                microop.operand = 0;
+                break;
+        }
+
+        block.microops.push_back(microop);
+        location = microop.next;
+
+        if (_ends_block(instruction) || !this->_read_only(location)) {
+            break;
+        }
+    }
+
+    block.end = location;
+
+    if (block.microops.empty()) {
+        return (NULL);
+    }
+
+    trace(TRACE_CPU, TRACE_INFO, "Block %hx-%hx: %zu instructions\n", block.address, block.end, block.microops.size());
+    return (this->_block_cache->insert(block));
+}
+
+/**
+ * Run cached blocks for up to count instructions. A store can switch
+ * the bank a block was decoded from when it hits a mapper register, the
+ * block is left right after it then. The last few instructions of a
+ * batch are interpreted: a lookup costs more than it saves on fewer
+ * than _MOS_BLOCK_MINIMUM of them, and the batches that end at every
+ * scanline event are mostly that short.
+ */
+template <class bus_t>
+long
+core_t<bus_t>::_execute_blocks(unsigned long count)
+{
+    unsigned long limit;
+    limit = count;
+
+    this->_stalled = false;
+
+    while (count > 0 && !this->_stalled) {
+        _block_t *block = NULL;
+
+        if (count >= _MOS_BLOCK_MINIMUM && this->_read_only(this->_program_counter)) {
+            block = this->_block_cache->lookup(this->_program_counter,
+                this->_code_page(this->_program_counter));
+
+            if (block == NULL) {
+                block = this->_build_block(this->_program_counter);
+            }
+        }
+
+        if (block == NULL) {
+            this->_block_cache->fallback();
+
+            if (this->step() != 0) {
+                return (-1);
+            }
+
+            count--;
+            continue;
+        }
+
+        trace(TRACE_CPU, TRACE_VERBOSE, "Executing block at %hx\n", block->address);
+
+        const microop_t<core_t> *first, *microop, *last;
+        first = &block->microops[0];
+        last = first + std::min<unsigned long>(block->microops.size(), count);
+
+        for (microop = first; microop != last && !this->_stalled; ++microop) {
+            this->_program_counter = microop->next;
+            this->_operand = microop->operand;
+            this->_cycles += microop->cycles;
+            microop->handler(this);
+
+            if (microop->store && this->_code_page(block->address) != block->page) {
+                ++microop;
+                break;
+            }
+        }
+
+        count -= microop - first;
+    }
+
+    return (limit - count);
+}
+
+#define _MOS_BLOCK_noarg(mode, instruction) \
+    &core_t::_noarg<&core_t::_ins_##instruction>
+#define _MOS_BLOCK_load(mode, instruction) \
+    &core_t::_load<&core_t::_block_##mode, &core_t::_ins_##instruction>
+#define _MOS_BLOCK_load_imm(mode, instruction) \
+    &core_t::_load_imm<&core_t::_block_byte, &core_t::_ins_##instruction>
+#define _MOS_BLOCK_store(mode, instruction) \
+    &core_t::_store<&core_t::_block_##mode, &core_t::_ins_##instruction>
+#define _MOS_BLOCK_load_store(mode, instruction) \
+    &core_t::_load_store<&core_t::_block_##mode, &core_t::_ins_##instruction>
+#define _MOS_BLOCK_load_store_acc(mode, instruction) \
+    &core_t::_load_store_acc<&core_t::_ins_##instruction>
+#define _MOS_BLOCK_load_word(mode, instruction) \
+    &core_t::_load_word<&core_t::_block_##mode, &core_t::_ins_##instruction>
+#define _MOS_BLOCK_load_word_imm(mode, instruction) \
+    &core_t::_load_word_imm<&core_t::_block_word, &core_t::_ins_##instruction>
+#define _MOS_BLOCK_nop(mode, instruction) \
+    &core_t::_nop
+#define _MOS_BLOCK_invalid(mode, instruction) \
+    NULL
+
+#define _MOS_BLOCK(code, family, mode, instruction, cycles) \
+    _MOS_BLOCK_##family(mode, instruction),
+
+template <class bus_t>
+const typename core_t<bus_t>::_handler_t core_t<bus_t>::_block_dispatch[256] = {
+    _MOS_OPCODES(_MOS_BLOCK)
+};
+
+#define _MOS_LENGTH_none    1
+#define _MOS_LENGTH_impl    1
+#define _MOS_LENGTH_acc     1
+#define _MOS_LENGTH_imm     2
+#define _MOS_LENGTH_zpg     2
+#define _MOS_LENGTH_zpgx    2
+#define _MOS_LENGTH_zpgy    2
+#define _MOS_LENGTH_xind    2
+#define _MOS_LENGTH_indy    2
+#define _MOS_LENGTH_abs     3
+#define _MOS_LENGTH_absx    3
+#define _MOS_LENGTH_absy    3
+
+#define _MOS_LENGTH(code, family, mode, instruction, cycles) \
+    _MOS_LENGTH_##mode,
+
+template <class bus_t>
+const uint8_t core_t<bus_t>::_length[256] = {
+    _MOS_OPCODES(_MOS_LENGTH)
+};
+
+#define _MOS_STORE_store              true
+#define _MOS_STORE_load_store         true
+#define _MOS_STORE_noarg              false
+#define _MOS_STORE_load               false
+#define _MOS_STORE_load_imm           false
+#define _MOS_STORE_load_store_acc     false
+#define _MOS_STORE_load_word          false
+#define _MOS_STORE_load_word_imm      false
+#define _MOS_STORE_nop                false
+#define _MOS_STORE_invalid            false
+
+#define _MOS_STORE(code, family, mode, instruction, cycles) \
+    _MOS_STORE_##family,
+
+template <class bus_t>
+const bool core_t<bus_t>::_stores[256] = {
+    _MOS_OPCODES(_MOS_STORE)
+};
+
+} // namespace mos6502
+
+#endif // _MOS6502_CORE_BLOCK_HPP_
\ No newline at end of file
@@ -0,0 +1,396 @@
+/**
+ * Copyright (c) 2009 Roy van Dam <roy@8bit.cx>
+ * Copyright (c) 2009 Ed Schouten <ed@80386.nl> (original mos6502 emulator in c)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#ifndef _MOS6502_CORE_EXECUTE_HPP_
+#define _MOS6502_CORE_EXECUTE_HPP_
+
+#include "trace.hpp"
+#include "mos6502/opcodes.hpp"
+
+namespace mos6502 {
+
+template <class bus_t>
+core_t<bus_t>::core_t(void)
+{
+    this->_program_counter = 32768;
+    this->_accumulator = 0;
+    this->_index_x = 0;
+    this->_index_y = 0;
+    this->_stack_pointer = 0;
+    this->_status_flag = 0;
+
+    this->_operand = 0;
+    this->_block_cache = NULL;
+
+    this->_cycles = 0;
+    this->_page_cross = 0;
+    this->_stalled = false;
+}
+
+template <class bus_t>
+core_t<bus_t>::~core_t(void)
+{
+    delete this->_block_cache;
+}
+
+template <class bus_t>
+void
+core_t<bus_t>::enable_block_cache(bool enable)
+{
+    delete this->_block_cache;
+    this->_block_cache = enable ? new _block_cache_t() : NULL;
+}
+
+template <class bus_t>
+bool
+core_t<bus_t>::block_cache_enabled(void) const
+{
+    return (this->_block_cache != NULL);
+}
+
+template <class bus_t>
+void
+core_t<bus_t>::invalidate_blocks(void)
+{
+    if (this->_block_cache != NULL) {
+        this->_block_cache->invalidate();
+    }
+}
+
+template <class bus_t>
+block_stats_t
+core_t<bus_t>::block_stats(void) const
+{
+    block_stats_t stats = block_stats_t();
+
+    if (this->_block_cache != NULL) {
+        stats = this->_block_cache->stats();
+    }
+
+    return (stats);
+}
+
+/**
+ * Power-up / reset sequence: load the program counter from the reset
+ * vector with interrupts disabled.
+ */
+template <class bus_t>
+void
+core_t<bus_t>::reset(void)
+{
+    this->_stack_pointer = 0xfd;
+    this->_update_flag(_MOS_RF_NOINTERRUPT, 1);
+    this->_program_counter = this->_read_word(0xfffc);
+    this->_cycles += 7;
+}
+
+template <class bus_t>
+void
+core_t<bus_t>::interrupt(uint16_t address)
+{
+    this->_interrupt(address);
+    this->_cycles += 7;
+}
+
+template <class bus_t>
+void
+core_t<bus_t>::_interrupt(uint16_t address)
+{
+    if (!(this->_status_flag | _MOS_RF_NOINTERRUPT)) {
+        trace(TRACE_INTERRUPT, TRACE_ERROR, "Interrupt overflow!\n");
+        return;
+    }
+
+    trace(TRACE_INTERRUPT, TRACE_INFO, "Interrupt through %hx\n", address);
+
+    this->_push_word(this->_program_counter);
+    this->_push_byte(this->_status_flag);
+    this->_update_flag(_MOS_RF_NOINTERRUPT, 1);
+
+    this->_program_counter = this->_read_word(address);
+}
+
+template <class bus_t>
+registers_t
+core_t<bus_t>::registers(void) const
+{
+    registers_t registers;
+
+    registers.program_counter = this->_program_counter;
+    registers.accumulator = this->_accumulator;
+    registers.index_x = this->_index_x;
+    registers.index_y = this->_index_y;
+    registers.stack_pointer = this->_stack_pointer;
+    registers.status_flag = this->_status_flag;
+
+    return (registers);
+}
+
+template <class bus_t>
+void
+core_t<bus_t>::save(state_t &state) const
+{
+    state.registers = this->registers();
+    state.cycles = this->_cycles;
+}
+
+/**
+ * Restore a saved state. Cached blocks stay valid, they are keyed by
+ * the memory backing them and not by the state of the machine.
+ */
+template <class bus_t>
+void
+core_t<bus_t>::load(const state_t &state)
+{
+    this->_program_counter = state.registers.program_counter;
+    this->_accumulator = state.registers.accumulator;
+    this->_index_x = state.registers.index_x;
+    this->_index_y = state.registers.index_y;
+    this->_stack_pointer = state.registers.stack_pointer;
+    this->_status_flag = state.registers.status_flag;
+    this->_cycles = state.cycles;
+}
+
+template <class bus_t>
+int
+core_t<bus_t>::step(void)
+{
+    uint8_t instruction;
+    instruction = this->_progress_byte();
+
+    trace(TRACE_CPU, TRACE_VERBOSE, "Executing at %hx\n", this->_program_counter);
+
+    _handler_t handler;
+    handler = _dispatch[instruction];
+
+    if (handler == NULL) {
+        trace(TRACE_CPU, TRACE_ERROR, "Got invalid instruction %hhx\n", instruction);
+        return (-1);
+    }
+
+    trace(TRACE_CPU, TRACE_VERBOSE, "%#04hhx: %s\n", instruction, _mnemonic[instruction]);
+    this->_cycles += _base_cycles[instruction];
+    handler(this);
+
+    return (0);
+}
+
+template <class bus_t>
+uint64_t
+core_t<bus_t>::cycles(void) const
+{
+    return (this->_cycles);
+}
+
+/**
+ * Halt the CPU for a number of cycles, as DMA does. The current
+ * execute() batch ends after the instruction that caused it, so events
+ * falling due during the stall are seen before the next instruction.
+ */
+template <class bus_t>
+void
+core_t<bus_t>::stall(unsigned int cycles)
+{
+    this->_cycles += cycles;
+    this->_stalled = true;
+}
+
+/**
+ * Execute whole instructions until at least count cycles have passed.
+ * Instructions run in batches no longer than the remaining budget, the
+ * last instruction may overshoot it by up to six cycles.
+ */
+template <class bus_t>
+int
+core_t<bus_t>::run_cycles(unsigned long count)
+{
+    uint64_t target;
+    target = this->_cycles + count;
+
+    while (this->_cycles < target) {
+        unsigned long batch;
+        batch = (target - this->_cycles) / _MOS_MAX_CYCLES;
+
+        if (this->execute(batch > 0 ? batch : 1) < 0) {
+            return (-1);
+        }
+    }
+
+    return (0);
+}
+
+#define _MOS_HANDLER_noarg(mode, instruction) \
+    &core_t::_noarg<&core_t::_ins_##instruction>
+#define _MOS_HANDLER_load(mode, instruction) \
+    &core_t::_load<&core_t::_addr_##mode, &core_t::_ins_##instruction>
+#define _MOS_HANDLER_load_imm(mode, instruction) \
+    &core_t::_load_imm<&core_t::_progress_byte, &core_t::_ins_##instruction>
+#define _MOS_HANDLER_store(mode, instruction) \
+    &core_t::_store<&core_t::_addr_##mode, &core_t::_ins_##instruction>
+#define _MOS_HANDLER_load_store(mode, instruction) \
+    &core_t::_load_store<&core_t::_addr_##mode, &core_t::_ins_##instruction>
+#define _MOS_HANDLER_load_store_acc(mode, instruction) \
+    &core_t::_load_store_acc<&core_t::_ins_##instruction>
+#define _MOS_HANDLER_load_word(mode, instruction) \
+    &core_t::_load_word<&core_t::_addr_##mode, &core_t::_ins_##instruction>
+#define _MOS_HANDLER_load_word_imm(mode, instruction) \
+    &core_t::_load_word_imm<&core_t::_progress_word, &core_t::_ins_##instruction>
+#define _MOS_HANDLER_nop(mode, instruction) \
+    &core_t::_nop
+#define _MOS_HANDLER_invalid(mode, instruction) \
+    NULL
+
+#define _MOS_HANDLER(code, family, mode, instruction, cycles) \
+    _MOS_HANDLER_##family(mode, instruction),
+#define _MOS_MNEMONIC(code, family, mode, instruction, cycles) \
+    #family "_" #mode "(" #instruction ")",
+#define _MOS_CYCLES(code, family, mode, instruction, cycles) \
+    cycles,
+
+template <class bus_t>
+const typename core_t<bus_t>::_handler_t core_t<bus_t>::_dispatch[256] = {
+    _MOS_OPCODES(_MOS_HANDLER)
+};
+
+template <class bus_t>
+const char * const core_t<bus_t>::_mnemonic[256] = {
+    _MOS_OPCODES(_MOS_MNEMONIC)
+};
+
+template <class bus_t>
+const uint8_t core_t<bus_t>::_base_cycles[256] = {
+    _MOS_OPCODES(_MOS_CYCLES)
+};
+
+#if defined(WITH_THREADED_DISPATCH)
+
+/**
+ * Threaded dispatch: every handler jumps straight to the handler of the
+ * next opcode through the label table instead of returning to a single
+ * dispatch site.
+ */
+#define _MOS_LABEL(code, family, mode, instruction, cycles) \
+    &&_op_##code,
+
+#define _MOS_THREADED_invalid(code, mode, instruction, cycles)                         \
+    _op_##code:                                                                         \
+        trace(TRACE_CPU, TRACE_ERROR, "Got invalid instruction %hhx\n", code);          \
+        return (-1);
+#define _MOS_THREADED_handler(code, family, mode, instruction, cycles)                 \
+    _op_##code:                                                                         \
+        trace(TRACE_CPU, TRACE_VERBOSE, "%#04hhx: %s\n", code, _mnemonic[code]);        \
+        this->_cycles += cycles;                                                        \
+        (_MOS_HANDLER_##family(mode, instruction))(this);                               \
+        _MOS_DISPATCH();
+
+#define _MOS_THREADED_noarg(code, mode, instruction, cycles) \
+    _MOS_THREADED_handler(code, noarg, mode, instruction, cycles)
+#define _MOS_THREADED_load(code, mode, instruction, cycles) \
+    _MOS_THREADED_handler(code, load, mode, instruction, cycles)
+#define _MOS_THREADED_load_imm(code, mode, instruction, cycles) \
+    _MOS_THREADED_handler(code, load_imm, mode, instruction, cycles)
+#define _MOS_THREADED_store(code, mode, instruction, cycles) \
+    _MOS_THREADED_handler(code, store, mode, instruction, cycles)
+#define _MOS_THREADED_load_store(code, mode, instruction, cycles) \
+    _MOS_THREADED_handler(code, load_store, mode, instruction, cycles)
+#define _MOS_THREADED_load_store_acc(code, mode, instruction, cycles) \
+    _MOS_THREADED_handler(code, load_store_acc, mode, instruction, cycles)
+#define _MOS_THREADED_load_word(code, mode, instruction, cycles) \
+    _MOS_THREADED_handler(code, load_word, mode, instruction, cycles)
+#define _MOS_THREADED_load_word_imm(code, mode, instruction, cycles) \
+    _MOS_THREADED_handler(code, load_word_imm, mode, instruction, cycles)
+#define _MOS_THREADED_nop(code, mode, instruction, cycles) \
+    _MOS_THREADED_handler(code, nop, mode, instruction, cycles)
+
+#define _MOS_THREADED(code, family, mode, instruction, cycles) \
+    _MOS_THREADED_##family(code, mode, instruction, cycles)
+
+#define _MOS_DISPATCH() do {                                                            \
+        if (count == 0 || this->_stalled) {                                             \
+            return (limit - count);                                                     \
+        }                                                                               \
+        count--;                                                                        \
+        instruction = this->_progress_byte();                                           \
+        trace(TRACE_CPU, TRACE_VERBOSE, "Executing at %hx\n", this->_program_counter);  \
+        goto *labels[instruction];                                                      \
+    } while (0)
+
+template <class bus_t>
+long
+core_t<bus_t>::execute(unsigned long count)
+{
+    static void * const labels[256] = {
+        _MOS_OPCODES(_MOS_LABEL)
+    };
+
+    uint8_t instruction;
+    unsigned long limit;
+
+    if (this->_block_cache != NULL) {
+        return (this->_execute_blocks(count));
+    }
+
+    this->_stalled = false;
+    limit = count;
+
+    _MOS_DISPATCH();
+    _MOS_OPCODES(_MOS_THREADED)
+
+    return (limit - count);
+}
+
+#else
+
+/**
+ * Execute up to count instructions, fewer when one of them stalls the
+ * CPU. Returns the number executed, or -1 on an invalid instruction.
+ */
+template <class bus_t>
+long
+core_t<bus_t>::execute(unsigned long count)
+{
+    if (this->_block_cache != NULL) {
+        return (this->_execute_blocks(count));
+    }
+
+    unsigned long executed;
+    this->_stalled = false;
+
+    for (executed = 0; executed < count && !this->_stalled; executed++) {
+        if (this->step() != 0) {
+            return (-1);
+        }
+    }
+
+    return (executed);
+}
+
+#endif
+
+} // namespace mos6502
+
+#endif // _MOS6502_CORE_EXECUTE_HPP_
\ No newline at end of file
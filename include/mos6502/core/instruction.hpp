@@ -25,19 +25,25 @@
 * SUCH DAMAGE.
 */
 
-#include "mos6502/emulator.hpp"
-using namespace mos6502;
+#ifndef _MOS6502_CORE_INSTRUCTION_HPP_
+#define _MOS6502_CORE_INSTRUCTION_HPP_
 
+namespace mos6502 {
+
+template <class bus_t>
 void
-emulator_t::_ins_adc(uint8_t value)  // ADC: Add memory to accumulator with carry.
+core_t<bus_t>::_ins_adc(uint8_t value)  // ADC: Add memory to accumulator with carry.
 {
     uint_least16_t _unsigned;
     int_least16_t _signed;
+    uint8_t carry;
 
-    _unsigned = this->_accumulator + value + this->_carry();
-    this->_update_carry(_unsigned);
+    carry = this->_carry();
+
+    _unsigned = this->_accumulator + value + carry;
+    _signed = (int8_t)this->_accumulator + (int8_t)value + carry;
 
-    _signed = (int8_t)this->_accumulator + (int8_t)value + this->_carry();
+    this->_update_carry(_unsigned);
     this->_update_overflow(_signed);
 
     this->_accumulator = _unsigned;
@@ -46,8 +52,9 @@ emulator_t::_ins_adc(uint8_t value)  // ADC: Add memory to accumulator with carr
     this->_update_zero(this->_accumulator);
 }
 
+template <class bus_t>
 void
-emulator_t::_ins_and(uint8_t value)  // AND: And accumulator with memory.
+core_t<bus_t>::_ins_and(uint8_t value)  // AND: And accumulator with memory.
 {
     this->_accumulator &= value;
 
@@ -55,8 +62,9 @@ emulator_t::_ins_and(uint8_t value)  // AND: And accumulator with memory.
     this->_update_zero(this->_accumulator);
 }
 
+template <class bus_t>
 uint8_t
-emulator_t::_ins_asl(uint8_t value)  // ASL: Arithmetic shift left.
+core_t<bus_t>::_ins_asl(uint8_t value)  // ASL: Arithmetic shift left.
 {
     this->_update_flag(_MOS_RF_CARRY, value & 0x80);
     value <<= 1;
@@ -67,113 +75,131 @@ emulator_t::_ins_asl(uint8_t value)  // ASL: Arithmetic shift left.
     return (value);
 }
 
+template <class bus_t>
 void
-emulator_t::_ins_bit(uint8_t value)  // BIT: Bit test in memory with accumulator.
+core_t<bus_t>::_ins_bit(uint8_t value)  // BIT: Bit test in memory with accumulator.
 {
     this->_update_flag(_MOS_RF_NEGATIVE, value & 0x80);
     this->_update_flag(_MOS_RF_OVERFLOW, value & 0x40);
     this->_update_zero(this->_accumulator & value);
 }
 
+template <class bus_t>
 void
-emulator_t::_ins_bcc(uint8_t value)  // BCC: Branch on carry clear.
+core_t<bus_t>::_ins_bcc(uint8_t value)  // BCC: Branch on carry clear.
 {
     this->_branch_on_clear(_MOS_RF_CARRY, value);
 }
 
+template <class bus_t>
 void
-emulator_t::_ins_bcs(uint8_t value)  // BCS: Branch on carry set.
+core_t<bus_t>::_ins_bcs(uint8_t value)  // BCS: Branch on carry set.
 {
     this->_branch_on_set(_MOS_RF_CARRY, value);
 }
 
+template <class bus_t>
 void
-emulator_t::_ins_beq(uint8_t value)  // BEQ: Branch on result zero.
+core_t<bus_t>::_ins_beq(uint8_t value)  // BEQ: Branch on result zero.
 {
     this->_branch_on_set(_MOS_RF_ZERO, value);
 }
 
+template <class bus_t>
 void
-emulator_t::_ins_bmi(uint8_t value)  // BMI: Branch on result minus.
+core_t<bus_t>::_ins_bmi(uint8_t value)  // BMI: Branch on result minus.
 {
     this->_branch_on_set(_MOS_RF_NEGATIVE, value);
 }
 
+template <class bus_t>
 void
-emulator_t::_ins_bne(uint8_t value)  // BNE: Branch on result not zero.
+core_t<bus_t>::_ins_bne(uint8_t value)  // BNE: Branch on result not zero.
 {
     this->_branch_on_clear(_MOS_RF_ZERO, value);
 }
 
+template <class bus_t>
 void
-emulator_t::_ins_bpl(uint8_t value)  // BPL: Branch on result plus.
+core_t<bus_t>::_ins_bpl(uint8_t value)  // BPL: Branch on result plus.
 {
     this->_branch_on_clear(_MOS_RF_NEGATIVE, value);
 }
 
+template <class bus_t>
 void
-emulator_t::_ins_brk(void)  // BRK: Force break.
+core_t<bus_t>::_ins_brk(void)  // BRK: Force break.
 {
     this->_update_flag(_MOS_RF_BREAK, 1);
-    this->interrupt(0xfffe);
+    this->_interrupt(0xfffe);
 }
 
+template <class bus_t>
 void
-emulator_t::_ins_bvc(uint8_t value)  // BVC: Branch on overflow clear.
+core_t<bus_t>::_ins_bvc(uint8_t value)  // BVC: Branch on overflow clear.
 {
     this->_branch_on_clear(_MOS_RF_OVERFLOW, value);
 }
 
+template <class bus_t>
 void
-emulator_t::_ins_bvs(uint8_t value)  // BVS: Branch on overflow set.
+core_t<bus_t>::_ins_bvs(uint8_t value)  // BVS: Branch on overflow set.
 {
     this->_branch_on_set(_MOS_RF_OVERFLOW, value);
 }
 
+template <class bus_t>
 void
-emulator_t::_ins_clc(void)  // CLV: Clear carry flag.
+core_t<bus_t>::_ins_clc(void)  // CLV: Clear carry flag.
 {
     this->_update_flag(_MOS_RF_CARRY, 0);
 }
 
+template <class bus_t>
 void
-emulator_t::_ins_cld(void)  // CLD: Clear decimal flag.
+core_t<bus_t>::_ins_cld(void)  // CLD: Clear decimal flag.
 {
     this->_update_flag(_MOS_RF_DECIMAL, 0);
 }
 
+template <class bus_t>
 void
-emulator_t::_ins_cli(void)  // CLI: Clear interrupt disable flag.
+core_t<bus_t>::_ins_cli(void)  // CLI: Clear interrupt disable flag.
 {
     this->_update_flag(_MOS_RF_NOINTERRUPT, 0);
 }
 
+template <class bus_t>
 void
-emulator_t::_ins_clv(void)  // CLV: Clear overflow flag.
+core_t<bus_t>::_ins_clv(void)  // CLV: Clear overflow flag.
 {
     this->_update_flag(_MOS_RF_OVERFLOW, 0);
 }
 
+template <class bus_t>
 void
-emulator_t::_ins_cmp(uint8_t value)  // CMP: Compare memory with accumulator.
+core_t<bus_t>::_ins_cmp(uint8_t value)  // CMP: Compare memory with accumulator.
 {
     this->_compare(this->_accumulator, value);
 }
 
+template <class bus_t>
 void
-emulator_t::_ins_cpx(uint8_t value)  // CPX: Compare memory with index X.
+core_t<bus_t>::_ins_cpx(uint8_t value)  // CPX: Compare memory with index X.
 {
     this->_compare(this->_index_x, value);
 }
 
+template <class bus_t>
 void
-emulator_t::_ins_cpy(uint8_t value)  // CPY: Compare memory with index Y.
+core_t<bus_t>::_ins_cpy(uint8_t value)  // CPY: Compare memory with index Y.
 {
     this->_compare(this->_index_y, value);
 }
 
+template <class bus_t>
 uint8_t
-emulator_t::_ins_dec(uint8_t value)  // DEC: Decrement memory by one.
+core_t<bus_t>::_ins_dec(uint8_t value)  // DEC: Decrement memory by one.
 {
     value--;
 
@@ -183,8 +209,9 @@ emulator_t::_ins_dec(uint8_t value)  // DEC: Decrement memory by one.
     return (value);
 }
 
+template <class bus_t>
 void
-emulator_t::_ins_dex(void)  // DEX: Decrement index X by one.
+core_t<bus_t>::_ins_dex(void)  // DEX: Decrement index X by one.
 {
     this->_index_x--;
 
@@ -192,8 +219,9 @@ emulator_t::_ins_dex(void)  // DEX: Decrement index X by one.
     this->_update_zero(this->_index_x);
 }
 
+template <class bus_t>
 void
-emulator_t::_ins_dey(void)  // DEY: Decrement index Y by one.
+core_t<bus_t>::_ins_dey(void)  // DEY: Decrement index Y by one.
 {
     this->_index_y--;
 
@@ -201,8 +229,9 @@ emulator_t::_ins_dey(void)  // DEY: Decrement index Y by one.
     this->_update_zero(this->_index_y);
 }
 
+template <class bus_t>
 void
-emulator_t::_ins_eor(uint8_t value)  // EOR: Exclusive or accumulator with memory.
+core_t<bus_t>::_ins_eor(uint8_t value)  // EOR: Exclusive or accumulator with memory.
 {
     this->_accumulator ^= value;
 
@@ -210,8 +239,9 @@ emulator_t::_ins_eor(uint8_t value)  // EOR: Exclusive or accumulator with memor
     this->_update_zero(this->_accumulator);
 }
 
+template <class bus_t>
 uint8_t
-emulator_t::_ins_inc(uint8_t value)  // INC: Increment memory by one.
+core_t<bus_t>::_ins_inc(uint8_t value)  // INC: Increment memory by one.
 {
     value++;
 
@@ -221,37 +251,42 @@ emulator_t::_ins_inc(uint8_t value)  // INC: Increment memory by one.
     return (value);
 }
 
+template <class bus_t>
 void
-emulator_t::_ins_inx(void)  // INX: Increment index X by one.
+core_t<bus_t>::_ins_inx(void)  // INX: Increment index X by one.
 {
     this->_index_x++;
     this->_update_negative(this->_index_x);
     this->_update_zero(this->_index_x);
 }
 
+template <class bus_t>
 void
-emulator_t::_ins_iny(void)  // INY: Increment index Y by one.
+core_t<bus_t>::_ins_iny(void)  // INY: Increment index Y by one.
 {
     this->_index_y++;
     this->_update_negative(this->_index_y);
     this->_update_zero(this->_index_y);
 }
 
+template <class bus_t>
 void
-emulator_t::_ins_jmp(uint16_t address)  // JMP: Jump to new location.
+core_t<bus_t>::_ins_jmp(uint16_t address)  // JMP: Jump to new location.
 {
     this->_program_counter = address;
 }
 
+template <class bus_t>
 void
-emulator_t::_ins_jsr(uint16_t address)  // JSR: Jump to new location saving return address.
+core_t<bus_t>::_ins_jsr(uint16_t address)  // JSR: Jump to new location saving return address.
 {
     this->_push_word(this->_program_counter - 1);
     this->_program_counter = address;
 }
 
+template <class bus_t>
 void
-emulator_t::_ins_lda(uint8_t value)  // LDA: Load accumulator with memory.
+core_t<bus_t>::_ins_lda(uint8_t value)  // LDA: Load accumulator with memory.
 {
     this->_accumulator = value;
 
@@ -259,8 +294,9 @@ emulator_t::_ins_lda(uint8_t value)  // LDA: Load accumulator with memory.
     this->_update_zero(this->_accumulator);
 }
 
+template <class bus_t>
 void
-emulator_t::_ins_ldx(uint8_t value)  // LDX: Load index X with memory.
+core_t<bus_t>::_ins_ldx(uint8_t value)  // LDX: Load index X with memory.
 {
     this->_index_x = value;
 
@@ -268,8 +304,9 @@ emulator_t::_ins_ldx(uint8_t value)  // LDX: Load index X with memory.
     this->_update_zero(this->_index_x);
 }
 
+template <class bus_t>
 void
-emulator_t::_ins_ldy(uint8_t value)  // LDY: Load index Y with memory.
+core_t<bus_t>::_ins_ldy(uint8_t value)  // LDY: Load index Y with memory.
 {
     this->_index_y = value;
 
@@ -277,8 +314,9 @@ emulator_t::_ins_ldy(uint8_t value)  // LDY: Load index Y with memory.
     this->_update_zero(this->_index_y);
 }
 
+template <class bus_t>
 uint8_t
-emulator_t::_ins_lsr(uint8_t value)  // LSR: Shift one bit right.
+core_t<bus_t>::_ins_lsr(uint8_t value)  // LSR: Shift one bit right.
 {
     this->_update_flag(_MOS_RF_CARRY, value & 0x01);
     value >>= 1;
@@ -288,8 +326,9 @@ emulator_t::_ins_lsr(uint8_t value)  // LSR: Shift one bit right.
     return (value);
 }
 
+template <class bus_t>
 void
-emulator_t::_ins_ora(uint8_t value)  // ORA: Or accumulator with memory.
+core_t<bus_t>::_ins_ora(uint8_t value)  // ORA: Or accumulator with memory.
 {
     this->_accumulator |= value;
 
@@ -297,32 +336,40 @@ emulator_t::_ins_ora(uint8_t value)  // ORA: Or accumulator with memory.
     this->_update_zero(this->_accumulator);
 }
 
+template <class bus_t>
 void
-emulator_t::_ins_pha(void)  // PHA: Push accumulator on stack.
+core_t<bus_t>::_ins_pha(void)  // PHA: Push accumulator on stack.
 {
     this->_push_byte(this->_accumulator);
 }
 
+template <class bus_t>
 void
-emulator_t::_ins_php(void)  // PHP: Push processor status on stack.
+core_t<bus_t>::_ins_php(void)  // PHP: Push processor status on stack.
 {
-    this->_push_byte(this->_status_flag);
+    this->_push_byte(this->_status_flag | _MOS_RF_BREAK | 0x20);
 }
 
+template <class bus_t>
 void
-emulator_t::_ins_pla(void)  // PLA: Pull accumulator from stack.
+core_t<bus_t>::_ins_pla(void)  // PLA: Pull accumulator from stack.
 {
     this->_accumulator = this->_pop_byte();
+
+    this->_update_negative(this->_accumulator);
+    this->_update_zero(this->_accumulator);
 }
 
+template <class bus_t>
 void
-emulator_t::_ins_plp(void)  // PLP: Pull processor status from stack.
+core_t<bus_t>::_ins_plp(void)  // PLP: Pull processor status from stack.
 {
     this->_status_flag = this->_pop_byte();
 }
 
+template <class bus_t>
 uint8_t
-emulator_t::_ins_rol(uint8_t value)  // ROL: Rotate one bit left.
+core_t<bus_t>::_ins_rol(uint8_t value)  // ROL: Rotate one bit left.
 {
     uint8_t result;
     result = value << 1;
@@ -338,8 +385,9 @@ emulator_t::_ins_rol(uint8_t value)  // ROL: Rotate one bit left.
     return (result);
 }
 
+template <class bus_t>
 uint8_t
-emulator_t::_ins_ror(uint8_t value)  // ROL: Rotate one bit right.
+core_t<bus_t>::_ins_ror(uint8_t value)  // ROL: Rotate one bit right.
 {
     uint8_t result;
     result = value >> 1;
@@ -355,75 +403,74 @@ emulator_t::_ins_ror(uint8_t value)  // ROL: Rotate one bit right.
     return (result);
 }
 
+template <class bus_t>
 void
-emulator_t::_ins_rti(void)  // ROL: Return from interrupt.
+core_t<bus_t>::_ins_rti(void)  // ROL: Return from interrupt.
 {
     this->_status_flag = this->_pop_byte();
     this->_program_counter = this->_pop_word();
 }
 
+template <class bus_t>
 void
-emulator_t::_ins_rts(void)  // ROL: Return from subroutine.
+core_t<bus_t>::_ins_rts(void)  // ROL: Return from subroutine.
 {
     this->_program_counter = this->_pop_word() + 1;
 }
 
+template <class bus_t>
 void
-emulator_t::_ins_sbc(uint8_t value)  // SBC: Subtract memory to accumulator with borrow.
+core_t<bus_t>::_ins_sbc(uint8_t value)  // SBC: Subtract memory to accumulator with borrow.
 {
-    uint_least16_t _unsigned;
-    int_least16_t _signed;
-
-    _unsigned = this->_accumulator - value - this->_carry();
-    this->_update_carry(_unsigned);
-
-    _signed = (int8_t)this->_accumulator - (int8_t)value - this->_carry();
-    this->_update_overflow(_signed);
-
-    this->_accumulator = _unsigned;
-
-    this->_update_negative(this->_accumulator);
-    this->_update_zero(this->_accumulator);
+    /* The carry is an inverted borrow, A - M - !C equals A + ~M + C. */
+    this->_ins_adc(~value);
 }
 
+template <class bus_t>
 void
-emulator_t::_ins_sec(void)  // SEC: Set carry flag.
+core_t<bus_t>::_ins_sec(void)  // SEC: Set carry flag.
 {
     this->_update_flag(_MOS_RF_CARRY, 1);
 }
 
+template <class bus_t>
 void
-emulator_t::_ins_sed(void)  // SED: Set decimal flag.
+core_t<bus_t>::_ins_sed(void)  // SED: Set decimal flag.
 {
     this->_update_flag(_MOS_RF_DECIMAL, 1);
 }
 
+template <class bus_t>
 void
-emulator_t::_ins_sei(void)  // SEI: Set interrupt disable flag.
+core_t<bus_t>::_ins_sei(void)  // SEI: Set interrupt disable flag.
 {
     this->_update_flag(_MOS_RF_NOINTERRUPT, 1);
 }
 
+template <class bus_t>
 uint8_t
-emulator_t::_ins_sta(void)  // STA: Store accumulator in memory.
+core_t<bus_t>::_ins_sta(void)  // STA: Store accumulator in memory.
 {
     return (this->_accumulator);
 }
 
+template <class bus_t>
 uint8_t
-emulator_t::_ins_stx(void)  // STX: Store index X in memory.
+core_t<bus_t>::_ins_stx(void)  // STX: Store index X in memory.
 {
     return (this->_index_x);
 }
 
+template <class bus_t>
 uint8_t
-emulator_t::_ins_sty(void)  // STY: Store index Y in memory.
+core_t<bus_t>::_ins_sty(void)  // STY: Store index Y in memory.
 {
     return (this->_index_y);
 }
 
+template <class bus_t>
 void
-emulator_t::_ins_tax(void)  // TAX: Transfer accumulator to index X.
+core_t<bus_t>::_ins_tax(void)  // TAX: Transfer accumulator to index X.
 {
     this->_index_x = this->_accumulator;
 
@@ -431,8 +478,9 @@ emulator_t::_ins_tax(void)  // TAX: Transfer accumulator to index X.
     this->_update_zero(this->_index_x);
 }
 
+template <class bus_t>
 void
-emulator_t::_ins_tay(void)  // TAY: Transfer accumulator to index Y.
+core_t<bus_t>::_ins_tay(void)  // TAY: Transfer accumulator to index Y.
 {
     this->_index_y = this->_accumulator;
 
@@ -440,8 +488,9 @@ emulator_t::_ins_tay(void)  // TAY: Transfer accumulator to index Y.
     this->_update_zero(this->_index_y);
 }
 
+template <class bus_t>
 void
-emulator_t::_ins_tsx(void)  // TSX: Transfer stack pointer to index X.
+core_t<bus_t>::_ins_tsx(void)  // TSX: Transfer stack pointer to index X.
 {
     this->_index_x = this->_stack_pointer;
 
@@ -449,8 +498,9 @@ emulator_t::_ins_tsx(void)  // TSX: Transfer stack pointer to index X.
     this->_update_zero(this->_index_x);
 }
 
+template <class bus_t>
 void
-emulator_t::_ins_txa(void)  // TXA: Transfer index X to accumulator.
+core_t<bus_t>::_ins_txa(void)  // TXA: Transfer index X to accumulator.
 {
     this->_accumulator = this->_index_x;
 
@@ -458,20 +508,23 @@ emulator_t::_ins_txa(void)  // TXA: Transfer index X to accumulator.
     this->_update_zero(this->_accumulator);
 }
 
+template <class bus_t>
 void
-emulator_t::_ins_txs(void)  // TXS: Transfer index X to stack pointer.
+core_t<bus_t>::_ins_txs(void)  // TXS: Transfer index X to stack pointer.
 {
     this->_stack_pointer = this->_index_x;
-
-    this->_update_negative(this->_stack_pointer);
-    this->_update_zero(this->_stack_pointer);
 }
 
+template <class bus_t>
 void
-emulator_t::_ins_tya(void)  // TYA: Transfer index Y to accumulator.
+core_t<bus_t>::_ins_tya(void)  // TYA: Transfer index Y to accumulator.
 {
     this->_accumulator = this->_index_y;
 
     this->_update_negative(this->_accumulator);
     this->_update_zero(this->_accumulator);
-}
\ No newline at end of file
+}
+
+} // namespace mos6502
+
+#endif // _MOS6502_CORE_INSTRUCTION_HPP_
\ No newline at end of file
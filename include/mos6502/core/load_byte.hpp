@@ -25,74 +25,50 @@
  * SUCH DAMAGE.
  */
 
-#include "debug.hpp"
-#include "mos6502/emulator.hpp"
-using namespace mos6502;
+#ifndef _MOS6502_CORE_LOAD_BYTE_HPP_
+#define _MOS6502_CORE_LOAD_BYTE_HPP_
 
-void
-emulator_t::_load(_ins_load_byte_t instruction, uint16_t address)
-{
-    uint8_t value;
-    value = this->_read_byte(address);
-
-    debug("LOAD: %hx: %hhu\n", address, value);
-    (this->*instruction)(value);
-}
-
-void
-emulator_t::_load_abs(_ins_load_byte_t instruction)
-{
-    this->_load(instruction, this->_addr_abs());
-}
+#include "trace.hpp"
 
-void
-emulator_t::_load_absx(_ins_load_byte_t instruction)
-{
-    this->_load(instruction, this->_addr_absx());
-}
+namespace mos6502 {
 
+template <class bus_t>
+template <typename core_t<bus_t>::_addr_t address, typename core_t<bus_t>::_ins_load_byte_t instruction>
 void
-emulator_t::_load_absy(_ins_load_byte_t instruction)
+core_t<bus_t>::_load(core_t *self)
 {
-    this->_load(instruction, this->_addr_absy());
-}
+    uint16_t location;
+    location = (self->*address)();
 
-void
-emulator_t::_load_imm(_ins_load_byte_t instruction)
-{
     uint8_t value;
-    value = this->_progress_byte();
+    value = self->_read_byte(location);
 
-    debug("LOAD: imm: %u\n", value);
-    (this->*instruction)(value);
-}
+    /*
+     * Indexed reads take an extra cycle when the effective address
+     * crosses a page, stores and read-modify-writes always take it.
+     */
+    if (address == &core_t::_addr_absx || address == &core_t::_addr_absy ||
+        address == &core_t::_addr_indy || address == &core_t::_block_absx ||
+        address == &core_t::_block_absy || address == &core_t::_block_indy) {
+        self->_cycles += self->_page_cross;
+    }
 
-void
-emulator_t::_load_xind(_ins_load_byte_t instruction)
-{
-    this->_load(instruction, this->_addr_xind());
+    trace(TRACE_MEMORY, TRACE_VERBOSE, "LOAD: %hx: %hhu\n", location, value);
+    (self->*instruction)(value);
 }
 
+template <class bus_t>
+template <typename core_t<bus_t>::_operand_byte_t operand, typename core_t<bus_t>::_ins_load_byte_t instruction>
 void
-emulator_t::_load_indy(_ins_load_byte_t instruction)
+core_t<bus_t>::_load_imm(core_t *self)
 {
-    this->_load(instruction, this->_addr_indy());
-}
+    uint8_t value;
+    value = (self->*operand)();
 
-void
-emulator_t::_load_zpg(_ins_load_byte_t instruction)
-{
-    this->_load(instruction, this->_addr_zpg());
+    trace(TRACE_MEMORY, TRACE_VERBOSE, "LOAD: imm: %u\n", value);
+    (self->*instruction)(value);
 }
 
-void
-emulator_t::_load_zpgx(_ins_load_byte_t instruction)
-{
-    this->_load(instruction, this->_addr_zpgx());
-}
+} // namespace mos6502
 
-void
-emulator_t::_load_zpgy(_ins_load_byte_t instruction)
-{
-    this->_load(instruction, this->_addr_zpgy());
-}
\ No newline at end of file
+#endif // _MOS6502_CORE_LOAD_BYTE_HPP_
\ No newline at end of file
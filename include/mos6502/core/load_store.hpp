@@ -25,53 +25,39 @@
  * SUCH DAMAGE.
  */
 
-#include "mos6502/emulator.hpp"
-using namespace mos6502;
+#ifndef _MOS6502_CORE_LOAD_STORE_HPP_
+#define _MOS6502_CORE_LOAD_STORE_HPP_
 
-uint16_t
-emulator_t::_addr_abs (void)
-{
-	return this->_progress_word();
-}
+#include "trace.hpp"
 
-uint16_t
-emulator_t::_addr_absx (void)
-{
-	return this->_addr_abs() + this->_index_x;
-}
+namespace mos6502 {
 
-uint16_t
-emulator_t::_addr_absy (void)
+template <class bus_t>
+template <typename core_t<bus_t>::_addr_t address, typename core_t<bus_t>::_ins_load_store_t instruction>
+void
+core_t<bus_t>::_load_store(core_t *self)
 {
-	return this->_addr_abs() + this->_index_y;
-}
+    uint16_t location;
+    location = (self->*address)();
 
-uint16_t
-emulator_t::_addr_xind (void)
-{
-	return this->_read_word (this->_addr_zpgx());
-}
+    uint8_t value;
+    value = self->_read_byte(location);
 
-uint16_t
-emulator_t::_addr_indy (void)
-{
-	return this->_read_word (this->_addr_zpg()) + this->_index_y;
-}
+    uint8_t result;
+    result = (self->*instruction)(value);
 
-uint16_t
-emulator_t::_addr_zpg (void)
-{
-	return (uint16_t) this->_progress_byte ();
+    trace(TRACE_MEMORY, TRACE_VERBOSE, "LOAD_STORE: %hx: %hhu -> %hhu\n", location, value, result);
+    self->_write_byte(location, result);
 }
 
-uint16_t
-emulator_t::_addr_zpgx (void)
+template <class bus_t>
+template <typename core_t<bus_t>::_ins_load_store_t instruction>
+void
+core_t<bus_t>::_load_store_acc(core_t *self)
 {
-	return (uint16_t) (this->_addr_zpg () + this->_index_x);
+    self->_accumulator = (self->*instruction)(self->_accumulator);
 }
 
-uint16_t
-emulator_t::_addr_zpgy (void)
-{
-	return (uint16_t) (this->_addr_zpg () + this->_index_y);
-}
\ No newline at end of file
+} // namespace mos6502
+
+#endif // _MOS6502_CORE_LOAD_STORE_HPP_
\ No newline at end of file
@@ -25,49 +25,40 @@
  * SUCH DAMAGE.
  */
 
-#include "debug.hpp"
-#include "mos6502/emulator.hpp"
-using namespace mos6502;
+#ifndef _MOS6502_CORE_LOAD_WORD_HPP_
+#define _MOS6502_CORE_LOAD_WORD_HPP_
 
-void
-emulator_t::_load_store(_ins_load_store_t instruction, uint16_t address)
-{
-    uint8_t value;
-    value = this->_read_byte(address);
+#include "trace.hpp"
 
-    debug("LOAD_STORE: %hx: %hhu -> ", address, value);
-    value = (this->*instruction)(value);
-
-    debug("%hhu\n", value);
-    this->_write_byte(address, value);
-}
+namespace mos6502 {
 
+template <class bus_t>
+template <typename core_t<bus_t>::_addr_t address, typename core_t<bus_t>::_ins_load_word_t instruction>
 void
-emulator_t::_load_store_abs(_ins_load_store_t instruction)
+core_t<bus_t>::_load_word(core_t *self)
 {
-    this->_load_store(instruction, this->_addr_abs());
-}
+    uint16_t location;
+    location = (self->*address)();
 
-void
-emulator_t::_load_store_absx(_ins_load_store_t instruction)
-{
-    this->_load_store(instruction, this->_addr_absx());
-}
+    uint16_t value;
+    value = self->_read_word(location);
 
-void
-emulator_t::_load_store_acc(_ins_load_store_t instruction)
-{
-    this->_accumulator = (this->*instruction)(this->_accumulator);
+    trace(TRACE_MEMORY, TRACE_VERBOSE, "LOAD16: %hx: %hu\n", location, value);
+    (self->*instruction)(value);
 }
 
+template <class bus_t>
+template <typename core_t<bus_t>::_operand_word_t operand, typename core_t<bus_t>::_ins_load_word_t instruction>
 void
-emulator_t::_load_store_zpg(_ins_load_store_t instruction)
+core_t<bus_t>::_load_word_imm(core_t *self)
 {
-    this->_load_store(instruction, this->_addr_zpg());
+    uint16_t value;
+    value = (self->*operand)();
+
+    trace(TRACE_MEMORY, TRACE_VERBOSE, "LOAD16: imm: %hu\n", value);
+    (self->*instruction)(value);
 }
 
-void
-emulator_t::_load_store_zpgx(_ins_load_store_t instruction)
-{
-    this->_load_store(instruction, this->_addr_zpgx());
-}
\ No newline at end of file
+} // namespace mos6502
+
+#endif // _MOS6502_CORE_LOAD_WORD_HPP_
\ No newline at end of file
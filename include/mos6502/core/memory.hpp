@@ -25,80 +25,103 @@
  * SUCH DAMAGE.
  */
 
-#include "debug.hpp"
-#include "mos6502/emulator.hpp"
-using namespace mos6502;
+#ifndef _MOS6502_CORE_MEMORY_HPP_
+#define _MOS6502_CORE_MEMORY_HPP_
 
+#include "trace.hpp"
+
+namespace mos6502 {
+
+template <class bus_t>
 uint8_t
-emulator_t::_read_byte(uint16_t address)
+core_t<bus_t>::_read_byte(uint16_t address)
 {
-    return (this->read_byte(address));
+    return (static_cast<bus_t *>(this)->read_byte(address));
 }
 
+template <class bus_t>
 uint16_t
-emulator_t::_read_word(uint16_t address)
+core_t<bus_t>::_read_word(uint16_t address)
 {
     return (this->_read_byte(address) | (uint16_t) this->_read_byte(address + 1) << 8);
 }
 
+template <class bus_t>
 void
-emulator_t::_write_byte(uint16_t address, uint8_t value)
+core_t<bus_t>::_write_byte(uint16_t address, uint8_t value)
 {
-    this->write_byte(address, value);
+    static_cast<bus_t *>(this)->write_byte(address, value);
 }
 
-void
-emulator_t::_push_byte(uint8_t value)
+template <class bus_t>
+bool
+core_t<bus_t>::_read_only(uint16_t address)
 {
-    if ((this->_stack_pointer + 0x100) == 0x1FF) {
-        debug("Stack overflow!");
-        return;
-    }
+    return (static_cast<bus_t *>(this)->read_only(address));
+}
 
-    this->_stack_pointer--;
+template <class bus_t>
+const uint8_t *
+core_t<bus_t>::_code_page(uint16_t address)
+{
+    return (static_cast<bus_t *>(this)->code_page(address));
+}
 
+template <class bus_t>
+void
+core_t<bus_t>::_push_byte(uint8_t value)
+{
     uint16_t address;
     address = (uint16_t)this->_stack_pointer + 0x100;
 
-    debug("PUSH_BYTE [0x%x] = 0x%x\n", address, value);
+    if (this->_stack_pointer == 0x00) {
+        trace(TRACE_STACK, TRACE_ERROR, "Stack overflow!\n");
+    }
+
+    this->_stack_pointer--;
+
+    trace(TRACE_STACK, TRACE_VERBOSE, "PUSH_BYTE [0x%x] = 0x%x\n", address, value);
     this->_write_byte(address, value);
 }
 
+template <class bus_t>
 void
-emulator_t::_push_word(uint16_t value)
+core_t<bus_t>::_push_word(uint16_t value)
 {
     this->_push_byte(value >> 8);
     this->_push_byte(value);
 }
 
+template <class bus_t>
 uint8_t
-emulator_t::_pop_byte(void)
+core_t<bus_t>::_pop_byte(void)
 {
-    if ((this->_stack_pointer + 0x100) == 0x100) {
-        debug("Stack underflow!");
-        return 0;
+    if (this->_stack_pointer == 0xff) {
+        trace(TRACE_STACK, TRACE_ERROR, "Stack underflow!\n");
     }
 
+    this->_stack_pointer++;
+
     uint16_t address;
     address = (uint16_t)this->_stack_pointer + 0x100;
 
-    this->_stack_pointer++;
-
     uint8_t value;
     value = this->_read_byte(address);
 
-    debug("POP_BYTE [0x%x] = 0x%x\n", address, value);
+    trace(TRACE_STACK, TRACE_VERBOSE, "POP_BYTE [0x%x] = 0x%x\n", address, value);
     return (value);
 }
 
+template <class bus_t>
 uint16_t
-emulator_t::_pop_word(void)
+core_t<bus_t>::_pop_word(void)
 {
     return (this->_pop_byte() | (uint16_t) this->_pop_byte() << 8);
 }
 
+template <class bus_t>
 uint8_t
-emulator_t::_progress_byte(void)
+core_t<bus_t>::_progress_byte(void)
 {
     uint8_t value;
     value = this->_read_byte(this->_program_counter);
@@ -107,12 +130,17 @@ emulator_t::_progress_byte(void)
     return (value);
 }
 
+template <class bus_t>
 uint16_t
-emulator_t::_progress_word(void)
+core_t<bus_t>::_progress_word(void)
 {
     uint16_t value;
     value = this->_read_word(this->_program_counter);
 
     this->_program_counter += 2;
     return (value);
-}
\ No newline at end of file
+}
+
+} // namespace mos6502
+
+#endif // _MOS6502_CORE_MEMORY_HPP_
\ No newline at end of file
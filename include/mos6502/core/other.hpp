@@ -25,34 +25,50 @@
 * SUCH DAMAGE.
 */
 
-#include "debug.hpp"
-#include "mos6502/emulator.hpp"
-using namespace mos6502;
+#ifndef _MOS6502_CORE_OTHER_HPP_
+#define _MOS6502_CORE_OTHER_HPP_
 
+#include "trace.hpp"
+
+namespace mos6502 {
+
+template <class bus_t>
 void
-emulator_t::_branch_on_clear(uint8_t flag, uint8_t value)
+core_t<bus_t>::_branch_on_clear(uint8_t flag, uint8_t value)
 {
     if (!(this->_status_flag & flag)) {
-        debug("Taking branch\n");
-        this->_program_counter += (int8_t)value;
+        trace(TRACE_CPU, TRACE_VERBOSE, "Taking branch\n");
+
+        uint16_t target;
+        target = this->_program_counter + (int8_t)value;
+
+        this->_cycles += ((this->_program_counter ^ target) >> 8) ? 2 : 1;
+        this->_program_counter = target;
     } else {
-        debug("Skipping branch\n");
+        trace(TRACE_CPU, TRACE_VERBOSE, "Skipping branch\n");
     }
 }
 
+template <class bus_t>
 void
-emulator_t::_branch_on_set(uint8_t flag, uint8_t value)
+core_t<bus_t>::_branch_on_set(uint8_t flag, uint8_t value)
 {
     if (this->_status_flag & flag) {
-        debug("Taking branch\n");
-        this->_program_counter += (int8_t)value;
+        trace(TRACE_CPU, TRACE_VERBOSE, "Taking branch\n");
+
+        uint16_t target;
+        target = this->_program_counter + (int8_t)value;
+
+        this->_cycles += ((this->_program_counter ^ target) >> 8) ? 2 : 1;
+        this->_program_counter = target;
     } else {
-        debug("Skipping branch\n");
+        trace(TRACE_CPU, TRACE_VERBOSE, "Skipping branch\n");
     }
 }
 
+template <class bus_t>
 void
-emulator_t::_update_flag(uint8_t flag, uint8_t mode)
+core_t<bus_t>::_update_flag(uint8_t flag, uint8_t mode)
 {
     if (mode) {
         this->_status_flag |= (flag);
@@ -61,46 +77,64 @@ emulator_t::_update_flag(uint8_t flag, uint8_t mode)
     }
 }
 
+template <class bus_t>
 void
-emulator_t::_update_carry(uint_least16_t value)
+core_t<bus_t>::_update_carry(uint_least16_t value)
 {
     this->_update_flag(_MOS_RF_CARRY, value > UINT8_MAX);
 }
 
+template <class bus_t>
 void
-emulator_t::_update_overflow(int_least16_t value)
+core_t<bus_t>::_update_overflow(int_least16_t value)
 {
     this->_update_flag(_MOS_RF_OVERFLOW, (value < INT8_MIN) || (value > INT8_MAX));
 }
 
+template <class bus_t>
 void
-emulator_t::_update_negative(uint8_t value)
+core_t<bus_t>::_update_negative(uint8_t value)
 {
     this->_update_flag(_MOS_RF_NEGATIVE, (int8_t)(value) < 0);
 }
 
+template <class bus_t>
 void
-emulator_t::_update_zero(uint8_t value)
+core_t<bus_t>::_update_zero(uint8_t value)
 {
     this->_update_flag(_MOS_RF_ZERO, (uint8_t)(value) == 0);
 }
 
+template <class bus_t>
+template <typename core_t<bus_t>::_ins_noarg_t instruction>
 void
-emulator_t::_noarg(_ins_noarg_t instruction)
+core_t<bus_t>::_noarg(core_t *self)
 {
-    (this->*instruction)();
+    (self->*instruction)();
 }
 
+template <class bus_t>
 void
-emulator_t::_compare(uint8_t value_a, uint8_t value_b)
+core_t<bus_t>::_nop(core_t *self)
+{
+}
+
+template <class bus_t>
+void
+core_t<bus_t>::_compare(uint8_t value_a, uint8_t value_b)
 {
     this->_update_flag(_MOS_RF_CARRY, (value_a >= value_b));
-    this->_update_flag(_MOS_RF_NEGATIVE, (value_a < value_b));
+    this->_update_negative(value_a - value_b);
     this->_update_flag(_MOS_RF_ZERO, (value_a == value_b));
 }
 
+template <class bus_t>
 uint8_t
-emulator_t::_carry(void)
+core_t<bus_t>::_carry(void)
 {
     return ((this->_status_flag & _MOS_RF_CARRY) ? 1 : 0);
-}
\ No newline at end of file
+}
+
+} // namespace mos6502
+
+#endif // _MOS6502_CORE_OTHER_HPP_
\ No newline at end of file
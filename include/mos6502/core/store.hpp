@@ -25,32 +25,28 @@
  * SUCH DAMAGE.
  */
 
-#include "debug.hpp"
-#include "mos6502/emulator.hpp"
-using namespace mos6502;
+#ifndef _MOS6502_CORE_STORE_HPP_
+#define _MOS6502_CORE_STORE_HPP_
 
-void
-emulator_t::_load_word(_ins_load_word_t instruction, uint16_t address)
-{
-    uint16_t value;
-    value = this->_read_word(address);
+#include "trace.hpp"
 
-    debug("LOAD16: %hx: %hu\n", address, value);
-    (this->*instruction)(value);
-}
+namespace mos6502 {
 
+template <class bus_t>
+template <typename core_t<bus_t>::_addr_t address, typename core_t<bus_t>::_ins_store_t instruction>
 void
-emulator_t::_load_word_imm(_ins_load_word_t instruction)
+core_t<bus_t>::_store(core_t *self)
 {
-    uint16_t value;
-    value = this->_progress_word();
+    uint16_t location;
+    location = (self->*address)();
+
+    uint8_t value;
+    value = (self->*instruction)();
 
-    debug("LOAD16: imm: %hu\n", value);
-    (this->*instruction)(value);
+    trace(TRACE_MEMORY, TRACE_VERBOSE, "STORE: %hx: %hhu\n", location, value);
+    self->_write_byte(location, value);
 }
 
-void
-emulator_t::_load_word_abs(_ins_load_word_t instruction)
-{
-    this->_load_word(instruction, this->_addr_abs());
-}
\ No newline at end of file
+} // namespace mos6502
+
+#endif // _MOS6502_CORE_STORE_HPP_
\ No newline at end of file
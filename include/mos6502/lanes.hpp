@@ -0,0 +1,308 @@
+/**
+ * Copyright (c) 2009 Roy van Dam <roy@8bit.cx>
+ * Copyright (c) 2009 Ed Schouten <ed@80386.nl> (original mos6502 emulator in c)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#ifndef _MOS6502_LANES_HPP_
+#define _MOS6502_LANES_HPP_
+
+#include <stddef.h>
+#include <inttypes.h>
+
+#include <vector>
+
+#include "mos6502/core.hpp"
+
+namespace mos6502 {
+
+    /**
+     * Lanes per SIMD block: one 128 bit vector of 8 bit registers.
+     */
+    #define _MOS_LANE_WIDTH     16
+
+    typedef uint8_t     lane8_t  __attribute__((vector_size(_MOS_LANE_WIDTH)));
+    typedef uint16_t    lane16_t __attribute__((vector_size(_MOS_LANE_WIDTH * 2)));
+
+    /**
+     * Lockstep statistics. A step executes one instruction for the
+     * lanes at the lowest program counter; it diverged when not every
+     * running lane was among them.
+     */
+    struct lanes_stats_t
+    {
+        unsigned long   steps;
+        unsigned long   vector_steps;
+        unsigned long   diverged_steps;
+        uint64_t        vector_instructions;    // Lane instructions run by the vector kernels.
+        uint64_t        scalar_instructions;    // Lane instructions run one lane at a time.
+        double          divergence;             // Diverged steps over all steps.
+    };
+
+    /**
+     * Structure-of-arrays lockstep engine
+     *
+     * Runs many copies of one program, each lane with its own registers
+     * and RAM, on a shared read-only ROM at the top of the address space.
+     * Registers are kept one array per register and RAM one row of lanes
+     * per address, so the same instruction on every lane reads and writes
+     * whole vectors. While the lanes agree on the program counter and the
+     * code comes from ROM, an instruction runs once per block of lanes;
+     * lanes that took different paths run on the scalar core instead,
+     * lowest program counter first, which brings them back together at
+     * the point where their paths join. Addresses that are neither RAM
+     * nor ROM read as zero and ignore writes.
+     */
+    class lanes_t
+    {
+            struct block_t
+            {
+                size_t      base;
+                lane8_t     mask;
+                lane8_t     accumulator;
+                lane8_t     index_x;
+                lane8_t     index_y;
+                lane8_t     stack_pointer;
+                lane8_t     status_flag;
+                lane8_t     extra;          // Page crossing and branch cycles.
+                lane16_t    program_counter;
+            };
+
+            typedef void (*_kernel_t)(lanes_t *self, block_t &block, uint16_t operand);
+            typedef void (*_ins_load_t)(lanes_t *self, block_t &block, lane8_t value);
+            typedef lane8_t (*_ins_load_store_t)(lanes_t *self, block_t &block, lane8_t value);
+            typedef lane8_t (*_ins_store_t)(lanes_t *self, block_t &block);
+            typedef void (*_ins_noarg_t)(lanes_t *self, block_t &block);
+            typedef void (*_ins_load_word_t)(lanes_t *self, block_t &block, const lane16_t &value);
+
+            enum _mode_t
+            {
+                _mode_imm,
+                _mode_zpg,
+                _mode_zpgx,
+                _mode_zpgy,
+                _mode_abs,
+                _mode_absx,
+                _mode_absy,
+                _mode_xind,
+                _mode_indy
+            };
+
+            size_t                  _lanes;
+            size_t                  _stride;
+            size_t                  _ram_size;
+            const uint8_t          *_rom;
+            uint32_t                _rom_base;
+
+            std::vector<uint8_t>    _accumulator;
+            std::vector<uint8_t>    _index_x;
+            std::vector<uint8_t>    _index_y;
+            std::vector<uint8_t>    _stack_pointer;
+            std::vector<uint8_t>    _status_flag;
+            std::vector<uint16_t>   _program_counter;
+            std::vector<uint64_t>   _cycles;
+            std::vector<uint64_t>   _target;
+            std::vector<uint8_t>    _halted;
+            std::vector<uint8_t>    _group;
+            std::vector<uint8_t>    _ram;
+
+            uint16_t                _leader;
+            size_t                  _first;
+            size_t                  _members;
+            bool                    _converged;
+            bool                    _finished;
+            bool                    _split;
+            uint16_t                _next;
+            lanes_stats_t           _stats;
+
+            static const _kernel_t  _kernels[256];
+            static const uint8_t    _base_cycles[256];
+            static const uint8_t    _length[256];
+
+        public:
+                                lanes_t         (size_t lanes, const uint8_t *rom, size_t rom_size, size_t ram_size);
+
+            size_t              lanes           (void) const;
+            void                reset           (void);
+            int                 run_cycles      (unsigned long count);
+
+            uint8_t             peek            (size_t lane, uint16_t address) const;
+            void                poke            (size_t lane, uint16_t address, uint8_t value);
+            void                save            (size_t lane, state_t &state) const;
+            void                load            (size_t lane, const state_t &state);
+            bool                halted          (size_t lane) const;
+
+            lanes_stats_t       stats           (void) const;
+
+        private:
+            size_t              _select         (void);
+            void                _vector         (uint8_t instruction);
+            void                _scalar         (size_t lane);
+
+            void                _load_block     (block_t &block, size_t base) const;
+            void                _store_block    (const block_t &block, uint8_t cycles);
+
+            lane8_t             _row            (uint16_t address, size_t base) const;
+            void                _write_row      (uint16_t address, const block_t &block, lane8_t value);
+            lane8_t             _gather         (const lane16_t &address, size_t base) const;
+            void                _scatter        (const lane16_t &address, const block_t &block, lane8_t value);
+
+            /**
+             * Addressing conventions, RAM rows when every lane uses the
+             * same address and gathers otherwise. Vectors of 16 bit lanes
+             * are passed by reference, by value their ABI depends on
+             * whether AVX is enabled.
+             */
+        private:
+            template <int mode>
+            static void         _address        (lanes_t *self, block_t &block, uint16_t operand,
+                                                 lane8_t &cross, lane16_t &location);
+            template <int mode>
+            static lane8_t      _read           (lanes_t *self, block_t &block, uint16_t operand,
+                                                 const lane16_t &location);
+            template <int mode>
+            static void         _write          (lanes_t *self, block_t &block, uint16_t operand,
+                                                 const lane16_t &location, lane8_t value);
+
+            static void         _push           (lanes_t *self, block_t &block, lane8_t value);
+            static lane8_t      _pop            (lanes_t *self, block_t &block);
+            static void         _push_word      (lanes_t *self, block_t &block, const lane16_t &value);
+            static void         _pop_word       (lanes_t *self, block_t &block, lane16_t &value);
+
+            /**
+             * Instruction families
+             */
+        private:
+            template <int mode, _ins_load_t instruction>
+            static void         _load           (lanes_t *self, block_t &block, uint16_t operand);
+            template <int mode, _ins_store_t instruction>
+            static void         _store          (lanes_t *self, block_t &block, uint16_t operand);
+            template <int mode, _ins_load_store_t instruction>
+            static void         _load_store     (lanes_t *self, block_t &block, uint16_t operand);
+            template <_ins_load_store_t instruction>
+            static void         _load_store_acc (lanes_t *self, block_t &block, uint16_t operand);
+            template <int mode, _ins_load_word_t instruction>
+            static void         _load_word      (lanes_t *self, block_t &block, uint16_t operand);
+            template <_ins_load_word_t instruction>
+            static void         _load_word_imm  (lanes_t *self, block_t &block, uint16_t operand);
+            template <_ins_noarg_t instruction>
+            static void         _noarg          (lanes_t *self, block_t &block, uint16_t operand);
+            static void         _nop            (lanes_t *self, block_t &block, uint16_t operand);
+
+            static void         _flags_nz       (block_t &block, lane8_t value);
+            static void         _compare        (block_t &block, lane8_t a, lane8_t b);
+            static void         _branch         (block_t &block, lane8_t taken, lane8_t value);
+
+            /**
+             * Instruction set, the same semantics as the scalar core
+             */
+        private:
+            static void         _ins_adc        (lanes_t *self, block_t &block, lane8_t value);
+            static void         _ins_and        (lanes_t *self, block_t &block, lane8_t value);
+            static lane8_t      _ins_asl        (lanes_t *self, block_t &block, lane8_t value);
+            static void         _ins_bit        (lanes_t *self, block_t &block, lane8_t value);
+            static void         _ins_bcc        (lanes_t *self, block_t &block, lane8_t value);
+            static void         _ins_bcs        (lanes_t *self, block_t &block, lane8_t value);
+            static void         _ins_beq        (lanes_t *self, block_t &block, lane8_t value);
+            static void         _ins_bmi        (lanes_t *self, block_t &block, lane8_t value);
+            static void         _ins_bne        (lanes_t *self, block_t &block, lane8_t value);
+            static void         _ins_bpl        (lanes_t *self, block_t &block, lane8_t value);
+            static void         _ins_brk        (lanes_t *self, block_t &block);
+            static void         _ins_bvc        (lanes_t *self, block_t &block, lane8_t value);
+            static void         _ins_bvs        (lanes_t *self, block_t &block, lane8_t value);
+            static void         _ins_clc        (lanes_t *self, block_t &block);
+            static void         _ins_cld        (lanes_t *self, block_t &block);
+            static void         _ins_cli        (lanes_t *self, block_t &block);
+            static void         _ins_clv        (lanes_t *self, block_t &block);
+            static void         _ins_cmp        (lanes_t *self, block_t &block, lane8_t value);
+            static void         _ins_cpx        (lanes_t *self, block_t &block, lane8_t value);
+            static void         _ins_cpy        (lanes_t *self, block_t &block, lane8_t value);
+            static lane8_t      _ins_dec        (lanes_t *self, block_t &block, lane8_t value);
+            static void         _ins_dex        (lanes_t *self, block_t &block);
+            static void         _ins_dey        (lanes_t *self, block_t &block);
+            static void         _ins_eor        (lanes_t *self, block_t &block, lane8_t value);
+            static lane8_t      _ins_inc        (lanes_t *self, block_t &block, lane8_t value);
+            static void         _ins_inx        (lanes_t *self, block_t &block);
+            static void         _ins_iny        (lanes_t *self, block_t &block);
+            static void         _ins_jmp        (lanes_t *self, block_t &block, const lane16_t &value);
+            static void         _ins_jsr        (lanes_t *self, block_t &block, const lane16_t &value);
+            static void         _ins_lda        (lanes_t *self, block_t &block, lane8_t value);
+            static void         _ins_ldx        (lanes_t *self, block_t &block, lane8_t value);
+            static void         _ins_ldy        (lanes_t *self, block_t &block, lane8_t value);
+            static lane8_t      _ins_lsr        (lanes_t *self, block_t &block, lane8_t value);
+            static void         _ins_ora        (lanes_t *self, block_t &block, lane8_t value);
+            static void         _ins_pha        (lanes_t *self, block_t &block);
+            static void         _ins_php        (lanes_t *self, block_t &block);
+            static void         _ins_pla        (lanes_t *self, block_t &block);
+            static void         _ins_plp        (lanes_t *self, block_t &block);
+            static lane8_t      _ins_rol        (lanes_t *self, block_t &block, lane8_t value);
+            static lane8_t      _ins_ror        (lanes_t *self, block_t &block, lane8_t value);
+            static void         _ins_rti        (lanes_t *self, block_t &block);
+            static void         _ins_rts        (lanes_t *self, block_t &block);
+            static void         _ins_sbc        (lanes_t *self, block_t &block, lane8_t value);
+            static void         _ins_sec        (lanes_t *self, block_t &block);
+            static void         _ins_sed        (lanes_t *self, block_t &block);
+            static void         _ins_sei        (lanes_t *self, block_t &block);
+            static lane8_t      _ins_sta        (lanes_t *self, block_t &block);
+            static lane8_t      _ins_stx        (lanes_t *self, block_t &block);
+            static lane8_t      _ins_sty        (lanes_t *self, block_t &block);
+            static void         _ins_tax        (lanes_t *self, block_t &block);
+            static void         _ins_tay        (lanes_t *self, block_t &block);
+            static void         _ins_tsx        (lanes_t *self, block_t &block);
+            static void         _ins_txa        (lanes_t *self, block_t &block);
+            static void         _ins_txs        (lanes_t *self, block_t &block);
+            static void         _ins_tya        (lanes_t *self, block_t &block);
+    };
+
+    inline size_t
+    lanes_t::lanes(void) const
+    {
+        return (this->_lanes);
+    }
+
+    inline uint8_t
+    lanes_t::peek(size_t lane, uint16_t address) const
+    {
+        if (address < this->_ram_size) {
+            return (this->_ram[address * this->_stride + lane]);
+        }
+
+        if (address >= this->_rom_base) {
+            return (this->_rom[address - this->_rom_base]);
+        }
+
+        return (0);
+    }
+
+    inline void
+    lanes_t::poke(size_t lane, uint16_t address, uint8_t value)
+    {
+        if (address < this->_ram_size) {
+            this->_ram[address * this->_stride + lane] = value;
+        }
+    }
+
+} // namespace mos6502
+
+#endif // _MOS6502_LANES_HPP_
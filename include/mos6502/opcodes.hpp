@@ -0,0 +1,298 @@
+/**
+ * Copyright (c) 2012 Roy van Dam <roy@8bit.cx>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#ifndef _MOS6502_OPCODES_HPP_
+#define _MOS6502_OPCODES_HPP_
+
+/**
+ * MOS6502 opcode table
+ *
+ * One row per opcode: the instruction family, the addressing convention,
+ * the core instruction it executes and its base cycle count. Page
+ * crossing and branch penalties are added at runtime. The table is
+ * expanded with a caller supplied OPCODE(code, family, mode, instruction,
+ * cycles) macro to build the dispatch tables, the mnemonics, the
+ * instruction lengths and the cycle table.
+ */
+#define _MOS_OPCODES(OPCODE) \
+    OPCODE(0x00, noarg,          impl, brk,  7) \
+    OPCODE(0x01, load,           xind, ora,  6) \
+    OPCODE(0x02, invalid,        none, none, 0) \
+    OPCODE(0x03, invalid,        none, none, 0) \
+    OPCODE(0x04, invalid,        none, none, 0) \
+    OPCODE(0x05, load,           zpg,  ora,  3) \
+    OPCODE(0x06, load_store,     zpg,  asl,  5) \
+    OPCODE(0x07, invalid,        none, none, 0) \
+    OPCODE(0x08, noarg,          impl, php,  3) \
+    OPCODE(0x09, load_imm,       imm,  ora,  2) \
+    OPCODE(0x0a, load_store_acc, acc,  asl,  2) \
+    OPCODE(0x0b, invalid,        none, none, 0) \
+    OPCODE(0x0c, invalid,        none, none, 0) \
+    OPCODE(0x0d, load,           abs,  ora,  4) \
+    OPCODE(0x0e, load_store,     abs,  asl,  6) \
+    OPCODE(0x0f, invalid,        none, none, 0) \
+    OPCODE(0x10, load_imm,       imm,  bpl,  2) \
+    OPCODE(0x11, load,           indy, ora,  5) \
+    OPCODE(0x12, invalid,        none, none, 0) \
+    OPCODE(0x13, invalid,        none, none, 0) \
+    OPCODE(0x14, invalid,        none, none, 0) \
+    OPCODE(0x15, load,           zpgx, ora,  4) \
+    OPCODE(0x16, load_store,     zpgx, asl,  6) \
+    OPCODE(0x17, invalid,        none, none, 0) \
+    OPCODE(0x18, noarg,          impl, clc,  2) \
+    OPCODE(0x19, load,           absy, ora,  4) \
+    OPCODE(0x1a, invalid,        none, none, 0) \
+    OPCODE(0x1b, invalid,        none, none, 0) \
+    OPCODE(0x1c, invalid,        none, none, 0) \
+    OPCODE(0x1d, load,           absx, ora,  4) \
+    OPCODE(0x1e, load_store,     absx, asl,  7) \
+    OPCODE(0x1f, invalid,        none, none, 0) \
+    OPCODE(0x20, load_word_imm,  abs,  jsr,  6) \
+    OPCODE(0x21, load,           xind, and,  6) \
+    OPCODE(0x22, invalid,        none, none, 0) \
+    OPCODE(0x23, invalid,        none, none, 0) \
+    OPCODE(0x24, load,           zpg,  bit,  3) \
+    OPCODE(0x25, load,           zpg,  and,  3) \
+    OPCODE(0x26, load_store,     zpg,  rol,  5) \
+    OPCODE(0x27, invalid,        none, none, 0) \
+    OPCODE(0x28, noarg,          impl, plp,  4) \
+    OPCODE(0x29, load_imm,       imm,  and,  2) \
+    OPCODE(0x2a, load_store_acc, acc,  rol,  2) \
+    OPCODE(0x2b, invalid,        none, none, 0) \
+    OPCODE(0x2c, load,           abs,  bit,  4) \
+    OPCODE(0x2d, load,           abs,  and,  4) \
+    OPCODE(0x2e, load_store,     abs,  rol,  6) \
+    OPCODE(0x2f, invalid,        none, none, 0) \
+    OPCODE(0x30, load_imm,       imm,  bmi,  2) \
+    OPCODE(0x31, load,           indy, and,  5) \
+    OPCODE(0x32, invalid,        none, none, 0) \
+    OPCODE(0x33, invalid,        none, none, 0) \
+    OPCODE(0x34, invalid,        none, none, 0) \
+    OPCODE(0x35, load,           zpgx, and,  4) \
+    OPCODE(0x36, load_store,     zpgx, rol,  6) \
+    OPCODE(0x37, invalid,        none, none, 0) \
+    OPCODE(0x38, noarg,          impl, sec,  2) \
+    OPCODE(0x39, load,           absy, and,  4) \
+    OPCODE(0x3a, invalid,        none, none, 0) \
+    OPCODE(0x3b, invalid,        none, none, 0) \
+    OPCODE(0x3c, invalid,        none, none, 0) \
+    OPCODE(0x3d, load,           absx, and,  4) \
+    OPCODE(0x3e, load_store,     absx, rol,  7) \
+    OPCODE(0x3f, invalid,        none, none, 0) \
+    OPCODE(0x40, noarg,          impl, rti,  6) \
+    OPCODE(0x41, load,           xind, eor,  6) \
+    OPCODE(0x42, invalid,        none, none, 0) \
+    OPCODE(0x43, invalid,        none, none, 0) \
+    OPCODE(0x44, invalid,        none, none, 0) \
+    OPCODE(0x45, load,           zpg,  eor,  3) \
+    OPCODE(0x46, load_store,     zpg,  lsr,  5) \
+    OPCODE(0x47, invalid,        none, none, 0) \
+    OPCODE(0x48, noarg,          impl, pha,  3) \
+    OPCODE(0x49, load_imm,       imm,  eor,  2) \
+    OPCODE(0x4a, load_store_acc, acc,  lsr,  2) \
+    OPCODE(0x4b, invalid,        none, none, 0) \
+    OPCODE(0x4c, load_word_imm,  abs,  jmp,  3) \
+    OPCODE(0x4d, load,           abs,  eor,  4) \
+    OPCODE(0x4e, load_store,     abs,  lsr,  6) \
+    OPCODE(0x4f, invalid,        none, none, 0) \
+    OPCODE(0x50, load_imm,       imm,  bvc,  2) \
+    OPCODE(0x51, load,           indy, eor,  5) \
+    OPCODE(0x52, invalid,        none, none, 0) \
+    OPCODE(0x53, invalid,        none, none, 0) \
+    OPCODE(0x54, invalid,        none, none, 0) \
+    OPCODE(0x55, load,           zpgx, eor,  4) \
+    OPCODE(0x56, load_store,     zpgx, lsr,  6) \
+    OPCODE(0x57, invalid,        none, none, 0) \
+    OPCODE(0x58, noarg,          impl, cli,  2) \
+    OPCODE(0x59, load,           absy, eor,  4) \
+    OPCODE(0x5a, invalid,        none, none, 0) \
+    OPCODE(0x5b, invalid,        none, none, 0) \
+    OPCODE(0x5c, invalid,        none, none, 0) \
+    OPCODE(0x5d, load,           absx, eor,  4) \
+    OPCODE(0x5e, load_store,     absx, lsr,  7) \
+    OPCODE(0x5f, invalid,        none, none, 0) \
+    OPCODE(0x60, noarg,          impl, rts,  6) \
+    OPCODE(0x61, load,           xind, adc,  6) \
+    OPCODE(0x62, invalid,        none, none, 0) \
+    OPCODE(0x63, invalid,        none, none, 0) \
+    OPCODE(0x64, invalid,        none, none, 0) \
+    OPCODE(0x65, load,           zpg,  adc,  3) \
+    OPCODE(0x66, load_store,     zpg,  ror,  5) \
+    OPCODE(0x67, invalid,        none, none, 0) \
+    OPCODE(0x68, noarg,          impl, pla,  4) \
+    OPCODE(0x69, load_imm,       imm,  adc,  2) \
+    OPCODE(0x6a, load_store_acc, acc,  ror,  2) \
+    OPCODE(0x6b, invalid,        none, none, 0) \
+    OPCODE(0x6c, load_word,      abs,  jmp,  5) \
+    OPCODE(0x6d, load,           abs,  adc,  4) \
+    OPCODE(0x6e, load_store,     abs,  ror,  6) \
+    OPCODE(0x6f, invalid,        none, none, 0) \
+    OPCODE(0x70, load_imm,       imm,  bvs,  2) \
+    OPCODE(0x71, load,           indy, adc,  5) \
+    OPCODE(0x72, invalid,        none, none, 0) \
+    OPCODE(0x73, invalid,        none, none, 0) \
+    OPCODE(0x74, invalid,        none, none, 0) \
+    OPCODE(0x75, load,           zpgx, adc,  4) \
+    OPCODE(0x76, load_store,     zpgx, ror,  6) \
+    OPCODE(0x77, invalid,        none, none, 0) \
+    OPCODE(0x78, noarg,          impl, sei,  2) \
+    OPCODE(0x79, load,           absy, adc,  4) \
+    OPCODE(0x7a, invalid,        none, none, 0) \
+    OPCODE(0x7b, invalid,        none, none, 0) \
+    OPCODE(0x7c, invalid,        none, none, 0) \
+    OPCODE(0x7d, load,           absx, adc,  4) \
+    OPCODE(0x7e, load_store,     absx, ror,  7) \
+    OPCODE(0x7f, invalid,        none, none, 0) \
+    OPCODE(0x80, invalid,        none, none, 0) \
+    OPCODE(0x81, store,          xind, sta,  6) \
+    OPCODE(0x82, invalid,        none, none, 0) \
+    OPCODE(0x83, invalid,        none, none, 0) \
+    OPCODE(0x84, store,          zpg,  sty,  3) \
+    OPCODE(0x85, store,          zpg,  sta,  3) \
+    OPCODE(0x86, store,          zpg,  stx,  3) \
+    OPCODE(0x87, invalid,        none, none, 0) \
+    OPCODE(0x88, noarg,          impl, dey,  2) \
+    OPCODE(0x89, invalid,        none, none, 0) \
+    OPCODE(0x8a, noarg,          impl, txa,  2) \
+    OPCODE(0x8b, invalid,        none, none, 0) \
+    OPCODE(0x8c, store,          abs,  sty,  4) \
+    OPCODE(0x8d, store,          abs,  sta,  4) \
+    OPCODE(0x8e, store,          abs,  stx,  4) \
+    OPCODE(0x8f, invalid,        none, none, 0) \
+    OPCODE(0x90, load_imm,       imm,  bcc,  2) \
+    OPCODE(0x91, store,          indy, sta,  6) \
+    OPCODE(0x92, invalid,        none, none, 0) \
+    OPCODE(0x93, invalid,        none, none, 0) \
+    OPCODE(0x94, store,          zpgx, sty,  4) \
+    OPCODE(0x95, store,          zpgx, sta,  4) \
+    OPCODE(0x96, store,          zpgy, stx,  4) \
+    OPCODE(0x97, invalid,        none, none, 0) \
+    OPCODE(0x98, noarg,          impl, tya,  2) \
+    OPCODE(0x99, store,          absy, sta,  5) \
+    OPCODE(0x9a, noarg,          impl, txs,  2) \
+    OPCODE(0x9b, invalid,        none, none, 0) \
+    OPCODE(0x9c, invalid,        none, none, 0) \
+    OPCODE(0x9d, store,          absx, sta,  5) \
+    OPCODE(0x9e, invalid,        none, none, 0) \
+    OPCODE(0x9f, invalid,        none, none, 0) \
+    OPCODE(0xa0, load_imm,       imm,  ldy,  2) \
+    OPCODE(0xa1, load,           xind, lda,  6) \
+    OPCODE(0xa2, load_imm,       imm,  ldx,  2) \
+    OPCODE(0xa3, invalid,        none, none, 0) \
+    OPCODE(0xa4, load,           zpg,  ldy,  3) \
+    OPCODE(0xa5, load,           zpg,  lda,  3) \
+    OPCODE(0xa6, load,           zpg,  ldx,  3) \
+    OPCODE(0xa7, invalid,        none, none, 0) \
+    OPCODE(0xa8, noarg,          impl, tay,  2) \
+    OPCODE(0xa9, load_imm,       imm,  lda,  2) \
+    OPCODE(0xaa, noarg,          impl, tax,  2) \
+    OPCODE(0xab, invalid,        none, none, 0) \
+    OPCODE(0xac, load,           abs,  ldy,  4) \
+    OPCODE(0xad, load,           abs,  lda,  4) \
+    OPCODE(0xae, load,           abs,  ldx,  4) \
+    OPCODE(0xaf, invalid,        none, none, 0) \
+    OPCODE(0xb0, load_imm,       imm,  bcs,  2) \
+    OPCODE(0xb1, load,           indy, lda,  5) \
+    OPCODE(0xb2, invalid,        none, none, 0) \
+    OPCODE(0xb3, invalid,        none, none, 0) \
+    OPCODE(0xb4, load,           zpgx, ldy,  4) \
+    OPCODE(0xb5, load,           zpgx, lda,  4) \
+    OPCODE(0xb6, load,           zpgy, ldx,  4) \
+    OPCODE(0xb7, invalid,        none, none, 0) \
+    OPCODE(0xb8, noarg,          impl, clv,  2) \
+    OPCODE(0xb9, load,           absy, lda,  4) \
+    OPCODE(0xba, noarg,          impl, tsx,  2) \
+    OPCODE(0xbb, invalid,        none, none, 0) \
+    OPCODE(0xbc, load,           absx, ldy,  4) \
+    OPCODE(0xbd, load,           absx, lda,  4) \
+    OPCODE(0xbe, load,           absy, ldx,  4) \
+    OPCODE(0xbf, invalid,        none, none, 0) \
+    OPCODE(0xc0, load_imm,       imm,  cpy,  2) \
+    OPCODE(0xc1, load,           xind, cmp,  6) \
+    OPCODE(0xc2, invalid,        none, none, 0) \
+    OPCODE(0xc3, invalid,        none, none, 0) \
+    OPCODE(0xc4, load,           zpg,  cpy,  3) \
+    OPCODE(0xc5, load,           zpg,  cmp,  3) \
+    OPCODE(0xc6, load_store,     zpg,  dec,  5) \
+    OPCODE(0xc7, invalid,        none, none, 0) \
+    OPCODE(0xc8, noarg,          impl, iny,  2) \
+    OPCODE(0xc9, load_imm,       imm,  cmp,  2) \
+    OPCODE(0xca, noarg,          impl, dex,  2) \
+    OPCODE(0xcb, invalid,        none, none, 0) \
+    OPCODE(0xcc, load,           abs,  cpy,  4) \
+    OPCODE(0xcd, load,           abs,  cmp,  4) \
+    OPCODE(0xce, load_store,     abs,  dec,  6) \
+    OPCODE(0xcf, invalid,        none, none, 0) \
+    OPCODE(0xd0, load_imm,       imm,  bne,  2) \
+    OPCODE(0xd1, load,           indy, cmp,  5) \
+    OPCODE(0xd2, invalid,        none, none, 0) \
+    OPCODE(0xd3, invalid,        none, none, 0) \
+    OPCODE(0xd4, invalid,        none, none, 0) \
+    OPCODE(0xd5, load,           zpgx, cmp,  4) \
+    OPCODE(0xd6, load_store,     zpgx, dec,  6) \
+    OPCODE(0xd7, invalid,        none, none, 0) \
+    OPCODE(0xd8, noarg,          impl, cld,  2) \
+    OPCODE(0xd9, load,           absy, cmp,  4) \
+    OPCODE(0xda, invalid,        none, none, 0) \
+    OPCODE(0xdb, invalid,        none, none, 0) \
+    OPCODE(0xdc, invalid,        none, none, 0) \
+    OPCODE(0xdd, load,           absx, cmp,  4) \
+    OPCODE(0xde, load_store,     absx, dec,  7) \
+    OPCODE(0xdf, invalid,        none, none, 0) \
+    OPCODE(0xe0, load_imm,       imm,  cpx,  2) \
+    OPCODE(0xe1, load,           xind, sbc,  6) \
+    OPCODE(0xe2, invalid,        none, none, 0) \
+    OPCODE(0xe3, invalid,        none, none, 0) \
+    OPCODE(0xe4, load,           zpg,  cpx,  3) \
+    OPCODE(0xe5, load,           zpg,  sbc,  3) \
+    OPCODE(0xe6, load_store,     zpg,  inc,  5) \
+    OPCODE(0xe7, invalid,        none, none, 0) \
+    OPCODE(0xe8, noarg,          impl, inx,  2) \
+    OPCODE(0xe9, load_imm,       imm,  sbc,  2) \
+    OPCODE(0xea, nop,            impl, nop,  2) \
+    OPCODE(0xeb, invalid,        none, none, 0) \
+    OPCODE(0xec, load,           abs,  cpx,  4) \
+    OPCODE(0xed, load,           abs,  sbc,  4) \
+    OPCODE(0xee, load_store,     abs,  inc,  6) \
+    OPCODE(0xef, invalid,        none, none, 0) \
+    OPCODE(0xf0, load_imm,       imm,  beq,  2) \
+    OPCODE(0xf1, load,           indy, sbc,  5) \
+    OPCODE(0xf2, invalid,        none, none, 0) \
+    OPCODE(0xf3, invalid,        none, none, 0) \
+    OPCODE(0xf4, invalid,        none, none, 0) \
+    OPCODE(0xf5, load,           zpgx, sbc,  4) \
+    OPCODE(0xf6, load_store,     zpgx, inc,  6) \
+    OPCODE(0xf7, invalid,        none, none, 0) \
+    OPCODE(0xf8, noarg,          impl, sed,  2) \
+    OPCODE(0xf9, load,           absy, sbc,  4) \
+    OPCODE(0xfa, invalid,        none, none, 0) \
+    OPCODE(0xfb, invalid,        none, none, 0) \
+    OPCODE(0xfc, invalid,        none, none, 0) \
+    OPCODE(0xfd, load,           absx, sbc,  4) \
+    OPCODE(0xfe, load_store,     absx, inc,  7) \
+    OPCODE(0xff, invalid,        none, none, 0)
+
+#endif // _MOS6502_OPCODES_HPP_
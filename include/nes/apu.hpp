@@ -0,0 +1,312 @@
+/**
+ * Copyright (c) 2009 Roy van Dam <roy@8bit.cx>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#ifndef _NES_APU_HPP_
+#define _NES_APU_HPP_
+
+#include <stddef.h>
+#include <inttypes.h>
+
+#include <vector>
+
+#include "nes/memory_map.hpp"
+#include "nes/scheduler.hpp"
+
+#define NES_APU_OFFSET      0x4000
+#define NES_APU_SIZE        0x0100
+#define NES_APU_STATUS      0x4015
+#define NES_APU_FRAME       0x4017
+
+/**
+ * NTSC CPU clock, the rate the APU runs at.
+ */
+#define NES_CPU_RATE        1789773.0
+#define NES_APU_RATE        96000.0
+
+#define NES_APU_CHANNELS    5
+#define NES_APU_PULSE1      0
+#define NES_APU_PULSE2      1
+#define NES_APU_TRIANGLE    2
+#define NES_APU_NOISE       3
+#define NES_APU_DMC         4
+
+/**
+ * Band-limited step kernel: phases per sample and taps per phase.
+ */
+#define BLIP_PHASE_BITS     6
+#define BLIP_PHASES         (1 << BLIP_PHASE_BITS)
+#define BLIP_WIDTH          16
+
+namespace nes {
+
+    struct apu_state_t;
+
+    /**
+     * Band-limited synthesis buffer
+     *
+     * A channel output is a sequence of steps. Each step is added as a
+     * band-limited impulse of its height into a buffer of deltas at the
+     * output rate, at the sub-sample position it happens. The samples
+     * are the running sum of the deltas, so nothing is done between
+     * steps and a block of samples is produced at the end of a frame.
+     * The deltas are only allocated with the first step.
+     */
+    class blip_buffer_t
+    {
+        private:
+            uint64_t            _factor;    // Output samples per clock, 32.32 fixed point.
+            uint64_t            _offset;
+            float               _sum;
+            size_t              _capacity;
+            std::vector<float>  _deltas;
+
+        public:
+                                blip_buffer_t   (void);
+
+            void                configure       (double clock_rate, double sample_rate, uint64_t clocks);
+            void                clear           (void);
+            void                settle          (float level);
+            void                add             (uint64_t clock, float delta);
+            size_t              samples         (uint64_t clocks) const;
+            void                end_block       (uint64_t clocks, float *output);
+
+        private:
+            static const float *_kernel         (unsigned int phase);
+    };
+
+    inline void
+    blip_buffer_t::add(uint64_t clock, float delta)
+    {
+        uint64_t position;
+        position = this->_offset + clock * this->_factor;
+
+        const float *kernel;
+        kernel = _kernel((position >> (32 - BLIP_PHASE_BITS)) & (BLIP_PHASES - 1));
+
+        if (this->_deltas.empty()) {
+            this->_deltas.assign(this->_capacity, 0);
+        }
+
+        float *deltas;
+        deltas = &this->_deltas[position >> 32];
+
+        for (unsigned int i = 0; i < BLIP_WIDTH; i++) {
+            deltas[i] += delta * kernel[i];
+        }
+    }
+
+    /**
+     * Audio processing unit
+     *
+     * Two pulse channels, the triangle, the noise generator and the
+     * delta modulation channel, with the frame counter and its IRQ. Like
+     * the PPU it runs lazily: the channels catch up when their registers
+     * are touched, when the frame counter clocks them and at the end of
+     * a video frame. A channel timer only costs work when it actually
+     * changes the output, silent channels skip ahead.
+     *
+     * Each channel is synthesized on its own into a band-limited stream
+     * of DAC levels at NES_APU_RATE, the resampler mixes them and brings
+     * them to the host rate.
+     */
+    class apu_t : public event_handler_t
+    {
+            /**
+             * Channel state, saved as is
+             */
+        public:
+            struct envelope_t
+            {
+                bool            start;
+                bool            loop;
+                bool            constant;
+                uint8_t         period;
+                uint8_t         divider;
+                uint8_t         decay;
+            };
+
+            struct pulse_t
+            {
+                envelope_t      envelope;
+                uint8_t         duty;
+                uint8_t         step;
+                uint16_t        period;
+                uint8_t         length;
+                bool            sweep_enabled;
+                bool            sweep_negate;
+                bool            sweep_reload;
+                uint8_t         sweep_period;
+                uint8_t         sweep_divider;
+                uint8_t         sweep_shift;
+            };
+
+            struct triangle_t
+            {
+                bool            control;
+                bool            reload;
+                uint8_t         linear_period;
+                uint8_t         linear;
+                uint8_t         step;
+                uint16_t        period;
+                uint8_t         length;
+            };
+
+            struct noise_t
+            {
+                envelope_t      envelope;
+                bool            mode;
+                uint16_t        period;
+                uint16_t        shift;
+                uint8_t         length;
+            };
+
+            struct dmc_t
+            {
+                bool            irq_enabled;
+                bool            loop;
+                uint16_t        period;
+                uint8_t         level;
+                uint16_t        start;
+                uint16_t        size;
+                uint16_t        address;
+                uint16_t        remaining;
+                uint8_t         buffer;
+                bool            buffered;
+                uint8_t         shift;
+                uint8_t         bits;
+                bool            silence;
+            };
+
+        private:
+            memory_map_t       &_memory;
+            scheduler_t        &_scheduler;
+            int                 _event;
+
+            pulse_t             _pulse[2];
+            triangle_t          _triangle;
+            noise_t             _noise;
+            dmc_t               _dmc;
+            uint8_t             _enabled;
+
+            /**
+             * Frame counter and interrupts
+             */
+        private:
+            bool                _five_step;
+            bool                _irq_inhibit;
+            bool                _frame_irq;
+            bool                _dmc_irq;
+            uint64_t            _frame_origin;
+            unsigned int        _frame_step;
+
+            /**
+             * Synthesis: channel timers in absolute CPU cycles, the DAC
+             * level each channel last output, and the block being built.
+             */
+        private:
+            uint64_t            _time;
+            uint64_t            _timers[NES_APU_CHANNELS];
+            int                 _levels[NES_APU_CHANNELS];
+            uint64_t            _block_start;
+            uint64_t            _block_clocks;
+            double              _rate;
+            blip_buffer_t       _blips[NES_APU_CHANNELS];
+            std::vector<float>  _streams[NES_APU_CHANNELS];
+            size_t              _head;
+
+        public:
+                                apu_t           (memory_map_t &memory, scheduler_t &scheduler);
+                                apu_t           (const apu_t &other, memory_map_t &memory, scheduler_t &scheduler);
+
+            void                reset           (uint64_t now);
+            void                set_rate        (double rate);
+            double              rate            (void) const;
+
+            uint8_t             read            (uint16_t address, uint64_t now);
+            void                write           (uint16_t address, uint8_t value, uint64_t now);
+            void                sync            (uint64_t now);
+            void                end_frame       (uint64_t now);
+            bool                irq             (void) const;
+
+            void                save            (apu_state_t &state) const;
+            int                 check           (const apu_state_t &state, uint64_t now) const;
+            void                load            (const apu_state_t &state);
+
+            size_t              available       (void) const;
+            const float        *stream          (unsigned int channel) const;
+            void                consume         (size_t count);
+
+        public: // Scheduled events
+            void                event           (uint64_t deadline);
+
+        private:
+            void                _run            (uint64_t now);
+            void                _run_pulse      (unsigned int index, uint64_t now);
+            void                _run_triangle   (uint64_t now);
+            void                _run_noise      (uint64_t now);
+            void                _run_dmc        (uint64_t now);
+            void                _fetch_dmc      (void);
+            void                _output         (unsigned int channel, int level, uint64_t time);
+            void                _update         (void);
+
+            int                 _pulse_volume   (const pulse_t &pulse) const;
+            uint16_t            _sweep_target   (unsigned int index) const;
+            void                _quarter_frame  (void);
+            void                _half_frame     (void);
+            void                _schedule_frame (void);
+    };
+
+    /**
+     * Saved APU state: the channels, the frame counter and the channel
+     * timers. The synthesis buffers are output and not part of it.
+     */
+    struct apu_state_t
+    {
+        apu_t::pulse_t      pulse[2];
+        apu_t::triangle_t   triangle;
+        apu_t::noise_t      noise;
+        apu_t::dmc_t        dmc;
+        uint8_t             enabled;
+        bool                five_step;
+        bool                irq_inhibit;
+        bool                frame_irq;
+        bool                dmc_irq;
+        uint32_t            frame_step;
+        uint64_t            frame_origin;
+        uint64_t            time;
+        uint64_t            timers[NES_APU_CHANNELS];
+        int32_t             levels[NES_APU_CHANNELS];
+    };
+
+    inline bool
+    apu_t::irq(void) const
+    {
+        return (this->_frame_irq || this->_dmc_irq);
+    }
+
+} // namespace nes
+
+#endif // _NES_APU_HPP_
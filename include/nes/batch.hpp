@@ -0,0 +1,169 @@
+/**
+ * Copyright (c) 2009 Roy van Dam <roy@8bit.cx>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#ifndef _NES_BATCH_HPP_
+#define _NES_BATCH_HPP_
+
+#include <stddef.h>
+#include <inttypes.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "nes/emulator.hpp"
+
+/**
+ * Frames an instance runs before it goes back on its worker's queue.
+ */
+#define NES_BATCH_QUANTUM   1
+
+/**
+ * Times an idle worker looks for an instance again before it sleeps
+ * until one goes back on a queue.
+ */
+#define NES_BATCH_SPINS     64
+
+namespace nes {
+
+    struct batch_job_t
+    {
+        std::string     rom;
+        unsigned long   frames;
+        bool            block_cache;
+        bool            framebuffer;    // Keep the picture of the last frame.
+        ppu_mode_t      ppu_mode;
+    };
+
+    struct batch_result_t
+    {
+        int             status;         // Non-zero when the instance hit an invalid instruction.
+        run_stats_t     stats;          // Summed over all of its quanta.
+    };
+
+    struct batch_stats_t
+    {
+        size_t          instances;
+        unsigned int    threads;
+        unsigned long   frames;
+        unsigned long   quanta;
+        unsigned long   steals;
+        double          seconds;
+    };
+
+    /**
+     * Batch runner
+     *
+     * Owns any number of independent emulator instances and runs each
+     * of them for a number of frames on a pool of threads, one per
+     * core. Every worker keeps a queue of instances: it takes the most
+     * recent one from the back, runs it for a quantum of frames and
+     * puts it back, so an instance tends to stay hot in the cache of
+     * one core. A worker whose queue runs dry steals from the front of
+     * another's, and sleeps when there is nothing to steal either.
+     * Instances of the same title share one ROM image.
+     */
+    class batch_t
+    {
+            struct instance_t
+            {
+                emulator_t     *emulator;
+                batch_job_t     job;
+                batch_result_t  result;
+            };
+
+            struct alignas(64) worker_t
+            {
+                std::mutex          lock;
+                std::deque<size_t>  queue;
+                unsigned long       quanta;
+                unsigned long       steals;
+            };
+
+            std::vector<instance_t>     _instances;
+            std::map<std::string, size_t> _titles;
+            unsigned int                _threads;
+            unsigned long               _quantum;
+            worker_t                   *_workers;
+            unsigned int                _count;
+            std::atomic<size_t>         _remaining;
+            std::mutex                  _idle_lock;
+            std::condition_variable     _idle;
+            unsigned long               _wakeups;
+
+        public:
+                                batch_t         (unsigned int threads = 0, unsigned long quantum = NES_BATCH_QUANTUM);
+                                ~batch_t        (void);
+
+            int                 add             (const batch_job_t &job);
+            batch_stats_t       run             (void);
+
+            size_t              size            (void) const;
+            const emulator_t   *emulator        (size_t index) const;
+            const batch_job_t  &job             (size_t index) const;
+            const batch_result_t &result        (size_t index) const;
+
+        private:
+            void                _work           (unsigned int id);
+            bool                _take           (unsigned int id, size_t &index);
+            bool                _wait           (unsigned int id, size_t &index);
+            void                _wake           (bool all);
+            bool                _step           (instance_t &instance);
+
+            static void         _pin            (unsigned int id);
+    };
+
+    inline size_t
+    batch_t::size(void) const
+    {
+        return (this->_instances.size());
+    }
+
+    inline const emulator_t *
+    batch_t::emulator(size_t index) const
+    {
+        return (this->_instances[index].emulator);
+    }
+
+    inline const batch_job_t &
+    batch_t::job(size_t index) const
+    {
+        return (this->_instances[index].job);
+    }
+
+    inline const batch_result_t &
+    batch_t::result(size_t index) const
+    {
+        return (this->_instances[index].result);
+    }
+
+} // namespace nes
+
+#endif // _NES_BATCH_HPP_
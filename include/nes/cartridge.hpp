@@ -0,0 +1,123 @@
+/**
+ * Copyright (c) 2009 Roy van Dam <roy@8bit.cx>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#ifndef _NES_CARTRIDGE_HPP_
+#define _NES_CARTRIDGE_HPP_
+
+#include <stddef.h>
+#include <inttypes.h>
+
+#include <string>
+#include <vector>
+
+#include "nes/rom_cache.hpp"
+#include "nes/rom_header.hpp"
+
+#define NES_HEADER_SIZE     16
+#define NES_TRAINER_SIZE    512
+
+#define NES_PRG_UNIT        0x4000
+#define NES_CHR_UNIT        0x2000
+#define NES_PRG_BANK        0x2000
+#define NES_CHR_BANK        0x400
+
+namespace nes {
+
+    enum mirroring_t
+    {
+        mirror_horizontal,
+        mirror_vertical,
+        mirror_four_screen,
+        mirror_single_lower,
+        mirror_single_upper
+    };
+
+    enum region_t
+    {
+        region_ntsc,
+        region_pal,
+        region_multi,
+        region_dendy
+    };
+
+    /**
+     * Cartridge image
+     *
+     * The image comes from the ROM cache and PRG-ROM and CHR-ROM are
+     * sliced into tables of 8 KiB and 1 KiB banks pointing straight into
+     * it, the granularity of the finest mappers. Mappers combine
+     * consecutive banks into larger windows. CHR-RAM and PRG-RAM are
+     * the only memory allocated, a cartridge sharing the image of
+     * another one gets its own.
+     */
+    class cartridge_t
+    {
+        private:
+            rom_image_t        *_image;
+
+        public:
+            rom_header_t       *header;
+            bool                nes2;
+            uint64_t            hash;
+
+            uint16_t            mapper;
+            uint8_t             submapper;
+            mirroring_t         mirroring;
+            region_t            region;
+            bool                battery;
+            bool                trainer;
+
+            uint8_t            *prg;
+            size_t              prg_size;
+            uint8_t            *chr;
+            size_t              chr_size;
+            bool                chr_writable;
+
+            std::vector<uint8_t> prg_ram;
+            std::vector<uint8_t> chr_ram;
+
+            std::vector<uint8_t *> prg_banks;
+            std::vector<uint8_t *> chr_banks;
+
+        public:
+                                cartridge_t     (void);
+                                cartridge_t     (const cartridge_t &other);
+                                ~cartridge_t    (void);
+
+            int                 load            (const std::string &filename);
+            int                 share           (const cartridge_t &other);
+
+            uint8_t            *prg_bank        (unsigned int bank, size_t size);
+            uint8_t            *chr_bank        (unsigned int bank, size_t size);
+
+        private:
+            int                 _parse          (void);
+            void                _unload         (void);
+    };
+
+} // namespace nes
+
+#endif // _NES_CARTRIDGE_HPP_
@@ -0,0 +1,90 @@
+/**
+ * Copyright (c) 2009 Roy van Dam <roy@8bit.cx>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#ifndef _NES_CONTROLLER_HPP_
+#define _NES_CONTROLLER_HPP_
+
+#include <inttypes.h>
+
+#define NES_CONTROLLER_PORT     0x4016
+#define NES_CONTROLLER_PORTS    2
+
+/**
+ * Standard controller buttons, in the order the shift register
+ * reports them.
+ */
+#define NES_BUTTON_A            0x01
+#define NES_BUTTON_B            0x02
+#define NES_BUTTON_SELECT       0x04
+#define NES_BUTTON_START        0x08
+#define NES_BUTTON_UP           0x10
+#define NES_BUTTON_DOWN         0x20
+#define NES_BUTTON_LEFT         0x40
+#define NES_BUTTON_RIGHT        0x80
+
+namespace nes {
+
+    struct controller_state_t
+    {
+        uint8_t             buttons[NES_CONTROLLER_PORTS];
+        uint8_t             shift[NES_CONTROLLER_PORTS];
+        bool                strobe;
+    };
+
+    /**
+     * Controller ports
+     *
+     * A standard controller on each port. Writing bit 0 of $4016 sets
+     * the strobe of both, which keeps reloading their shift registers
+     * from the buttons; once it drops, every read of $4016 or $4017
+     * shifts out the next button of that port, and ones after the
+     * eighth. The upper bits read back as open bus, the high byte of
+     * the address.
+     */
+    class controller_t
+    {
+        private:
+            uint8_t             _buttons[NES_CONTROLLER_PORTS];
+            uint8_t             _shift[NES_CONTROLLER_PORTS];
+            bool                _strobe;
+
+        public:
+                                controller_t    (void);
+
+            void                reset           (void);
+            void                set_buttons     (unsigned int port, uint8_t buttons);
+            uint8_t             buttons         (unsigned int port) const;
+
+            uint8_t             read            (uint16_t address);
+            void                write           (uint8_t value);
+
+            void                save            (controller_state_t &state) const;
+            void                load            (const controller_state_t &state);
+    };
+
+} // namespace nes
+
+#endif // _NES_CONTROLLER_HPP_
@@ -27,44 +27,166 @@
 #ifndef _NES_EMULATOR_HPP_
 #define _NES_EMULATOR_HPP_
 
-#include <sys/mman.h>
-#include <sys/stat.h>
-
-#include <fcntl.h>
 #include <stdio.h>
 #include <string.h>
+#include <time.h>
 #include <unistd.h>
 
 #include <string>
 #include <iostream>
+#include <limits>
 using namespace std;
 
-#define NES_ROM_OFFSET  0x8000
+#define NES_RAM_SIZE    0x800
+#define NES_RAM_END     0x2000
+#define NES_IO_OFFSET   0x2000
+#define NES_IO_SIZE     0x2000
+
+#define NES_NMI_VECTOR  0xfffa
+#define NES_IRQ_VECTOR  0xfffe
+
+#define NES_OAM_DMA         0x4014
+#define NES_OAM_DMA_CYCLES  513
 
-#include "nes/rom_header.hpp"
-#include "mos6502/emulator.hpp"
+#include "nes/apu.hpp"
+#include "nes/cartridge.hpp"
+#include "nes/controller.hpp"
+#include "nes/mapper.hpp"
+#include "nes/memory_map.hpp"
+#include "nes/movie.hpp"
+#include "nes/ppu.hpp"
+#include "nes/resampler.hpp"
+#include "nes/rewind.hpp"
+#include "nes/scheduler.hpp"
+#include "nes/state.hpp"
+#include "mos6502/core.hpp"
 
 namespace nes {
 
-    class emulator_t : public mos6502::emulator_t
+    /**
+     * Stop conditions for a headless run, zero means unlimited.
+     */
+    struct run_limits_t
+    {
+        unsigned long   instructions;
+        uint64_t        cycles;
+        unsigned long   frames;
+        double          seconds;
+        int32_t         breakpoint;     // Program counter, or -1.
+    };
+
+    enum stop_reason_t
+    {
+        stop_instructions,
+        stop_cycles,
+        stop_frames,
+        stop_seconds,
+        stop_breakpoint,
+        stop_movie_end,
+        stop_desync,
+        stop_invalid
+    };
+
+    struct run_stats_t
+    {
+        stop_reason_t   reason;
+        unsigned long   instructions;
+        uint64_t        cycles;
+        unsigned long   frames;
+        double          seconds;
+    };
+
+    enum movie_mode_t
+    {
+        movie_off,
+        movie_record,
+        movie_play
+    };
+
+    class emulator_t : public mos6502::core_t<emulator_t>, public io_handler_t
     {
         protected:
-            uint8_t             ram[0x800];
-            uint8_t            *rom;
-            size_t              rom_size;
-            rom_header_t       *rom_header;
+            memory_map_t        memory;
+            memory_map_t        video;
+            scheduler_t         scheduler;
+            uint8_t             ram[NES_RAM_SIZE];
+            uint8_t             vram[NES_VRAM_SIZE];
+            cartridge_t         cartridge;
+            mapper_t           *mapper;
+            ppu_t               ppu;
+            apu_t               apu;
+            controller_t        controller;
+            uint8_t             input[NES_CONTROLLER_PORTS];
+            movie_t            *movie;
+            movie_mode_t        movie_mode;
+            unsigned long       movie_position;
+            resampler_t         resampler;
+            rewind_t            history;
+            vector<uint8_t>     snapshot;
 
         public:
-                    ~emulator_t (void) {};
+                    emulator_t  (void);
+                    ~emulator_t (void);
 
             int     load        (string filename);
-            int     run         (void);
+            int     load        (const emulator_t &other);
+            emulator_t *fork    (void) const;
+            int     run         (const run_limits_t &limits, run_stats_t &stats);
+            int     debugger    (void);
+            int     lockstep    (emulator_t *reference, unsigned long count);
+
+            unsigned long   frame       (void) const;
+            const uint32_t *framebuffer (void) const;
+            void            attach_framebuffer (uint32_t *pixels, size_t pitch);
+            void            enable_framebuffer (bool enable);
+            void            set_ppu_mode (ppu_mode_t mode);
+
+            void            set_audio_rate (double rate);
+            void            adjust_audio_rate (double ratio);
+            size_t          audio_available (void) const;
+            size_t          read_audio  (float *output, size_t count);
+
+            size_t          state_size  (void) const;
+            void            save_state  (uint8_t *state) const;
+            int             load_state  (const uint8_t *state, size_t size);
+
+            void            enable_rewind (size_t budget, unsigned int interval = NES_REWIND_KEYFRAMES);
+            int             rewind      (unsigned long frames);
+            rewind_stats_t  rewind_stats (void) const;
+
+            void            set_buttons (unsigned int port, uint8_t buttons);
+            int             record      (movie_t *movie, bool from_state, unsigned int ports = 1,
+                                         unsigned int interval = NES_MOVIE_CHECKPOINTS);
+            int             play        (movie_t *movie);
+            void            stop_movie  (void);
+            unsigned long   movie_frame (void) const;
+            uint64_t        state_hash  (void);
 
         public: // MOS6502 hooks
             uint8_t read_byte   (uint16_t address);
             void    write_byte  (uint16_t address, uint8_t value);
+            bool    read_only   (uint16_t address);
+            const uint8_t *code_page (uint16_t address);
+
+        public: // I/O registers
+            uint8_t read_io     (uint16_t address);
+            void    write_io    (uint16_t address, uint8_t value);
+
+        private:
+                    emulator_t  (const emulator_t &other);
+            emulator_t &operator=   (const emulator_t &other) = delete;
+
+            int     _insert     (const char *name);
+            int     _power_on   (void);
+            void    _oam_dma    (uint8_t page);
+            void    _capture    (void);
+            bool    _end_frame  (stop_reason_t &reason);
+            void    _latch_input (void);
+            void    _poll_interrupts (void);
     };
 
 } // namespace nes
 
+extern template class mos6502::core_t<nes::emulator_t>;
+
 #endif // _NES_EMULATOR_HPP_
\ No newline at end of file
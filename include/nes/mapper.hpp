@@ -0,0 +1,223 @@
+/**
+ * Copyright (c) 2009 Roy van Dam <roy@8bit.cx>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#ifndef _NES_MAPPER_HPP_
+#define _NES_MAPPER_HPP_
+
+#include <stddef.h>
+#include <inttypes.h>
+
+#include "nes/cartridge.hpp"
+#include "nes/memory_map.hpp"
+
+#define NES_SRAM_OFFSET         0x6000
+#define NES_SRAM_SIZE           0x2000
+#define NES_ROM_OFFSET          0x8000
+#define NES_ROM_SIZE            0x8000
+
+#define NES_PATTERN_SIZE        0x2000
+#define NES_NAMETABLE_OFFSET    0x2000
+#define NES_NAMETABLE_SIZE      0x400
+#define NES_NAMETABLE_END       0x3f00
+#define NES_VRAM_SIZE           (4 * NES_NAMETABLE_SIZE)
+
+#define NES_MAPPER_REGISTERS    16
+
+namespace nes {
+
+    /**
+     * Saved mapper state, each mapper packs its registers its own way
+     * and rebuilds its banks from them.
+     */
+    struct mapper_state_t
+    {
+        uint16_t            mapper;
+        bool                irq_line;
+        uint8_t             registers[NES_MAPPER_REGISTERS];
+    };
+
+    /**
+     * Cartridge mapper
+     *
+     * A mapper owns the cartridge windows of the CPU and PPU address
+     * spaces. Bank switches rewrite the page pointers of the affected
+     * window and nothing else, so reads never look at mapper state and
+     * a switch costs a fixed number of page updates. Writes to the ROM
+     * window reach write_io() through the emulator, which first lets the
+     * PPU catch up with the banks it is about to lose.
+     */
+    class mapper_t : public io_handler_t
+    {
+        protected:
+            cartridge_t        &cartridge;
+            memory_map_t       &cpu;
+            memory_map_t       &ppu;
+            uint8_t            *vram;
+            bool                irq_line;
+
+        public:
+                                mapper_t    (cartridge_t &cartridge, memory_map_t &cpu,
+                                             memory_map_t &ppu, uint8_t *vram);
+            virtual             ~mapper_t   (void) {};
+
+            static mapper_t    *create      (cartridge_t &cartridge, memory_map_t &cpu,
+                                             memory_map_t &ppu, uint8_t *vram);
+            mapper_t           *clone       (cartridge_t &cartridge, memory_map_t &cpu,
+                                             memory_map_t &ppu, uint8_t *vram) const;
+
+            virtual void        reset       (void);
+            virtual bool        counts_scanlines (void) const;
+            virtual void        scanline    (void);
+            bool                irq         (void) const;
+
+            virtual void        save        (mapper_state_t &state) const;
+            virtual int         check       (const mapper_state_t &state) const;
+            virtual void        load        (const mapper_state_t &state);
+
+        public: // I/O registers
+            uint8_t             read_io     (uint16_t address);
+            void                write_io    (uint16_t address, uint8_t value);
+
+        protected:
+            void                _map_prg    (uint16_t address, size_t size, unsigned int bank);
+            void                _map_chr    (uint16_t address, size_t size, unsigned int bank);
+            unsigned int        _last_prg   (size_t size) const;
+            void                _mirror     (mirroring_t mirroring);
+    };
+
+    inline bool
+    mapper_t::irq(void) const
+    {
+        return (this->irq_line);
+    }
+
+    /**
+     * Mapper 0: fixed 16 or 32 KiB of PRG-ROM and 8 KiB of CHR.
+     */
+    class nrom_t : public mapper_t
+    {
+        public:
+                                nrom_t      (cartridge_t &cartridge, memory_map_t &cpu,
+                                             memory_map_t &ppu, uint8_t *vram);
+    };
+
+    /**
+     * Mapper 1: MMC1, registers loaded through a five bit serial port.
+     */
+    class mmc1_t : public mapper_t
+    {
+        private:
+            uint8_t             _shift;
+            uint8_t             _count;
+            uint8_t             _control;
+            uint8_t             _chr[2];
+            uint8_t             _prg;
+
+        public:
+                                mmc1_t      (cartridge_t &cartridge, memory_map_t &cpu,
+                                             memory_map_t &ppu, uint8_t *vram);
+
+            void                reset       (void);
+            void                save        (mapper_state_t &state) const;
+            int                 check       (const mapper_state_t &state) const;
+            void                load        (const mapper_state_t &state);
+            void                write_io    (uint16_t address, uint8_t value);
+
+        private:
+            void                _update     (void);
+    };
+
+    /**
+     * Mapper 2: UxROM, switchable 16 KiB at $8000, last bank fixed.
+     */
+    class uxrom_t : public mapper_t
+    {
+        private:
+            uint8_t             _bank;
+
+        public:
+                                uxrom_t     (cartridge_t &cartridge, memory_map_t &cpu,
+                                             memory_map_t &ppu, uint8_t *vram);
+
+            void                reset       (void);
+            void                save        (mapper_state_t &state) const;
+            void                load        (const mapper_state_t &state);
+            void                write_io    (uint16_t address, uint8_t value);
+    };
+
+    /**
+     * Mapper 3: CNROM, switchable 8 KiB of CHR-ROM.
+     */
+    class cnrom_t : public mapper_t
+    {
+        private:
+            uint8_t             _bank;
+
+        public:
+                                cnrom_t     (cartridge_t &cartridge, memory_map_t &cpu,
+                                             memory_map_t &ppu, uint8_t *vram);
+
+            void                reset       (void);
+            void                save        (mapper_state_t &state) const;
+            void                load        (const mapper_state_t &state);
+            void                write_io    (uint16_t address, uint8_t value);
+    };
+
+    /**
+     * Mapper 4: MMC3, 8 KiB PRG and 1/2 KiB CHR banks and a scanline
+     * counter raising the IRQ line.
+     */
+    class mmc3_t : public mapper_t
+    {
+        private:
+            uint8_t             _select;
+            uint8_t             _banks[8];
+            uint8_t             _latch;
+            uint8_t             _counter;
+            bool                _reload;
+            bool                _enabled;
+            mirroring_t         _mirroring;
+
+        public:
+                                mmc3_t      (cartridge_t &cartridge, memory_map_t &cpu,
+                                             memory_map_t &ppu, uint8_t *vram);
+
+            void                reset       (void);
+            bool                counts_scanlines (void) const;
+            void                scanline    (void);
+            void                save        (mapper_state_t &state) const;
+            int                 check       (const mapper_state_t &state) const;
+            void                load        (const mapper_state_t &state);
+            void                write_io    (uint16_t address, uint8_t value);
+
+        private:
+            void                _update_prg (void);
+            void                _update_chr (void);
+    };
+
+} // namespace nes
+
+#endif // _NES_MAPPER_HPP_
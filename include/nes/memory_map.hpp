@@ -0,0 +1,137 @@
+/**
+ * Copyright (c) 2009 Roy van Dam <roy@8bit.cx>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#ifndef _NES_MEMORY_MAP_HPP_
+#define _NES_MEMORY_MAP_HPP_
+
+#include <stddef.h>
+#include <inttypes.h>
+
+#define NES_PAGE_SHIFT  8
+#define NES_PAGE_SIZE   (1 << NES_PAGE_SHIFT)
+#define NES_PAGE_MASK   (NES_PAGE_SIZE - 1)
+#define NES_PAGES       (0x10000 >> NES_PAGE_SHIFT)
+
+namespace nes {
+
+    /**
+     * Memory mapped I/O registers
+     */
+    class io_handler_t
+    {
+        public:
+            virtual         ~io_handler_t (void) {};
+
+            virtual uint8_t read_io     (uint16_t address) = 0;
+            virtual void    write_io    (uint16_t address, uint8_t value) = 0;
+    };
+
+    /**
+     * CPU or PPU address space
+     *
+     * The 64 KiB address space is split into 256 byte pages, the PPU
+     * only uses the lower 16 KiB of it. Reads and writes on a page
+     * either go straight to host memory through a page pointer, or to
+     * the I/O handler registered for that page. A page can be readable
+     * through its pointer while writes go to a handler, which is how ROM
+     * with bank switching registers is mapped.
+     */
+    class memory_map_t
+    {
+            struct page_t
+            {
+                uint8_t        *read;
+                uint8_t        *write;
+                io_handler_t   *io;
+            };
+
+            page_t              _pages[NES_PAGES];
+
+        public:
+                                memory_map_t    (void);
+
+            void                map             (uint16_t address, size_t size,
+                                                 uint8_t *memory, size_t length, bool writable);
+            void                map_io          (uint16_t address, size_t size, io_handler_t *io);
+            void                unmap           (uint16_t address, size_t size);
+            void                rebase          (const uint8_t *from, size_t size, uint8_t *to);
+            void                rebind          (const io_handler_t *from, io_handler_t *to);
+
+            uint8_t             read_byte       (uint16_t address);
+            void                write_byte      (uint16_t address, uint8_t value);
+            bool                read_only       (uint16_t address) const;
+            const uint8_t      *code_page       (uint16_t address) const;
+
+        private:
+            uint8_t             _read_io        (uint16_t address);
+            void                _write_io       (uint16_t address, uint8_t value);
+    };
+
+    inline uint8_t
+    memory_map_t::read_byte(uint16_t address)
+    {
+        const page_t &page = this->_pages[address >> NES_PAGE_SHIFT];
+
+        if (page.read != NULL) {
+            return (page.read[address & NES_PAGE_MASK]);
+        }
+
+        return (this->_read_io(address));
+    }
+
+    inline void
+    memory_map_t::write_byte(uint16_t address, uint8_t value)
+    {
+        const page_t &page = this->_pages[address >> NES_PAGE_SHIFT];
+
+        if (page.write != NULL) {
+            page.write[address & NES_PAGE_MASK] = value;
+            return;
+        }
+
+        this->_write_io(address, value);
+    }
+
+    inline bool
+    memory_map_t::read_only(uint16_t address) const
+    {
+        const page_t &page = this->_pages[address >> NES_PAGE_SHIFT];
+        return (page.read != NULL && page.write == NULL);
+    }
+
+    /**
+     * Host memory currently behind a page, which changes with every
+     * bank switch on that page.
+     */
+    inline const uint8_t *
+    memory_map_t::code_page(uint16_t address) const
+    {
+        return (this->_pages[address >> NES_PAGE_SHIFT].read);
+    }
+
+} // namespace nes
+
+#endif // _NES_MEMORY_MAP_HPP_
@@ -0,0 +1,117 @@
+/**
+ * Copyright (c) 2009 Roy van Dam <roy@8bit.cx>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#ifndef _NES_MOVIE_HPP_
+#define _NES_MOVIE_HPP_
+
+#include <stddef.h>
+#include <inttypes.h>
+
+#include <string>
+#include <vector>
+
+#include "nes/controller.hpp"
+
+#define NES_MOVIE_MAGIC         0x564d4e46      // "FNMV"
+#define NES_MOVIE_VERSION       1
+
+/**
+ * Frames between two checkpoints, every frame unless told otherwise.
+ */
+#define NES_MOVIE_CHECKPOINTS   1
+
+namespace nes {
+
+    /**
+     * Movie file header
+     *
+     * The header is followed by the input of every frame, one button
+     * mask per port, then the checkpoints, a hash of the save-state
+     * after every interval frames, and last the optional save-state the
+     * movie starts from. Without one it starts at power on, with the
+     * PPU mode of the header. All fields are in host byte order.
+     */
+    struct movie_header_t
+    {
+        uint32_t            magic;
+        uint32_t            version;
+        uint64_t            rom_hash;
+        uint32_t            frames;
+        uint32_t            ports;
+        uint32_t            interval;
+        uint32_t            checkpoints;
+        uint32_t            ppu_mode;
+        uint32_t            reserved;
+        uint64_t            state_size;
+    };
+
+    /**
+     * Input movie
+     *
+     * Plain recording of the buttons held on each frame and of the
+     * checkpoints taken while recording; the emulator records into it
+     * and plays it back.
+     */
+    class movie_t
+    {
+        private:
+            uint64_t                _rom_hash;
+            unsigned int            _ports;
+            unsigned int            _interval;
+            uint32_t                _ppu_mode;
+            std::vector<uint8_t>    _inputs;
+            std::vector<uint64_t>   _checkpoints;
+            std::vector<uint8_t>    _state;
+
+        public:
+                                movie_t         (void);
+
+            void                start           (uint64_t rom_hash, unsigned int ports, unsigned int interval,
+                                                 uint32_t ppu_mode);
+            int                 save            (const std::string &filename) const;
+            int                 load            (const std::string &filename);
+
+            uint64_t            rom_hash        (void) const;
+            unsigned int        ports           (void) const;
+            unsigned int        interval        (void) const;
+            uint32_t            ppu_mode        (void) const;
+            unsigned long       frames          (void) const;
+            size_t              size            (void) const;
+
+            const uint8_t      *input           (unsigned long frame) const;
+            void                add_input       (const uint8_t *buttons);
+
+            size_t              checkpoints     (void) const;
+            uint64_t            checkpoint      (size_t index) const;
+            void                add_checkpoint  (uint64_t hash);
+
+            const std::vector<uint8_t> &state   (void) const;
+            void                set_state       (const uint8_t *state, size_t size);
+    };
+
+} // namespace nes
+
+#endif // _NES_MOVIE_HPP_
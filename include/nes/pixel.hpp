@@ -0,0 +1,83 @@
+/**
+ * Copyright (c) 2009 Roy van Dam <roy@8bit.cx>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#ifndef _NES_PIXEL_HPP_
+#define _NES_PIXEL_HPP_
+
+#include <stddef.h>
+#include <inttypes.h>
+
+namespace nes {
+
+    /**
+     * Pixel kernels
+     *
+     * The per-pixel loops of the renderer: a scalar version, and SSE2
+     * and AVX2 versions that are picked at run time by CPU feature. All
+     * versions produce identical output. Line lengths are a multiple of
+     * 32 pixels.
+     */
+    struct pixel_kernels_t
+    {
+        const char     *name;
+
+        /* Decode a 16 byte CHR tile into eight rows of 2 bit colours. */
+        void            (*decode)(const uint8_t *tile, uint64_t *rows);
+
+        /* Priority mux into palette indices, returns the first sprite zero hit or -1. */
+        int             (*compose)(const uint8_t *background, const uint8_t *sprites,
+                                   uint8_t *output, unsigned int count);
+
+        /* Palette indices to colours through the 32 entry palette. */
+        void            (*convert)(const uint8_t *indices, const uint32_t *palette,
+                                   uint32_t *output, unsigned int count);
+    };
+
+    /**
+     * The fastest kernels the CPU supports, or the named version if it
+     * is supported (scalar, sse2 or avx2).
+     */
+    const pixel_kernels_t *pixel_kernels(const char *name = NULL);
+
+    /**
+     * Spread the bits of both planes of a pattern row over the bytes of
+     * the result, bit 7 ends up in the lowest byte.
+     */
+    inline uint64_t
+    pixel_decode_row(uint8_t low, uint8_t high)
+    {
+        uint64_t l, h;
+        l = ((((low * 0x0101010101010101ULL) & 0x0102040810204080ULL) +
+            0x7f7f7f7f7f7f7f7fULL) & 0x8080808080808080ULL) >> 7;
+        h = ((((high * 0x0101010101010101ULL) & 0x0102040810204080ULL) +
+            0x7f7f7f7f7f7f7f7fULL) & 0x8080808080808080ULL) >> 6;
+
+        return (l | h);
+    }
+
+} // namespace nes
+
+#endif // _NES_PIXEL_HPP_
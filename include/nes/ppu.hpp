@@ -0,0 +1,304 @@
+/**
+ * Copyright (c) 2009 Roy van Dam <roy@8bit.cx>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#ifndef _NES_PPU_HPP_
+#define _NES_PPU_HPP_
+
+#include <stddef.h>
+#include <inttypes.h>
+
+#include <vector>
+
+#include "nes/mapper.hpp"
+#include "nes/memory_map.hpp"
+#include "nes/pixel.hpp"
+#include "nes/scheduler.hpp"
+
+#define NES_SCREEN_WIDTH    256
+#define NES_SCREEN_HEIGHT   240
+#define NES_OAM_SIZE        256
+#define NES_PALETTE_OFFSET  0x3f00
+#define NES_PALETTE_SIZE    0x20
+
+/**
+ * NTSC frame timing in PPU dots, three per CPU cycle.
+ */
+#define NES_DOTS_PER_LINE   341UL
+#define NES_VISIBLE_LINES   240UL
+#define NES_PRERENDER_LINE  261UL
+#define NES_DOTS_PER_FRAME  (NES_DOTS_PER_LINE * 262)
+#define NES_VBLANK_DOT      (NES_DOTS_PER_LINE * 241 + 1)
+#define NES_PRERENDER_DOT   (NES_DOTS_PER_LINE * NES_PRERENDER_LINE + 1)
+#define NES_SCANLINE_DOT    260UL
+
+namespace nes {
+
+    /**
+     * PPU back ends: whole scanlines at a time, or dot by dot for games
+     * that change scroll, masking or banks in the middle of a line.
+     */
+    enum ppu_mode_t
+    {
+        ppu_scanline,
+        ppu_dot
+    };
+
+    /**
+     * Saved PPU state: registers, OAM and palette, and the position of
+     * both back ends and of the event timeline, in fixed size fields.
+     */
+    struct ppu_state_t
+    {
+        uint8_t             control;
+        uint8_t             mask;
+        uint8_t             status;
+        uint8_t             oam_address;
+        uint8_t             buffer;
+        uint8_t             x;
+        bool                w;
+        bool                nmi;
+        uint16_t            v;
+        uint16_t            t;
+        uint32_t            mode;
+        uint8_t             oam[NES_OAM_SIZE];
+        uint8_t             palette[NES_PALETTE_SIZE];
+        uint64_t            event_frame;
+        uint64_t            event_dot;
+        uint64_t            render_frame;
+        uint64_t            frame;
+        uint64_t            sprite0_hit;
+        uint32_t            line;
+        uint32_t            dot;
+        uint64_t            tile;
+        uint64_t            next_tile;
+        uint8_t             sprites[NES_SCREEN_WIDTH];
+    };
+
+    /**
+     * Decoded CHR tiles
+     *
+     * Every 16 byte tile of the cartridge CHR is decoded once into eight
+     * rows of eight bytes, one 2 bit colour per byte with the leftmost
+     * pixel first. Tiles are identified by their place in the CHR memory
+     * rather than by PPU address, so bank switches keep the cache valid
+     * and only CHR-RAM writes invalidate a tile. Decoding uses the
+     * fastest pixel kernels available. The rows are only allocated with
+     * the first tile decoded and left uninitialised until their tile is,
+     * so banks a game never shows cost no memory.
+     */
+    class tile_cache_t
+    {
+        private:
+            const pixel_kernels_t  *_kernels;
+            const uint8_t          *_base;
+            size_t                  _size;
+            uint64_t               *_rows;
+            std::vector<uint8_t>    _valid;
+
+        public:
+                                tile_cache_t    (void);
+                                tile_cache_t    (const tile_cache_t &other) = delete;
+                                ~tile_cache_t   (void);
+            tile_cache_t       &operator=       (const tile_cache_t &other) = delete;
+
+            void                attach          (const uint8_t *base, size_t size);
+            uint64_t            row             (const uint8_t *tile, unsigned int y);
+            void                invalidate      (const uint8_t *address);
+            void                invalidate      (void);
+
+        private:
+            void                _decode         (size_t index);
+    };
+
+    inline uint64_t
+    tile_cache_t::row(const uint8_t *tile, unsigned int y)
+    {
+        size_t offset;
+        offset = (uintptr_t)tile - (uintptr_t)this->_base;
+
+        if (offset >= this->_size) {
+            return (pixel_decode_row(tile[y], tile[y + 8]));
+        }
+
+        if (!this->_valid[offset >> 4]) {
+            this->_decode(offset >> 4);
+        }
+
+        return (this->_rows[(offset >> 1) + y]);
+    }
+
+    /**
+     * Picture processing unit
+     *
+     * Rendering is lazy: the picture catches up when the CPU touches the
+     * PPU or the mapper, or when a PPU event fires. The scanline back end
+     * then draws whole lines up to the one the beam is on, so effects
+     * within a scanline are not reproduced. The dot back end steps every
+     * dot up to the CPU cycle instead, with the background fetches and
+     * shifters, the scroll updates and the sprite evaluation at the dots
+     * where the hardware does them. The PPU drives its own timeline on
+     * the scheduler:
+     * vertical blank, the pre-render line and, for mappers that count
+     * them, the scanline clocks at dot 260.
+     *
+     * Pixels go straight into the framebuffer, which is either provided
+     * by the caller with its own pitch or internal. The internal one is
+     * only allocated once the first line is drawn into it. Headless
+     * instances can go without: everything the CPU can observe is still
+     * evaluated, sprite zero hits included, but no pixels are written.
+     */
+    class ppu_t : public event_handler_t
+    {
+        private:
+            memory_map_t       &_video;
+            scheduler_t        &_scheduler;
+            mapper_t           *_mapper;
+            tile_cache_t        _tiles;
+            const pixel_kernels_t *_kernels;
+            ppu_mode_t          _mode;
+            ppu_mode_t          _selected;
+            int                 _event;
+
+            /**
+             * Registers and internal memory
+             */
+        private:
+            uint8_t             _control;
+            uint8_t             _mask;
+            uint8_t             _status;
+            uint8_t             _oam_address;
+            uint8_t             _buffer;
+            uint16_t            _v;
+            uint16_t            _t;
+            uint8_t             _x;
+            bool                _w;
+            uint8_t             _oam[NES_OAM_SIZE];
+            uint8_t             _palette[NES_PALETTE_SIZE];
+            uint32_t            _colours[NES_PALETTE_SIZE];
+
+            /**
+             * Timing, in PPU dots since power-on
+             */
+        private:
+            uint64_t            _event_frame;
+            unsigned long       _event_dot;
+            uint64_t            _render_frame;
+            unsigned int        _line;
+            unsigned int        _dot;
+            uint64_t            _sprite0_hit;
+            unsigned long       _frame;
+            bool                _nmi;
+
+            /**
+             * Dot renderer pipeline: the tile being drawn, the next one
+             * and the sprite pixels evaluated for the line.
+             */
+        private:
+            uint64_t            _tile;
+            uint64_t            _next_tile;
+            uint8_t             _sprites[NES_SCREEN_WIDTH];
+
+            bool                _drawing;
+            uint32_t           *_output;
+            size_t              _pitch;
+            std::vector<uint32_t> _framebuffer;
+
+        public:
+                                ppu_t           (memory_map_t &video, scheduler_t &scheduler);
+                                ppu_t           (const ppu_t &other, memory_map_t &video, scheduler_t &scheduler,
+                                                 mapper_t *mapper, const uint8_t *chr, size_t chr_size);
+
+            void                reset           (mapper_t *mapper, const uint8_t *chr, size_t chr_size);
+            void                set_mode        (ppu_mode_t mode);
+            ppu_mode_t          mode            (void) const;
+
+            uint8_t             read            (uint16_t address, uint64_t now);
+            void                write           (uint16_t address, uint8_t value, uint64_t now);
+            void                dma             (const uint8_t *page, uint64_t now);
+            void                sync            (uint64_t now);
+
+            void                save            (ppu_state_t &state) const;
+            int                 check           (const ppu_state_t &state, uint64_t now) const;
+            void                load            (const ppu_state_t &state);
+
+            bool                nmi             (void);
+            unsigned long       frame           (void) const;
+            const uint32_t     *framebuffer     (void) const;
+            void                attach_framebuffer (uint32_t *pixels, size_t pitch);
+            void                enable_framebuffer (bool enable);
+
+        public: // Scheduled events
+            void                event           (uint64_t deadline);
+
+        private:
+            void                _sync           (uint64_t dots, bool early);
+            void                _step           (uint64_t dots);
+            void                _step_dot       (void);
+            void                _draw_dot       (unsigned int x);
+            unsigned long       _next_dot       (unsigned long dot) const;
+            bool                _rendering      (void) const;
+
+            uint32_t           *_output_line    (unsigned int line);
+            void                _render_line    (unsigned int line);
+            void                _render_background (uint8_t *pixels);
+            uint64_t            _fetch_tile     (uint16_t v);
+            void                _render_sprites (unsigned int line, uint8_t *pixels);
+            uint64_t            _pattern        (uint16_t address);
+            void                _resolve_colours (void);
+
+            uint8_t             _read_vram      (uint16_t address);
+            void                _write_vram     (uint16_t address, uint8_t value);
+            void                _increment_x    (void);
+            void                _increment_y    (void);
+    };
+
+    inline bool
+    ppu_t::_rendering(void) const
+    {
+        return ((this->_mask & 0x18) != 0);
+    }
+
+    /**
+     * Where to draw a line, NULL when no pixels are drawn.
+     */
+    inline uint32_t *
+    ppu_t::_output_line(unsigned int line)
+    {
+        if (!this->_drawing) {
+            return (NULL);
+        }
+
+        if (this->_output == NULL) {
+            this->_framebuffer.assign(NES_SCREEN_WIDTH * NES_SCREEN_HEIGHT, 0);
+            this->_output = &this->_framebuffer[0];
+        }
+
+        return (this->_output + line * this->_pitch);
+    }
+
+} // namespace nes
+
+#endif // _NES_PPU_HPP_
@@ -0,0 +1,120 @@
+/**
+ * Copyright (c) 2009 Roy van Dam <roy@8bit.cx>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#ifndef _NES_RESAMPLER_HPP_
+#define _NES_RESAMPLER_HPP_
+
+#include <stddef.h>
+#include <inttypes.h>
+
+#include <vector>
+
+#include "nes/apu.hpp"
+
+#define NES_AUDIO_RATE      48000.0
+
+/**
+ * Polyphase filter: phases per input sample and taps per phase, the
+ * taps a multiple of the widest vector.
+ */
+#define RESAMPLER_PHASE_BITS 8
+#define RESAMPLER_PHASES    (1 << RESAMPLER_PHASE_BITS)
+#define RESAMPLER_TAPS      32
+
+namespace nes {
+
+    /**
+     * Audio kernels
+     *
+     * The non-linear NES mixer over the five channel streams and the
+     * dot product of the resampling filter, in a scalar version and in
+     * SSE2 and AVX2 versions picked at run time by CPU feature. The
+     * vector versions sum in a different order and may differ from the
+     * scalar one in the last bits.
+     */
+    struct audio_kernels_t
+    {
+        const char     *name;
+
+        void            (*mix)(const float *const *channels, float *output, size_t count);
+        float           (*dot)(const float *samples, const float *taps);
+    };
+
+    /**
+     * The fastest kernels the CPU supports, or the named version if it
+     * is supported (scalar, sse2 or avx2).
+     */
+    const audio_kernels_t *audio_kernels(const char *name = NULL);
+
+    /**
+     * Mixer and resampler
+     *
+     * Brings the APU channel streams down to the host rate: they are
+     * mixed into a mono history at the APU rate, which a windowed sinc
+     * filter with RESAMPLER_PHASES phases resamples, interpolating
+     * between adjacent phases. The ratio can be nudged by a fraction of
+     * a percent at any time to keep audio paced with video without
+     * under-runs.
+     *
+     * Output is pulled: the caller's buffer is filled straight from the
+     * filter, with as many samples as the input allows.
+     */
+    class resampler_t
+    {
+        private:
+            const audio_kernels_t  *_kernels;
+            double                  _input_rate;
+            double                  _output_rate;
+            double                  _adjust;
+            uint64_t                _step;      // Input samples per output sample, 32.32 fixed point.
+            uint64_t                _position;
+            std::vector<float>      _history;
+            std::vector<float>      _taps;
+
+        public:
+                                resampler_t     (void);
+                                resampler_t     (const resampler_t &other);
+
+            void                configure       (double input_rate, double output_rate,
+                                                 const audio_kernels_t *kernels = NULL);
+            void                adjust          (double ratio);
+            void                clear           (void);
+
+            double              output_rate     (void) const;
+            size_t              available       (size_t input) const;
+
+            void                feed            (const float *const *channels, size_t count);
+            size_t              read            (float *output, size_t count);
+            size_t              pull            (apu_t &apu, float *output, size_t count);
+
+        private:
+            void                _update_step    (void);
+            void                _build_taps     (void);
+    };
+
+} // namespace nes
+
+#endif // _NES_RESAMPLER_HPP_
@@ -0,0 +1,113 @@
+/**
+ * Copyright (c) 2009 Roy van Dam <roy@8bit.cx>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#ifndef _NES_REWIND_HPP_
+#define _NES_REWIND_HPP_
+
+#include <stddef.h>
+#include <inttypes.h>
+
+#include <deque>
+#include <vector>
+
+/**
+ * Snapshots per keyframe group, one per frame.
+ */
+#define NES_REWIND_KEYFRAMES    60
+
+namespace nes {
+
+    struct rewind_stats_t
+    {
+        unsigned long   snapshots;
+        unsigned long   keyframes;
+        unsigned long   frames;         // Frames between the oldest and newest snapshot.
+        size_t          raw_bytes;
+        size_t          stored_bytes;
+        double          ratio;
+    };
+
+    /**
+     * Rewind history
+     *
+     * A save-state is captured every frame into a ring buffer of fixed
+     * size. The first snapshot of every group is a keyframe, the others
+     * are XORed with it, which leaves zeros wherever the state did not
+     * change, and all of them are stored run-length encoded. Seeking
+     * back to any frame decodes at most two snapshots. When the buffer
+     * is full the oldest group makes room for the new snapshots.
+     */
+    class rewind_t
+    {
+            struct snapshot_t
+            {
+                unsigned long   frame;
+                size_t          offset;
+                size_t          size;
+                bool            keyframe;
+            };
+
+            std::vector<uint8_t>    _buffer;
+            std::deque<snapshot_t>  _snapshots;
+            size_t                  _tail;
+            size_t                  _stored;
+            unsigned int            _interval;
+            unsigned int            _count;
+            std::vector<uint8_t>    _keyframe;
+            std::vector<uint8_t>    _zeros;
+            std::vector<uint8_t>    _encoded;
+
+        public:
+                                rewind_t        (void);
+
+            void                configure       (size_t budget, unsigned int interval = NES_REWIND_KEYFRAMES);
+            void                clear           (void);
+            bool                enabled         (void) const;
+
+            void                capture         (unsigned long frame, const uint8_t *state, size_t size);
+            long                seek            (unsigned long frame, uint8_t *state, size_t size);
+            rewind_stats_t      stats           (void) const;
+
+        private:
+            bool                _store          (unsigned long frame, bool keyframe, size_t size);
+            void                _drop_group     (void);
+
+            static bool         _before         (unsigned long frame, const snapshot_t &snapshot);
+
+            static size_t       _encode         (const uint8_t *state, const uint8_t *reference,
+                                                 size_t size, uint8_t *output);
+            static void         _apply          (const uint8_t *input, size_t length, uint8_t *state);
+    };
+
+    inline bool
+    rewind_t::enabled(void) const
+    {
+        return (!this->_buffer.empty());
+    }
+
+} // namespace nes
+
+#endif // _NES_REWIND_HPP_
@@ -0,0 +1,83 @@
+/**
+ * Copyright (c) 2009 Roy van Dam <roy@8bit.cx>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#ifndef _NES_ROM_CACHE_HPP_
+#define _NES_ROM_CACHE_HPP_
+
+#include <stddef.h>
+#include <inttypes.h>
+
+#include <atomic>
+#include <string>
+
+#define NES_HUGE_PAGE   0x200000
+
+namespace nes {
+
+    /**
+     * Read-only ROM image, shared by every cartridge holding a
+     * reference to it and unmapped with the last one.
+     */
+    struct rom_image_t
+    {
+        uint8_t                    *data;
+        size_t                      size;
+        size_t                      mapped;     // Length of the mapping, page rounded.
+        uint64_t                    hash;       // FNV-1a of the whole image.
+        bool                        huge;       // Anonymous copy on huge pages.
+        std::atomic<unsigned int>   references;
+    };
+
+    struct rom_cache_stats_t
+    {
+        unsigned long   images;
+        unsigned long   references;
+        unsigned long   hits;
+        unsigned long   misses;
+        size_t          mapped_bytes;
+        size_t          resident_bytes;
+    };
+
+    /**
+     * Process-wide ROM cache
+     *
+     * Images are keyed by the hash of their content, loading a file
+     * whose bytes are already cached takes a reference to that image
+     * and drops the new mapping, so any number of instances of a title
+     * cost one copy of its ROM. A file seen before is found again by
+     * its device, inode, size and modification time without hashing.
+     * With huge pages enabled, new images are copied into anonymous
+     * memory backed by huge pages when the system has any to spare.
+     */
+    rom_image_t        *rom_acquire         (const std::string &filename);
+    void                rom_retain          (rom_image_t *image);
+    void                rom_release         (rom_image_t *image);
+    void                rom_set_hugepages   (bool enable);
+    rom_cache_stats_t   rom_cache_stats     (void);
+
+} // namespace nes
+
+#endif // _NES_ROM_CACHE_HPP_
@@ -31,14 +31,30 @@
 
 namespace nes {
 
+    /**
+     * iNES / NES 2.0 file header
+     *
+     * The last eight bytes are named after their NES 2.0 meaning. Plain
+     * iNES images only define byte 8, the PRG-RAM size in 8 KiB units,
+     * and the PAL bit in byte 9. The rest should be zero but often
+     * carries garbage from old dumping tools.
+     */
     class rom_header_t
     {
         public:
             uint8_t name[4];
-            uint8_t nrombank;
-            uint8_t nvrombank;
-            uint8_t flags1;
-            uint8_t flags2;
+            uint8_t nrombank;           // PRG-ROM size in 16 KiB units, LSB
+            uint8_t nvrombank;          // CHR-ROM size in 8 KiB units, LSB
+            uint8_t flags1;             // Mapper D0..D3, four-screen, trainer, battery, mirroring
+            uint8_t flags2;             // Mapper D4..D7, NES 2.0 identifier, console type
+            uint8_t mapper_msb;         // Submapper, mapper D8..D11
+            uint8_t prg_chr_msb;        // CHR-ROM size MSB, PRG-ROM size MSB
+            uint8_t prg_ram;            // PRG-NVRAM shift, PRG-RAM shift
+            uint8_t chr_ram;            // CHR-NVRAM shift, CHR-RAM shift
+            uint8_t timing;             // CPU/PPU timing
+            uint8_t console;            // Vs. System or extended console type
+            uint8_t misc_roms;
+            uint8_t expansion;          // Default expansion device
     };
 
 } // namespace nes
@@ -0,0 +1,99 @@
+/**
+ * Copyright (c) 2009 Roy van Dam <roy@8bit.cx>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#ifndef _NES_SCHEDULER_HPP_
+#define _NES_SCHEDULER_HPP_
+
+#include <inttypes.h>
+
+#include <limits>
+#include <vector>
+
+namespace nes {
+
+    /**
+     * Timed event source
+     */
+    class event_handler_t
+    {
+        public:
+            virtual         ~event_handler_t (void) {};
+
+            virtual void    event       (uint64_t deadline) = 0;
+    };
+
+    /**
+     * Event scheduler
+     *
+     * Devices register once and then schedule deadlines in CPU cycles.
+     * Pending events are kept in a binary min-heap indexed by event, so
+     * rescheduling or cancelling an event is O(log n). The CPU runs
+     * uninterrupted up to next() and the events are fired by run() at
+     * that instruction boundary. Devices catch up on their own state
+     * lazily when the CPU touches their registers in between.
+     */
+    class scheduler_t
+    {
+            struct slot_t
+            {
+                event_handler_t    *handler;
+                uint64_t            deadline;
+                int                 position;
+            };
+
+            std::vector<slot_t>     _slots;
+            std::vector<int>        _heap;
+
+        public:
+            int                 add         (event_handler_t *handler);
+            void                rebind      (int event, event_handler_t *handler);
+            void                schedule    (int event, uint64_t deadline);
+            void                cancel      (int event);
+            bool                pending     (int event) const;
+
+            uint64_t            next        (void) const;
+            void                run         (uint64_t now);
+
+        private:
+            void                _place      (int position, int event);
+            void                _sift_up    (int position);
+            void                _sift_down  (int position);
+            void                _remove     (int event);
+    };
+
+    inline uint64_t
+    scheduler_t::next(void) const
+    {
+        if (this->_heap.empty()) {
+            return (std::numeric_limits<uint64_t>::max());
+        }
+
+        return (this->_slots[this->_heap[0]].deadline);
+    }
+
+} // namespace nes
+
+#endif // _NES_SCHEDULER_HPP_
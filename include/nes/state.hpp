@@ -24,17 +24,37 @@
  * SUCH DAMAGE.
  */
 
-#ifndef _DEBUG_HPP_
-#define _DEBUG_HPP_
+#ifndef _NES_STATE_HPP_
+#define _NES_STATE_HPP_
 
-#include <cstdio>
+#include <inttypes.h>
 
-#if defined(WITH_DEBUG)
-    #define debug(...) do {         \
-        fprintf(stderr, __VA_ARGS__); \
-    } while(0)
-#else
-    #define debug(...)
-#endif
+#define NES_STATE_MAGIC     0x53454e46      // "FNES"
+#define NES_STATE_VERSION   2
 
-#endif // _DEBUG_HPP_
\ No newline at end of file
+namespace nes {
+
+    /**
+     * Save-state header
+     *
+     * A save-state is this header followed by one plain-data block per
+     * component, each copied as is in host byte order: the CPU, the
+     * internal RAM and VRAM, the PPU, the APU, the controller ports and
+     * the mapper, then the cartridge PRG-RAM and CHR-RAM. The ROM itself
+     * is only referenced by its hash, a state loads into an emulator
+     * running the same image. The version changes whenever the layout of
+     * a block does.
+     */
+    struct state_header_t
+    {
+        uint32_t            magic;
+        uint32_t            version;
+        uint64_t            size;
+        uint64_t            rom_hash;
+        uint32_t            prg_ram_size;
+        uint32_t            chr_ram_size;
+    };
+
+} // namespace nes
+
+#endif // _NES_STATE_HPP_
@@ -0,0 +1,132 @@
+/**
+ * Copyright (c) 2009 Roy van Dam <roy@8bit.cx>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#ifndef _TRACE_HPP_
+#define _TRACE_HPP_
+
+#include <stdint.h>
+
+/**
+ * Trace categories
+ */
+#define TRACE_CPU           0
+#define TRACE_MEMORY        1
+#define TRACE_STACK         2
+#define TRACE_INTERRUPT     3
+#define TRACE_MAPPER        4
+#define TRACE_CATEGORIES    5
+
+/**
+ * Trace levels, a category traces every level up to its own.
+ */
+#define TRACE_OFF           0
+#define TRACE_ERROR         1
+#define TRACE_INFO          2
+#define TRACE_VERBOSE       3
+
+/**
+ * Categories compiled in, all of them unless overridden.
+ */
+#ifndef TRACE_MASK
+#define TRACE_MASK          ((1 << TRACE_CATEGORIES) - 1)
+#endif
+
+#define TRACE_ARGS          4
+
+/**
+ * Binary trace record
+ *
+ * The format is not expanded at the trace site: the record keeps the
+ * format string and up to TRACE_ARGS raw arguments, which the drain
+ * thread formats later. Arguments must be integers or pointers to
+ * static strings; they are stored as uintptr_t and converted back to
+ * the type of their conversion when the record is formatted.
+ */
+struct trace_record_t
+{
+    const char     *format;
+    uint8_t         category;
+    uint8_t         level;
+    uintptr_t       args[TRACE_ARGS];
+};
+
+extern uint8_t      trace_levels[TRACE_CATEGORIES];
+
+int                 trace_configure (const char *spec);
+void                trace_push      (const trace_record_t &record);
+void                trace_flush     (void);
+
+#if defined(WITH_TRACE)
+
+template <typename value_t>
+inline uintptr_t
+trace_arg(value_t value)
+{
+    return ((uintptr_t)value);
+}
+
+/**
+ * Never called, it only lets the compiler check the arguments of every
+ * trace site against its format.
+ */
+inline void trace_check(const char *format, ...) __attribute__((format(printf, 1, 2)));
+
+inline void
+trace_check(const char *, ...)
+{
+}
+
+template <typename... args_t>
+__attribute__((noinline, cold)) void
+trace_write(uint8_t category, uint8_t level, const char *format, args_t... args)
+{
+    static_assert(sizeof...(args) <= TRACE_ARGS, "Too many trace arguments");
+
+    trace_record_t record = { format, category, level, { trace_arg(args)... } };
+    trace_push(record);
+}
+
+/**
+ * trace(category, level, format, ...)
+ *
+ * Categories outside TRACE_MASK compile to nothing, the others cost a
+ * single compare against the runtime level while they are disabled.
+ */
+#define trace(category, level, ...) do {                                \
+        if (((TRACE_MASK) & (1 << (category))) &&                       \
+            __builtin_expect(trace_levels[category] >= (level), 0)) {   \
+            trace_write(category, level, __VA_ARGS__);                  \
+        }                                                               \
+        if (0) {                                                        \
+            trace_check(__VA_ARGS__);                                   \
+        }                                                               \
+    } while (0)
+
+#else
+    #define trace(category, level, ...)
+#endif
+
+#endif // _TRACE_HPP_
@@ -0,0 +1,1394 @@
+/**
+ * Copyright (c) 2009 Roy van Dam <roy@8bit.cx>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include <dirent.h>
+#include <malloc.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <string>
+#include <thread>
+#include <vector>
+using namespace std;
+
+#include "mos6502/core.hpp"
+#include "mos6502/lanes.hpp"
+#include "nes/apu.hpp"
+#include "nes/batch.hpp"
+#include "nes/emulator.hpp"
+#include "nes/memory_map.hpp"
+#include "nes/pixel.hpp"
+#include "nes/resampler.hpp"
+#include "nes/rom_cache.hpp"
+
+#ifndef FREENES_ROM_DIR
+#define FREENES_ROM_DIR "resources/rom"
+#endif
+
+/**
+ * Sections that check a result as well as timing it count their
+ * failures here, a failed check fails the whole run.
+ */
+static unsigned int failures;
+
+/**
+ * Flat 64 KiB bus for the instruction benchmarks, everything from
+ * 0x8000 up counts as read-only code.
+ */
+class bench_bus_t : public mos6502::core_t<bench_bus_t>
+{
+    public:
+        uint8_t     memory[0x10000];
+
+        uint8_t     read_byte   (uint16_t address) { return (this->memory[address]); }
+        void        write_byte  (uint16_t address, uint8_t value) { this->memory[address] = value; }
+        bool        read_only   (uint16_t address) { return (address >= 0x8000); }
+        const uint8_t *code_page (uint16_t address) { return (&this->memory[address & 0xff00]); }
+};
+
+template class mos6502::core_t<bench_bus_t>;
+
+/**
+ * Instruction benchmark: the instruction is repeated over the code
+ * area and followed by a jump back to the start. Control flow
+ * instructions loop on themselves instead.
+ */
+struct micro_t
+{
+    const char     *name;
+    const char     *family;
+    const char     *mode;
+    uint8_t         code[3];
+    uint8_t         length;
+    bool            loops;
+};
+
+static const micro_t micros[] = {
+    { "lda_imm",    "load_byte",        "imm",  { 0xa9, 0x42, 0x00 }, 2, false },
+    { "lda_zpg",    "load_byte",        "zpg",  { 0xa5, 0x10, 0x00 }, 2, false },
+    { "lda_zpgx",   "load_byte",        "zpgx", { 0xb5, 0x10, 0x00 }, 2, false },
+    { "ldx_zpgy",   "load_byte",        "zpgy", { 0xb6, 0x10, 0x00 }, 2, false },
+    { "lda_abs",    "load_byte",        "abs",  { 0xad, 0x00, 0x03 }, 3, false },
+    { "lda_absx",   "load_byte",        "absx", { 0xbd, 0x00, 0x03 }, 3, false },
+    { "lda_absy",   "load_byte",        "absy", { 0xb9, 0x00, 0x03 }, 3, false },
+    { "lda_xind",   "load_byte",        "xind", { 0xa1, 0x10, 0x00 }, 2, false },
+    { "lda_indy",   "load_byte",        "indy", { 0xb1, 0x10, 0x00 }, 2, false },
+    { "inx",        "noarg",            "impl", { 0xe8, 0x00, 0x00 }, 1, false },
+    { "adc_abs",    "load_byte",        "abs",  { 0x6d, 0x00, 0x03 }, 3, false },
+    { "sta_abs",    "store",            "abs",  { 0x8d, 0x00, 0x03 }, 3, false },
+    { "sta_absx",   "store",            "absx", { 0x9d, 0x00, 0x03 }, 3, false },
+    { "inc_abs",    "load_store",       "abs",  { 0xee, 0x00, 0x03 }, 3, false },
+    { "asl_acc",    "load_store",       "acc",  { 0x0a, 0x00, 0x00 }, 1, false },
+    { "jmp_abs",    "load_word",        "abs",  { 0x4c, 0x00, 0x80 }, 3, true  },
+    { "jmp_ind",    "load_word",        "ind",  { 0x6c, 0x20, 0x00 }, 3, true  },
+    { "bne",        "branch",           "rel",  { 0xd0, 0xfe, 0x00 }, 2, true  },
+};
+
+static double
+now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (ts.tv_sec + ts.tv_nsec / 1e9);
+}
+
+static void
+bench_micro(const micro_t &micro, unsigned long count, bool last)
+{
+    bench_bus_t *bus = new bench_bus_t();
+    memset(bus->memory, 0, sizeof bus->memory);
+
+    /* Zero page pointer for (zp,x) and (zp),y, and the JMP () vector. */
+    bus->memory[0x10] = 0x00;
+    bus->memory[0x11] = 0x03;
+    bus->memory[0x20] = 0x00;
+    bus->memory[0x21] = 0x80;
+
+    uint16_t address;
+    address = 0x8000;
+
+    if (!micro.loops) {
+        for (; address < 0xf000; address += micro.length) {
+            memcpy(bus->memory + address, micro.code, micro.length);
+        }
+
+        bus->memory[address + 0] = 0x4c;
+        bus->memory[address + 1] = 0x00;
+        bus->memory[address + 2] = 0x80;
+    } else {
+        memcpy(bus->memory + address, micro.code, micro.length);
+    }
+
+    double start, seconds;
+    start = now();
+    bus->execute(count);
+    seconds = now() - start;
+
+    printf("    { \"name\": \"%s\", \"family\": \"%s\", \"mode\": \"%s\", "
+           "\"instructions\": %lu, \"cycles\": %llu, \"seconds\": %.6f, "
+           "\"instructions_per_second\": %.0f }%s\n",
+        micro.name, micro.family, micro.mode, count,
+        (unsigned long long)bus->cycles(), seconds, count / seconds, last ? "" : ",");
+
+    delete bus;
+}
+
+/**
+ * Memory map throughput over the RAM mirrors and a read-only ROM area.
+ */
+static void
+bench_memory(unsigned long count)
+{
+    static uint8_t ram[0x800], rom[0x8000];
+    nes::memory_map_t memory;
+    for (size_t i = 0; i < sizeof rom; i++) {
+        ram[i % sizeof ram] = i * 3;
+        rom[i] = i * 5;
+    }
+
+    memory.map(0x0000, 0x2000, ram, sizeof ram, true);
+    memory.map(0x8000, 0x8000, rom, sizeof rom, false);
+
+    const struct {
+        const char *name;
+        uint16_t    base;
+        uint16_t    mask;
+        bool        write;
+    } runs[] = {
+        { "ram_read",   0x0000, 0x1fff, false },
+        { "ram_write",  0x0000, 0x1fff, true  },
+        { "rom_read",   0x8000, 0x7fff, false },
+    };
+
+    for (size_t i = 0; i < sizeof runs / sizeof runs[0]; i++) {
+        unsigned long n;
+        uint8_t sum;
+        double start, seconds;
+
+        sum = 0;
+        start = now();
+
+        for (n = 0; n < count; n++) {
+            uint16_t address;
+            address = runs[i].base + ((n * 7) & runs[i].mask);
+
+            if (runs[i].write) {
+                memory.write_byte(address, (uint8_t)n);
+            } else {
+                sum += memory.read_byte(address);
+            }
+        }
+
+        seconds = now() - start;
+
+        printf("    { \"name\": \"%s\", \"accesses\": %lu, \"seconds\": %.6f, "
+               "\"accesses_per_second\": %.0f, \"checksum\": %u }%s\n",
+            runs[i].name, count, seconds, count / seconds, sum,
+            i + 1 < sizeof runs / sizeof runs[0] ? "," : "");
+    }
+}
+
+/**
+ * Pixel kernels on a few random lines that stay in cache, each version
+ * against the scalar one for both speed and output.
+ */
+#define BENCH_LINES     64
+#define BENCH_WIDTH     256
+
+struct pixel_data_t
+{
+    uint8_t         tiles[BENCH_LINES * 16];
+    uint8_t         background[BENCH_LINES * BENCH_WIDTH];
+    uint8_t         sprites[BENCH_LINES * BENCH_WIDTH];
+    uint32_t        palette[32];
+
+    uint64_t        rows[BENCH_LINES * 8];
+    uint8_t         indices[BENCH_LINES * BENCH_WIDTH];
+    int             hits[BENCH_LINES];
+    uint32_t        colours[BENCH_LINES * BENCH_WIDTH];
+};
+
+static void
+pixel_data(pixel_data_t &data)
+{
+    srand(6502);
+
+    for (size_t i = 0; i < sizeof data.tiles; i++) {
+        data.tiles[i] = rand();
+    }
+
+    for (size_t i = 0; i < sizeof data.background; i++) {
+        data.background[i] = rand() & 0x0f;
+        data.sprites[i] = rand() % 4 == 0 ? (rand() & 0x7f) | 0x10 : 0;
+    }
+
+    for (size_t i = 0; i < 32; i++) {
+        data.palette[i] = 0xff000000 | rand();
+    }
+}
+
+static double
+bench_kernel(const nes::pixel_kernels_t *kernels, size_t kernel, pixel_data_t &data, unsigned long count)
+{
+    double start;
+    start = now();
+
+    for (unsigned long n = 0; n < count; n += BENCH_LINES) {
+        for (unsigned int i = 0; i < BENCH_LINES; i++) {
+            if (kernel == 0) {
+                kernels->decode(data.tiles + i * 16, data.rows + i * 8);
+            } else if (kernel == 1) {
+                data.hits[i] = kernels->compose(data.background + i * BENCH_WIDTH,
+                    data.sprites + i * BENCH_WIDTH, data.indices + i * BENCH_WIDTH, BENCH_WIDTH);
+            } else {
+                kernels->convert(data.indices + i * BENCH_WIDTH, data.palette,
+                    data.colours + i * BENCH_WIDTH, BENCH_WIDTH);
+            }
+        }
+    }
+
+    return (now() - start);
+}
+
+static void
+bench_pixel(unsigned long lines)
+{
+    static const char *variants[] = { "scalar", "sse2", "avx2" };
+    static const char *kernels[] = { "decode", "compose", "convert" };
+    vector<string> entries;
+
+    pixel_data_t *reference = new pixel_data_t(), *data = new pixel_data_t();
+    pixel_data(*reference);
+
+    double baseline[3];
+
+    for (size_t v = 0; v < sizeof variants / sizeof variants[0]; v++) {
+        const nes::pixel_kernels_t *selected;
+        if ((selected = nes::pixel_kernels(variants[v])) == NULL) {
+            continue;
+        }
+
+        pixel_data(*data);
+
+        for (size_t k = 0; k < sizeof kernels / sizeof kernels[0]; k++) {
+            double seconds;
+            seconds = bench_kernel(selected, k, *data, lines);
+
+            if (v == 0) {
+                baseline[k] = seconds;
+                bench_kernel(selected, k, *reference, BENCH_LINES);
+            }
+
+            bool matches;
+            if (k == 0) {
+                matches = memcmp(data->rows, reference->rows, sizeof data->rows) == 0;
+            } else if (k == 1) {
+                matches = memcmp(data->indices, reference->indices, sizeof data->indices) == 0 &&
+                    memcmp(data->hits, reference->hits, sizeof data->hits) == 0;
+            } else {
+                matches = memcmp(data->colours, reference->colours, sizeof data->colours) == 0;
+            }
+
+            /* A tile is eight rows, the others work a line at a time. */
+            unsigned long units;
+            units = k == 0 ? lines * 64 : lines * BENCH_WIDTH;
+
+            char entry[256];
+            snprintf(entry, sizeof entry, "    { \"kernels\": \"%s\", \"kernel\": \"%s\", "
+                "\"pixels\": %lu, \"seconds\": %.6f, \"pixels_per_second\": %.0f, "
+                "\"speedup\": %.2f, \"matches_scalar\": %s }",
+                variants[v], kernels[k], units, seconds, units / seconds,
+                baseline[k] / seconds, matches ? "true" : "false");
+            entries.push_back(entry);
+        }
+    }
+
+    for (size_t i = 0; i < entries.size(); i++) {
+        printf("%s%s\n", entries[i].c_str(), i + 1 < entries.size() ? "," : "");
+    }
+
+    delete reference;
+    delete data;
+}
+
+/**
+ * Largest share of the 60 Hz frame time audio may take, it has to
+ * leave most of the frame to the CPU and PPU.
+ */
+#define APU_FRACTION    0.25
+
+/**
+ * APU on its own: both pulses, the triangle and the noise playing for
+ * a number of video frames, with the samples resampled to the host
+ * rate every frame. The cost is also given as a share of the frame
+ * time, over APU_FRACTION fails the row. The checksum of the samples
+ * only keeps them from being optimised away.
+ */
+static void
+bench_apu(unsigned long frames)
+{
+    static const uint8_t writes[][2] = {
+        { 0x15, 0x0f }, { 0x17, 0x40 },
+        { 0x00, 0xbf }, { 0x02, 0xfd }, { 0x03, 0x08 },
+        { 0x04, 0x7f }, { 0x05, 0x9a }, { 0x06, 0x7e }, { 0x07, 0x08 },
+        { 0x08, 0xff }, { 0x0a, 0xa9 }, { 0x0b, 0x08 },
+        { 0x0c, 0x3a }, { 0x0e, 0x03 }, { 0x0f, 0x08 },
+    };
+
+    nes::memory_map_t memory;
+    nes::scheduler_t scheduler;
+    nes::apu_t *apu = new nes::apu_t(memory, scheduler);
+    nes::resampler_t *resampler = new nes::resampler_t();
+    apu->reset(0);
+
+    for (size_t i = 0; i < sizeof writes / sizeof writes[0]; i++) {
+        apu->write(NES_APU_OFFSET + writes[i][0], writes[i][1], i);
+    }
+
+    vector<float> samples(4096);
+    uint64_t cycles = 0;
+    size_t count = 0;
+    double sum = 0;
+
+    double start, seconds;
+    start = now();
+
+    for (unsigned long frame = 0; frame < frames; frame++) {
+        cycles += NES_DOTS_PER_FRAME / 3;
+        scheduler.run(cycles);
+        apu->end_frame(cycles);
+
+        size_t read;
+        read = resampler->pull(*apu, &samples[0], samples.size());
+
+        for (size_t i = 0; i < read; i++) {
+            sum += samples[i];
+        }
+        count += read;
+    }
+
+    seconds = now() - start;
+
+    double fraction;
+    fraction = seconds / frames * 60.0988;
+
+    bool ok;
+    ok = fraction <= APU_FRACTION;
+    failures += !ok;
+
+    printf("    { \"frames\": %lu, \"samples\": %zu, \"rate\": %.0f, \"seconds\": %.6f, "
+           "\"seconds_per_frame\": %.9f, \"frame_fraction\": %.6f, \"limit\": %.2f, "
+           "\"checksum\": %.4f, \"ok\": %s }\n",
+        frames, count, resampler->output_rate(), seconds, seconds / frames, fraction, APU_FRACTION,
+        sum, ok ? "true" : "false");
+
+    delete resampler;
+    delete apu;
+}
+
+/**
+ * Lockstep program: an 8 bit LFSR per lane in $00 feeding a running
+ * sum and a table at $0200, with a subroutine call per iteration. The
+ * LFSR step branches on the bit shifted out, which differs per lane;
+ * the uniform variant always takes the same path.
+ */
+static const uint8_t lanes_program[] = {
+    0xa2, 0x00,             // 8000: LDX #$00
+    0xa5, 0x00,             // 8002: LDA $00
+    0x4a,                   // 8004: LSR A
+    0x90, 0x02,             // 8005: BCC $8009
+    0x49, 0xb8,             // 8007: EOR #$B8
+    0x85, 0x00,             // 8009: STA $00
+    0x18,                   // 800b: CLC
+    0x65, 0x01,             // 800c: ADC $01
+    0x85, 0x01,             // 800e: STA $01
+    0xa0, 0x08,             // 8010: LDY #$08
+    0xb9, 0x00, 0x02,       // 8012: LDA $0200,Y
+    0x65, 0x00,             // 8015: ADC $00
+    0x99, 0x00, 0x02,       // 8017: STA $0200,Y
+    0x88,                   // 801a: DEY
+    0xd0, 0xf5,             // 801b: BNE $8012
+    0x20, 0x30, 0x80,       // 801d: JSR $8030
+    0xe8,                   // 8020: INX
+    0x4c, 0x02, 0x80,       // 8021: JMP $8002
+};
+
+static const uint8_t lanes_subroutine[] = {
+    0xe6, 0x02,             // 8030: INC $02
+    0x60,                   // 8032: RTS
+};
+
+#define LANES_RAM_SIZE  0x800
+
+static const size_t lane_counts[] = { 16, 64, 256 };
+
+/**
+ * One scalar instance of a lane: its own RAM and the shared ROM.
+ */
+class lane_bus_t : public mos6502::core_t<lane_bus_t>
+{
+    public:
+        const uint8_t  *rom;
+        uint8_t         ram[LANES_RAM_SIZE];
+
+        uint8_t     read_byte   (uint16_t address) { return (address < LANES_RAM_SIZE ? this->ram[address] : address >= 0x8000 ? this->rom[address - 0x8000] : 0); }
+        void        write_byte  (uint16_t address, uint8_t value) { if (address < LANES_RAM_SIZE) this->ram[address] = value; }
+        bool        read_only   (uint16_t address) { return (address >= LANES_RAM_SIZE); }
+        const uint8_t *code_page (uint16_t address) { return (NULL); }
+};
+
+/**
+ * The lockstep engine against the same lanes run one after the other
+ * on the scalar core, with the share of steps where the lanes did not
+ * agree on the program counter.
+ */
+static void
+bench_lanes(size_t count, unsigned long cycles, bool uniform, bool last)
+{
+    vector<uint8_t> rom(0x8000, 0xea);
+    memcpy(&rom[0], lanes_program, sizeof lanes_program);
+    memcpy(&rom[0x30], lanes_subroutine, sizeof lanes_subroutine);
+    rom[0x7ffc] = 0x00;
+    rom[0x7ffd] = 0x80;
+
+    if (uniform) {
+        rom[0x05] = 0xea;
+        rom[0x06] = 0xea;
+    }
+
+    mos6502::lanes_t *lanes = new mos6502::lanes_t(count, &rom[0], rom.size(), LANES_RAM_SIZE);
+    vector<lane_bus_t *> scalar(count);
+
+    for (size_t i = 0; i < count; i++) {
+        scalar[i] = new lane_bus_t();
+        scalar[i]->rom = &rom[0];
+        memset(scalar[i]->ram, 0, sizeof scalar[i]->ram);
+
+        scalar[i]->ram[0] = i * 37 + 1;
+        scalar[i]->ram[1] = i;
+
+        lanes->poke(i, 0, scalar[i]->ram[0]);
+        lanes->poke(i, 1, scalar[i]->ram[1]);
+        scalar[i]->reset();
+    }
+
+    lanes->reset();
+
+    double start, seconds[2];
+    start = now();
+
+    for (size_t i = 0; i < count; i++) {
+        scalar[i]->run_cycles(cycles);
+    }
+
+    seconds[0] = now() - start;
+    start = now();
+
+    lanes->run_cycles(cycles);
+
+    seconds[1] = now() - start;
+
+    bool match = true;
+
+    for (size_t i = 0; i < count; i++) {
+        mos6502::state_t a, b;
+        scalar[i]->save(a);
+        lanes->save(i, b);
+
+        match = match && memcmp(&a.registers, &b.registers, sizeof a.registers) == 0 && a.cycles == b.cycles;
+
+        for (uint16_t address = 0; address < LANES_RAM_SIZE; address++) {
+            match = match && scalar[i]->ram[address] == lanes->peek(i, address);
+        }
+
+        delete scalar[i];
+    }
+
+    mos6502::lanes_stats_t stats;
+    stats = lanes->stats();
+
+    uint64_t instructions;
+    instructions = stats.vector_instructions + stats.scalar_instructions;
+
+    printf("    { \"workload\": \"%s\", \"lanes\": %zu, \"cycles\": %lu, \"instructions\": %llu, "
+           "\"scalar_seconds\": %.6f, \"lanes_seconds\": %.6f, \"speedup\": %.2f, "
+           "\"divergence\": %.4f, \"vector_share\": %.4f, \"match\": %s }%s\n",
+        uniform ? "uniform" : "lfsr", count, cycles, (unsigned long long)instructions,
+        seconds[0], seconds[1], seconds[0] / seconds[1], stats.divergence,
+        instructions ? (double)stats.vector_instructions / instructions : 0.0,
+        match ? "true" : "false", last ? "" : ",");
+
+    delete lanes;
+}
+
+/**
+ * Audio kernels: the mixer and the resampler from the APU rate to the
+ * default host rate on random channel levels, each version against the
+ * scalar one for speed and the largest difference in output.
+ */
+static void
+bench_audio(unsigned long samples)
+{
+    static const char *variants[] = { "scalar", "sse2", "avx2" };
+    const size_t block = 4096;
+
+    vector<float> channels[NES_APU_CHANNELS];
+    const float *inputs[NES_APU_CHANNELS];
+
+    srand(0x2a03);
+    for (unsigned int c = 0; c < NES_APU_CHANNELS; c++) {
+        channels[c].resize(block);
+
+        for (size_t i = 0; i < block; i++) {
+            channels[c][i] = rand() % (c == NES_APU_DMC ? 128 : 16);
+        }
+
+        inputs[c] = &channels[c][0];
+    }
+
+    vector<float> mixed(block), output(block), reference[2];
+    double baseline[2] = { 0, 0 };
+    vector<string> entries;
+
+    for (size_t v = 0; v < sizeof variants / sizeof variants[0]; v++) {
+        const nes::audio_kernels_t *kernels;
+        if ((kernels = nes::audio_kernels(variants[v])) == NULL) {
+            continue;
+        }
+
+        nes::resampler_t *resampler = new nes::resampler_t();
+        resampler->configure(NES_APU_RATE, NES_AUDIO_RATE, kernels);
+
+        double start, seconds[2];
+        start = now();
+
+        for (unsigned long n = 0; n < samples; n += block) {
+            kernels->mix(inputs, &mixed[0], block);
+        }
+
+        seconds[0] = now() - start;
+        start = now();
+
+        size_t produced = 0;
+        for (unsigned long n = 0; n < samples; n += block) {
+            resampler->feed(inputs, block);
+            produced = resampler->read(&output[0], output.size());
+        }
+
+        seconds[1] = now() - start;
+        output.resize(produced);
+
+        // Drained, a read with nothing fed in between has nothing to give.
+        vector<float> spare(block);
+        bool drained;
+        drained = resampler->available(0) == 0 && resampler->read(&spare[0], block) == 0;
+
+        if (v == 0) {
+            baseline[0] = seconds[0];
+            baseline[1] = seconds[1];
+            reference[0] = mixed;
+            reference[1] = output;
+        }
+
+        for (unsigned int k = 0; k < 2; k++) {
+            const vector<float> &result = k == 0 ? mixed : output;
+            float error = 0;
+
+            for (size_t i = 0; i < min(result.size(), reference[k].size()); i++) {
+                error = max(error, fabsf(result[i] - reference[k][i]));
+            }
+
+            char entry[320];
+            snprintf(entry, sizeof entry, "    { \"kernels\": \"%s\", \"kernel\": \"%s\", "
+                "\"samples\": %lu, \"seconds\": %.6f, \"samples_per_second\": %.0f, "
+                "\"speedup\": %.2f, \"max_error\": %.3g%s }",
+                variants[v], k == 0 ? "mix" : "resample", samples, seconds[k], samples / seconds[k],
+                baseline[k] / seconds[k], error, k == 0 ? "" : drained ? ", \"drained\": true" : ", \"drained\": false");
+            entries.push_back(entry);
+        }
+
+        output.resize(block);
+        delete resampler;
+    }
+
+    for (size_t i = 0; i < entries.size(); i++) {
+        printf("%s%s\n", entries[i].c_str(), i + 1 < entries.size() ? "," : "");
+    }
+}
+
+static const char *
+reason(nes::stop_reason_t reason)
+{
+    switch (reason) {
+        case nes::stop_instructions:    return ("instructions");
+        case nes::stop_cycles:          return ("cycles");
+        case nes::stop_frames:          return ("frames");
+        case nes::stop_seconds:         return ("seconds");
+        case nes::stop_breakpoint:      return ("breakpoint");
+        case nes::stop_movie_end:       return ("movie_end");
+        case nes::stop_desync:          return ("desync");
+        case nes::stop_invalid:         return ("invalid");
+    }
+
+    return ("unknown");
+}
+
+/**
+ * Whole ROM run, headless for a fixed number of cycles, with the given
+ * dispatch and PPU back end.
+ */
+static void
+bench_rom(const string &path, bool blocks, nes::ppu_mode_t mode, uint64_t cycles, bool last)
+{
+    nes::emulator_t *emulator = new nes::emulator_t();
+    emulator->enable_block_cache(blocks);
+    emulator->set_ppu_mode(mode);
+
+    const char *ppu;
+    ppu = mode == nes::ppu_dot ? "dot" : "scanline";
+
+    string name;
+    name = path.substr(path.find_last_of('/') + 1);
+
+    if (emulator->load(path) != 0) {
+        printf("    { \"rom\": \"%s\", \"dispatch\": \"%s\", \"ppu\": \"%s\", \"error\": \"load failed\" }%s\n",
+            name.c_str(), blocks ? "blocks" : "interpreter", ppu, last ? "" : ",");
+        delete emulator;
+        return;
+    }
+
+    nes::run_limits_t limits = nes::run_limits_t();
+    limits.cycles = cycles;
+    limits.breakpoint = -1;
+
+    nes::run_stats_t stats;
+    emulator->run(limits, stats);
+
+    printf("    { \"rom\": \"%s\", \"dispatch\": \"%s\", \"ppu\": \"%s\", \"stop\": \"%s\", "
+           "\"instructions\": %lu, \"cycles\": %llu, \"frames\": %lu, \"seconds\": %.6f, "
+           "\"instructions_per_second\": %.0f, \"frames_per_second\": %.1f }%s\n",
+        name.c_str(), blocks ? "blocks" : "interpreter", ppu, reason(stats.reason),
+        stats.instructions, (unsigned long long)stats.cycles, stats.frames, stats.seconds,
+        stats.instructions / stats.seconds, stats.frames / stats.seconds, last ? "" : ",");
+
+    delete emulator;
+}
+
+/**
+ * Save-state round trips on a ROM a few seconds into its run.
+ */
+static void
+bench_state(const string &path, unsigned long count, bool last)
+{
+    nes::emulator_t *emulator = new nes::emulator_t();
+    emulator->enable_block_cache(true);
+
+    string name;
+    name = path.substr(path.find_last_of('/') + 1);
+
+    if (emulator->load(path) != 0) {
+        printf("    { \"rom\": \"%s\", \"error\": \"load failed\" }%s\n", name.c_str(), last ? "" : ",");
+        delete emulator;
+        return;
+    }
+
+    nes::run_limits_t limits = nes::run_limits_t();
+    limits.frames = 300;
+    limits.breakpoint = -1;
+
+    nes::run_stats_t stats;
+    emulator->run(limits, stats);
+
+    vector<uint8_t> state(emulator->state_size());
+
+    double start, seconds[2];
+    start = now();
+
+    for (unsigned long i = 0; i < count; i++) {
+        emulator->save_state(&state[0]);
+    }
+
+    seconds[0] = now() - start;
+    start = now();
+
+    for (unsigned long i = 0; i < count; i++) {
+        emulator->load_state(&state[0], state.size());
+    }
+
+    seconds[1] = now() - start;
+
+    printf("    { \"rom\": \"%s\", \"bytes\": %zu, \"states\": %lu, "
+           "\"save_microseconds\": %.3f, \"load_microseconds\": %.3f }%s\n",
+        name.c_str(), state.size(), count, seconds[0] / count * 1e6, seconds[1] / count * 1e6,
+        last ? "" : ",");
+
+    delete emulator;
+}
+
+/**
+ * Rewind history over a run of frames with a 64 MiB budget: the
+ * compression ratio, the cost of capturing against a plain run, and
+ * stepping back a frame at a time.
+ */
+static void
+bench_rewind(const string &path, unsigned long frames, bool last)
+{
+    string name;
+    name = path.substr(path.find_last_of('/') + 1);
+
+    nes::run_limits_t limits = nes::run_limits_t();
+    limits.frames = frames;
+    limits.breakpoint = -1;
+
+    nes::run_stats_t stats[2];
+
+    for (unsigned int rewind = 0; rewind < 2; rewind++) {
+        nes::emulator_t *emulator = new nes::emulator_t();
+        emulator->enable_block_cache(true);
+        emulator->enable_rewind(rewind ? 64 << 20 : 0);
+
+        if (emulator->load(path) != 0) {
+            printf("    { \"rom\": \"%s\", \"error\": \"load failed\" }%s\n", name.c_str(), last ? "" : ",");
+            delete emulator;
+            return;
+        }
+
+        emulator->run(limits, stats[rewind]);
+
+        if (!rewind) {
+            delete emulator;
+            continue;
+        }
+
+        nes::rewind_stats_t history;
+        history = emulator->rewind_stats();
+
+        unsigned long seeks;
+        seeks = min(history.snapshots, 600UL);
+
+        double start, seconds;
+        start = now();
+
+        for (unsigned long i = 0; i < seeks; i++) {
+            emulator->rewind(1);
+        }
+
+        seconds = now() - start;
+
+        printf("    { \"rom\": \"%s\", \"frames\": %lu, \"snapshots\": %lu, \"keyframes\": %lu, "
+               "\"raw_bytes\": %zu, \"stored_bytes\": %zu, \"bytes_per_frame\": %.0f, "
+               "\"compression_ratio\": %.1f, \"capture_overhead\": %.3f, \"seek_microseconds\": %.3f }%s\n",
+            name.c_str(), stats[1].frames, history.snapshots, history.keyframes,
+            history.raw_bytes, history.stored_bytes, (double)history.stored_bytes / max(history.snapshots, 1UL),
+            history.ratio, stats[1].seconds / stats[0].seconds - 1, seconds / max(seeks, 1UL) * 1e6,
+            last ? "" : ",");
+
+        delete emulator;
+    }
+}
+
+/**
+ * Frames run for the wrap check and its budget in raw states, which no
+ * title's snapshots over that many frames fit in.
+ */
+#define WRAP_FRAMES     600UL
+#define WRAP_STATES     4
+
+/**
+ * Rewind history in a budget small enough for the ring to wrap many
+ * times: every frame's state is kept aside as it is captured, then the
+ * history is stepped back a frame at a time down to its oldest
+ * snapshot and each restored state compared with the kept one. A run
+ * whose history did not wrap, or that could not step back more than
+ * once, fails as it checked nothing.
+ */
+static void
+bench_rewind_wrap(const string &path, unsigned int interval, bool last)
+{
+    string name;
+    name = path.substr(path.find_last_of('/') + 1);
+
+    nes::emulator_t *emulator = new nes::emulator_t();
+
+    if (emulator->load(path) != 0) {
+        printf("    { \"rom\": \"%s\", \"error\": \"load failed\" }%s\n", name.c_str(), last ? "" : ",");
+        delete emulator;
+        failures++;
+        return;
+    }
+
+    unsigned long frames = WRAP_FRAMES;
+    size_t budget = WRAP_STATES * emulator->state_size();
+    emulator->enable_rewind(budget, interval);
+
+    nes::run_limits_t limits = nes::run_limits_t();
+    limits.frames = 1;
+    limits.breakpoint = -1;
+
+    vector<vector<uint8_t> > captured;
+    bool over_budget = false;
+
+    for (unsigned long i = 0; i < frames; i++) {
+        if (i % 8 == 0) {
+            emulator->set_buttons(0, rand() & 0xff);
+        }
+
+        nes::run_stats_t stats;
+        emulator->run(limits, stats);
+
+        captured.resize(emulator->frame() + 1);
+        captured[emulator->frame()].resize(emulator->state_size());
+        emulator->save_state(&captured[emulator->frame()][0]);
+
+        over_budget |= emulator->rewind_stats().stored_bytes > budget;
+    }
+
+    nes::rewind_stats_t history;
+    history = emulator->rewind_stats();
+
+    unsigned long seeks = 0, checks = 0, mismatches = 0;
+    vector<uint8_t> state(emulator->state_size());
+
+    for (;;) {
+        unsigned long frame;
+        frame = emulator->frame();
+
+        if (emulator->rewind(1) != 0) {
+            mismatches++;
+            break;
+        }
+
+        emulator->save_state(&state[0]);
+        seeks++;
+
+        if (emulator->frame() >= captured.size()) {
+            mismatches++;
+        } else if (!captured[emulator->frame()].empty()) {
+            mismatches += state != captured[emulator->frame()];
+            checks++;
+        }
+
+        if (emulator->frame() >= frame) {
+            break;
+        }
+    }
+
+    bool ok;
+    ok = !over_budget && mismatches == 0 && history.snapshots < frames && seeks > 1;
+    failures += !ok;
+
+    printf("    { \"rom\": \"%s\", \"frames\": %lu, \"budget\": %zu, \"interval\": %u, "
+           "\"snapshots\": %lu, \"stored_bytes\": %zu, \"seeks\": %lu, \"mismatches\": %lu, "
+           "\"ok\": %s }%s\n",
+        name.c_str(), frames, budget, interval, history.snapshots, history.stored_bytes, seeks, mismatches,
+        ok ? "true" : "false", last ? "" : ",");
+
+    delete emulator;
+}
+
+/**
+ * Forks of a ROM a few seconds into its run, against the round trip
+ * they replace: a fresh instance loading the ROM and a saved state.
+ */
+static void
+bench_fork(const string &path, unsigned long count, bool last)
+{
+    nes::emulator_t *emulator = new nes::emulator_t();
+    emulator->enable_block_cache(true);
+
+    string name;
+    name = path.substr(path.find_last_of('/') + 1);
+
+    if (emulator->load(path) != 0) {
+        printf("    { \"rom\": \"%s\", \"error\": \"load failed\" }%s\n", name.c_str(), last ? "" : ",");
+        delete emulator;
+        return;
+    }
+
+    nes::run_limits_t limits = nes::run_limits_t();
+    limits.frames = 300;
+    limits.breakpoint = -1;
+
+    nes::run_stats_t stats;
+    emulator->run(limits, stats);
+
+    vector<uint8_t> state(emulator->state_size());
+
+    double start, seconds[2];
+    start = now();
+
+    for (unsigned long i = 0; i < count; i++) {
+        delete emulator->fork();
+    }
+
+    seconds[0] = now() - start;
+    start = now();
+
+    for (unsigned long i = 0; i < count; i++) {
+        nes::emulator_t *copy = new nes::emulator_t();
+        copy->enable_block_cache(true);
+
+        emulator->save_state(&state[0]);
+        copy->load(path);
+        copy->load_state(&state[0], state.size());
+
+        delete copy;
+    }
+
+    seconds[1] = now() - start;
+
+    printf("    { \"rom\": \"%s\", \"forks\": %lu, \"fork_microseconds\": %.3f, "
+           "\"roundtrip_microseconds\": %.3f, \"speedup\": %.1f }%s\n",
+        name.c_str(), count, seconds[0] / count * 1e6, seconds[1] / count * 1e6,
+        seconds[1] / seconds[0], last ? "" : ",");
+
+    delete emulator;
+}
+
+/**
+ * Movie replay: frames frames are recorded from power on with
+ * pseudo-random input that changes every eight frames, then played
+ * back headless at full speed with a checkpoint on every frame, and
+ * compared with feeding the same input frame by frame without one.
+ */
+static void
+bench_replay(const string &path, unsigned long frames, bool last)
+{
+    nes::emulator_t *emulator = new nes::emulator_t();
+    emulator->enable_block_cache(true);
+
+    string name;
+    name = path.substr(path.find_last_of('/') + 1);
+
+    if (emulator->load(path) != 0) {
+        printf("    { \"rom\": \"%s\", \"error\": \"load failed\" }%s\n", name.c_str(), last ? "" : ",");
+        delete emulator;
+        return;
+    }
+
+    nes::movie_t movie;
+    emulator->record(&movie, false);
+
+    nes::run_limits_t limits = nes::run_limits_t();
+    limits.frames = 1;
+    limits.breakpoint = -1;
+
+    nes::run_stats_t stats;
+    uint32_t seed = 1;
+
+    for (unsigned long i = 0; i < frames; i++) {
+        if ((i & 7) == 0) {
+            seed = seed * 1103515245 + 12345;
+            emulator->set_buttons(0, seed >> 24);
+        }
+
+        emulator->run(limits, stats);
+    }
+
+    emulator->stop_movie();
+
+    double seconds[2];
+    seconds[0] = 0;
+
+    emulator->load(path);
+    emulator->set_buttons(0, movie.input(0)[0]);
+
+    for (unsigned long i = 0; i < movie.frames(); i++) {
+        if (i + 1 < movie.frames()) {
+            emulator->set_buttons(0, movie.input(i + 1)[0]);
+        }
+
+        emulator->run(limits, stats);
+        seconds[0] += stats.seconds;
+    }
+
+    limits.frames = 0;
+
+    emulator->play(&movie);
+    emulator->run(limits, stats);
+    seconds[1] = stats.seconds;
+
+    printf("    { \"rom\": \"%s\", \"frames\": %lu, \"movie_bytes\": %zu, \"stop\": \"%s\", "
+           "\"replayed\": %lu, \"run_frames_per_second\": %.1f, \"replay_frames_per_second\": %.1f, "
+           "\"overhead\": %.3f }%s\n",
+        name.c_str(), movie.frames(), movie.size(), reason(stats.reason), emulator->movie_frame(),
+        seconds[0] > 0 ? frames / seconds[0] : 0.0, seconds[1] > 0 ? stats.frames / seconds[1] : 0.0,
+        seconds[0] > 0 ? seconds[1] / seconds[0] - 1 : 0.0, last ? "" : ",");
+
+    delete emulator;
+}
+
+/**
+ * Resident set of the process in bytes.
+ */
+static size_t
+resident(void)
+{
+    FILE *file;
+    unsigned long size, pages = 0;
+
+    if ((file = fopen("/proc/self/statm", "r")) != NULL) {
+        if (fscanf(file, "%lu %lu", &size, &pages) != 2) {
+            pages = 0;
+        }
+
+        fclose(file);
+    }
+
+    return (pages * sysconf(_SC_PAGESIZE));
+}
+
+/**
+ * Most memory a headless instance may add to the process, measured over
+ * at least DENSITY_MINIMUM of them so the heap growing in steps evens
+ * out.
+ */
+#define DENSITY_BUDGET  (128 << 10)
+#define DENSITY_MINIMUM 16UL
+
+/**
+ * Memory an instance adds to the process: count headless instances load
+ * the ROM from its file, through the ROM cache, and run a frame so their
+ * buffers are touched. Freed heap is trimmed first so the instances
+ * cannot hide in memory released by earlier sections, and the ROM image
+ * they share is not counted. An instance over DENSITY_BUDGET fails the
+ * run.
+ */
+static void
+bench_density(const string &path, unsigned long count, bool last)
+{
+    string name;
+    name = path.substr(path.find_last_of('/') + 1);
+
+    nes::run_limits_t limits = nes::run_limits_t();
+    limits.frames = 1;
+    limits.breakpoint = -1;
+
+    count = max(count, DENSITY_MINIMUM);
+
+    vector<nes::emulator_t *> instances;
+    instances.reserve(count);
+
+    malloc_trim(0);
+
+    size_t before, shared;
+    before = resident();
+    shared = nes::rom_cache_stats().resident_bytes;
+
+    double start, seconds;
+    start = now();
+
+    for (unsigned long i = 0; i < count; i++) {
+        nes::emulator_t *emulator = new nes::emulator_t();
+        emulator->enable_block_cache(true);
+        emulator->enable_framebuffer(false);
+
+        if (emulator->load(path) != 0) {
+            delete emulator;
+            break;
+        }
+
+        instances.push_back(emulator);
+    }
+
+    seconds = now() - start;
+
+    for (size_t i = 0; i < instances.size(); i++) {
+        nes::run_stats_t stats;
+        instances[i]->run(limits, stats);
+    }
+
+    size_t after;
+    after = resident();
+
+    nes::rom_cache_stats_t cache;
+    cache = nes::rom_cache_stats();
+
+    size_t bytes;
+    bytes = after - before - min(after - before, cache.resident_bytes - min(cache.resident_bytes, shared));
+    bytes = instances.empty() ? 0 : bytes / instances.size();
+
+    bool ok;
+    ok = !instances.empty() && bytes <= DENSITY_BUDGET;
+    failures += !ok;
+
+    printf("    { \"rom\": \"%s\", \"instances\": %zu, \"bytes_per_instance\": %zu, \"budget\": %d, "
+           "\"object_bytes\": %zu, \"load_microseconds\": %.3f, \"rom_images\": %lu, "
+           "\"rom_hits\": %lu, \"rom_mapped_bytes\": %zu, \"rom_resident_bytes\": %zu, \"ok\": %s }%s\n",
+        name.c_str(), instances.size(), bytes, DENSITY_BUDGET,
+        sizeof(nes::emulator_t), instances.empty() ? 0 : seconds / instances.size() * 1e6,
+        cache.images, cache.hits, cache.mapped_bytes, cache.resident_bytes, ok ? "true" : "false",
+        last ? "" : ",");
+
+    for (size_t i = 0; i < instances.size(); i++) {
+        delete instances[i];
+    }
+}
+
+/**
+ * Aggregate throughput of a batch over the ROMs with one worker, then
+ * doubling up to one per core. The instances stay the same, two per
+ * worker of the widest run, so the scaling is against one worker.
+ */
+static void
+bench_batch(const vector<string> &paths, unsigned long frames)
+{
+    unsigned int cores;
+    cores = max(std::thread::hardware_concurrency(), 1U);
+
+    double base = 0;
+
+    for (unsigned int threads = 1;; threads = min(threads * 2, cores)) {
+        nes::batch_t batch(threads);
+
+        for (unsigned int i = 0; i < cores * 2 && !paths.empty(); i++) {
+            nes::batch_job_t job;
+            job.rom = paths[i % paths.size()];
+            job.frames = frames;
+            job.block_cache = true;
+            job.framebuffer = false;
+            job.ppu_mode = nes::ppu_scanline;
+
+            batch.add(job);
+        }
+
+        nes::batch_stats_t stats;
+        stats = batch.run();
+
+        double rate;
+        rate = stats.seconds > 0 ? stats.frames / stats.seconds : 0;
+
+        if (threads == 1) {
+            base = rate;
+        }
+
+        printf("    { \"threads\": %u, \"instances\": %zu, \"frames\": %lu, \"seconds\": %.6f, "
+               "\"frames_per_second\": %.1f, \"scaling\": %.2f, \"steals\": %lu }%s\n",
+            stats.threads, stats.instances, stats.frames, stats.seconds, rate,
+            base > 0 ? rate / base : 0.0, stats.steals, threads == cores ? "" : ",");
+
+        if (threads == cores) {
+            break;
+        }
+    }
+}
+
+static vector<string>
+roms(const char *directory)
+{
+    vector<string> paths;
+    DIR *dir;
+
+    if ((dir = opendir(directory)) == NULL) {
+        perror(directory);
+        return (paths);
+    }
+
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        size_t length;
+        length = strlen(entry->d_name);
+
+        if (length > 4 && strcmp(entry->d_name + length - 4, ".nes") == 0) {
+            paths.push_back(string(directory) + "/" + entry->d_name);
+        }
+    }
+
+    closedir(dir);
+    sort(paths.begin(), paths.end());
+
+    return (paths);
+}
+
+static void
+usage(const char *name)
+{
+    fprintf(stderr, "usage: %s [-n instructions] [-m accesses] [-l lines] [-a frames]\n"
+                    "       %*s [-s samples] [-t states] [-w frames] [-k forks] [-b frames] [-e cycles] [-i instances]\n"
+                    "       %*s [-r frames] [-c cycles] [rom ...]\n",
+        name, (int)strlen(name), "", (int)strlen(name), "");
+}
+
+int
+main(int argc, char **argv)
+{
+    unsigned long instructions = 20000000, accesses = 100000000, lines = 2000000, frames = 20000;
+    unsigned long samples = 50000000, states = 100000, history = 3600, forks = 1000, batch = 300;
+    uint64_t cycles = 100000000;
+    unsigned long lane_cycles = 200000, instances = 1000, replay = 3600;
+    int option;
+
+    while ((option = getopt(argc, argv, "n:m:l:a:s:t:w:k:b:e:i:r:c:")) != -1) {
+        switch (option) {
+            case 'n':
+                instructions = strtoul(optarg, NULL, 0);
+                break;
+
+            case 'm':
+                accesses = strtoul(optarg, NULL, 0);
+                break;
+
+            case 'l':
+                lines = strtoul(optarg, NULL, 0);
+                break;
+
+            case 'a':
+                frames = strtoul(optarg, NULL, 0);
+                break;
+
+            case 's':
+                samples = strtoul(optarg, NULL, 0);
+                break;
+
+            case 't':
+                states = strtoul(optarg, NULL, 0);
+                break;
+
+            case 'w':
+                history = strtoul(optarg, NULL, 0);
+                break;
+
+            case 'k':
+                forks = strtoul(optarg, NULL, 0);
+                break;
+
+            case 'b':
+                batch = strtoul(optarg, NULL, 0);
+                break;
+
+            case 'e':
+                lane_cycles = strtoul(optarg, NULL, 0);
+                break;
+
+            case 'i':
+                instances = strtoul(optarg, NULL, 0);
+                break;
+
+            case 'r':
+                replay = strtoul(optarg, NULL, 0);
+                break;
+
+            case 'c':
+                cycles = strtoull(optarg, NULL, 0);
+                break;
+
+            default:
+                usage(argv[0]);
+                return (1);
+        }
+    }
+
+    vector<string> paths;
+    if (optind < argc) {
+        paths.assign(argv + optind, argv + argc);
+    } else {
+        paths = roms(FREENES_ROM_DIR);
+    }
+
+    printf("{\n  \"version\": \"%s\",\n", __BUILD_VERSION__);
+
+    printf("  \"micro\": [\n");
+    for (size_t i = 0; i < sizeof micros / sizeof micros[0]; i++) {
+        bench_micro(micros[i], instructions, i + 1 == sizeof micros / sizeof micros[0]);
+    }
+    printf("  ],\n");
+
+    printf("  \"memory\": [\n");
+    bench_memory(accesses);
+    printf("  ],\n");
+
+    printf("  \"pixel\": [\n");
+    bench_pixel(lines);
+    printf("  ],\n");
+
+    printf("  \"apu\": [\n");
+    bench_apu(frames);
+    printf("  ],\n");
+
+    printf("  \"lanes\": [\n");
+    for (size_t i = 0; i < sizeof lane_counts / sizeof lane_counts[0]; i++) {
+        bench_lanes(lane_counts[i], lane_cycles, true, false);
+        bench_lanes(lane_counts[i], lane_cycles, false, i + 1 == sizeof lane_counts / sizeof lane_counts[0]);
+    }
+    printf("  ],\n");
+
+    printf("  \"audio\": [\n");
+    bench_audio(samples);
+    printf("  ],\n");
+
+    printf("  \"state\": [\n");
+    for (size_t i = 0; i < paths.size(); i++) {
+        bench_state(paths[i], states, i + 1 == paths.size());
+    }
+    printf("  ],\n");
+
+    printf("  \"rewind\": [\n");
+    for (size_t i = 0; i < paths.size(); i++) {
+        bench_rewind(paths[i], history, false);
+    }
+    for (size_t i = 0; i < paths.size(); i++) {
+        bench_rewind_wrap(paths[i], 4, i + 1 == paths.size());
+    }
+    printf("  ],\n");
+
+    printf("  \"fork\": [\n");
+    for (size_t i = 0; i < paths.size(); i++) {
+        bench_fork(paths[i], forks, i + 1 == paths.size());
+    }
+    printf("  ],\n");
+
+    printf("  \"replay\": [\n");
+    for (size_t i = 0; i < paths.size(); i++) {
+        bench_replay(paths[i], replay, i + 1 == paths.size());
+    }
+    printf("  ],\n");
+
+    printf("  \"density\": [\n");
+    for (size_t i = 0; i < paths.size(); i++) {
+        bench_density(paths[i], instances, i + 1 == paths.size());
+    }
+    printf("  ],\n");
+
+    printf("  \"batch\": [\n");
+    bench_batch(paths, batch);
+    printf("  ],\n");
+
+    printf("  \"macro\": [\n");
+    for (size_t i = 0; i < paths.size(); i++) {
+        bench_rom(paths[i], false, nes::ppu_scanline, cycles, false);
+        bench_rom(paths[i], true, nes::ppu_scanline, cycles, false);
+        bench_rom(paths[i], true, nes::ppu_dot, cycles, i + 1 == paths.size());
+    }
+    printf("  ]\n}\n");
+
+    return (failures != 0);
+}
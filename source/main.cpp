@@ -26,29 +26,352 @@
  */
 
 #include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <string>
+#include <vector>
 using namespace std;
 
+#include <getopt.h>
+#include <unistd.h>
+
+#include "trace.hpp"
+#include "nes/batch.hpp"
 #include "nes/emulator.hpp"
+#include "nes/rom_cache.hpp"
+
+static void
+usage(const char *name)
+{
+    fprintf(stderr, "usage: %s [-a] [-b] [-d] [-n instructions] [-c cycles] [-f frames]\n"
+                    "       %*s [-t seconds] [-p address] [-l count] [-v trace]\n"
+                    "       %*s [-o screenshot.ppm] [--hugepages] [--record movie | --play movie] filename\n"
+                    "       %s --batch manifest [-a] [-b] [-f frames] [-j threads] [--hugepages]\n"
+                    "\n"
+                    "  -b  run code from a block cache; on MMC3 titles, whose scanline counter\n"
+                    "      splits the CPU into short batches, it is a few percent slower than\n"
+                    "      the interpreter\n",
+        name, (int)strlen(name), "", (int)strlen(name), "", name);
+}
+
+/**
+ * Write the last frame as a binary PPM, black when no frame was drawn.
+ */
+static int
+screenshot(const char *filename, const uint32_t *framebuffer)
+{
+    FILE *file;
+
+    if ((file = fopen(filename, "wb")) == NULL) {
+        perror(filename);
+        return (1);
+    }
+
+    fprintf(file, "P6\n%d %d\n255\n", NES_SCREEN_WIDTH, NES_SCREEN_HEIGHT);
+
+    for (int i = 0; i < NES_SCREEN_WIDTH * NES_SCREEN_HEIGHT; i++) {
+        uint32_t colour;
+        colour = framebuffer != NULL ? framebuffer[i] : 0;
+
+        uint8_t pixel[3];
+        pixel[0] = colour >> 16;
+        pixel[1] = colour >> 8;
+        pixel[2] = colour;
+
+        fwrite(pixel, sizeof pixel, 1, file);
+    }
+
+    fclose(file);
+    return (0);
+}
+
+static const char *
+reason(nes::stop_reason_t reason)
+{
+    switch (reason) {
+        case nes::stop_instructions:    return ("instruction limit");
+        case nes::stop_cycles:          return ("cycle limit");
+        case nes::stop_frames:          return ("frame limit");
+        case nes::stop_seconds:         return ("time limit");
+        case nes::stop_breakpoint:      return ("breakpoint");
+        case nes::stop_movie_end:       return ("end of movie");
+        case nes::stop_desync:          return ("movie desync");
+        case nes::stop_invalid:         return ("invalid instruction");
+    }
+
+    return ("unknown");
+}
+
+/**
+ * Run every job of a manifest on a batch runner. Each line names a ROM,
+ * optionally followed by its frame count and a screenshot to write at
+ * the end; blank lines and lines starting with '#' are skipped, lines
+ * that do not fit the line buffer are an error.
+ */
+static int
+batch(const char *manifest, unsigned int threads, unsigned long frames, bool blocks, bool accurate)
+{
+    FILE *file;
+
+    if ((file = fopen(manifest, "r")) == NULL) {
+        perror(manifest);
+        return (1);
+    }
+
+    nes::batch_t runner(threads);
+    vector<string> outputs;
+    char line[1024];
+    unsigned int number = 0;
+
+    while (fgets(line, sizeof line, file) != NULL) {
+        char rom[sizeof line], output[sizeof line];
+        unsigned long count;
+        int fields;
+
+        number++;
+        output[0] = '\0';
+        count = frames;
+
+        if (strchr(line, '\n') == NULL && getc(file) != EOF) {
+            fprintf(stderr, "%s:%u: Line too long\n", manifest, number);
+            fclose(file);
+            return (1);
+        }
+
+        if ((fields = sscanf(line, "%1023s %lu %1023s", rom, &count, output)) < 1 || rom[0] == '#') {
+            continue;
+        }
+
+        if (count == 0) {
+            fprintf(stderr, "%s:%u: No frame count\n", manifest, number);
+            fclose(file);
+            return (1);
+        }
+
+        nes::batch_job_t job;
+        job.rom = rom;
+        job.frames = count;
+        job.block_cache = blocks;
+        job.framebuffer = output[0] != '\0';
+        job.ppu_mode = accurate ? nes::ppu_dot : nes::ppu_scanline;
+
+        if (runner.add(job) != 0) {
+            fprintf(stderr, "%s:%u: Cannot load %s\n", manifest, number, rom);
+            fclose(file);
+            return (1);
+        }
+
+        outputs.push_back(fields == 3 ? output : "");
+    }
+
+    fclose(file);
+
+    nes::batch_stats_t stats;
+    stats = runner.run();
+
+    int result = 0;
+
+    for (size_t i = 0; i < runner.size(); i++) {
+        const nes::batch_result_t &job = runner.result(i);
+
+        printf("%s: Stopped on %s after %lu instructions, %llu cycles, %lu frames in %.3fs\n",
+            runner.job(i).rom.c_str(), reason(job.stats.reason), job.stats.instructions,
+            (unsigned long long)job.stats.cycles, job.stats.frames, job.stats.seconds);
+
+        if (job.status != 0) {
+            result = 1;
+        }
+
+        if (!outputs[i].empty() && screenshot(outputs[i].c_str(), runner.emulator(i)->framebuffer()) != 0) {
+            result = 1;
+        }
+    }
+
+    printf("Batch of %zu instances on %u threads: %lu frames in %.3fs (%.1f frames/s), %lu quanta, %lu steals\n",
+        stats.instances, stats.threads, stats.frames, stats.seconds,
+        stats.seconds > 0 ? stats.frames / stats.seconds : 0.0, stats.quanta, stats.steals);
+
+    return (result);
+}
+
+static const struct option options[] = {
+    { "batch",      required_argument,  NULL,   'B' },
+    { "hugepages",  no_argument,        NULL,   'H' },
+    { "record",     required_argument,  NULL,   'R' },
+    { "play",       required_argument,  NULL,   'P' },
+    { NULL,         0,                  NULL,   0   },
+};
 
 int
 main(int argc, char **argv)
 {
-    if (argc != 2) {
-        fprintf(stderr, "usage: %s filename\n", argv[0]);
+    nes::run_limits_t limits = nes::run_limits_t();
+    unsigned long lockstep = 0;
+    const char *output = NULL, *manifest = NULL, *recording = NULL, *replay = NULL;
+    unsigned int threads = 0;
+    bool accurate = false, blocks = false, debugger = false;
+    int option;
+
+    limits.breakpoint = -1;
+
+    while ((option = getopt_long(argc, argv, "abdn:c:f:t:p:l:v:o:j:", options, NULL)) != -1) {
+        switch (option) {
+            case 'a':
+                accurate = true;
+                break;
+
+            case 'b':
+                blocks = true;
+                break;
+
+            case 'd':
+                debugger = true;
+                break;
+
+            case 'n':
+                limits.instructions = strtoul(optarg, NULL, 0);
+                break;
+
+            case 'c':
+                limits.cycles = strtoull(optarg, NULL, 0);
+                break;
+
+            case 'f':
+                limits.frames = strtoul(optarg, NULL, 0);
+                break;
+
+            case 't':
+                limits.seconds = strtod(optarg, NULL);
+                break;
+
+            case 'p':
+                limits.breakpoint = strtoul(optarg, NULL, 16) & 0xffff;
+                break;
+
+            case 'l':
+                lockstep = strtoul(optarg, NULL, 0);
+                break;
+
+            case 'o':
+                output = optarg;
+                break;
+
+            case 'B':
+                manifest = optarg;
+                break;
+
+            case 'R':
+                recording = optarg;
+                break;
+
+            case 'P':
+                replay = optarg;
+                break;
+
+            case 'H':
+                nes::rom_set_hugepages(true);
+                break;
+
+            case 'j':
+                threads = strtoul(optarg, NULL, 0);
+                break;
+
+            case 'v':
+                if (trace_configure(optarg) != 0) {
+                    return (1);
+                }
+                break;
+
+            default:
+                usage(argv[0]);
+                return (1);
+        }
+    }
+
+    /*
+     * A batch takes its ROMs and screenshots from the manifest and only
+     * the options that apply to every job.
+     */
+    if (manifest != NULL) {
+        if (optind != argc || output != NULL || recording != NULL || replay != NULL || debugger ||
+            lockstep != 0 || limits.instructions != 0 || limits.cycles != 0 || limits.seconds > 0 ||
+            limits.breakpoint >= 0) {
+            usage(argv[0]);
+            return (1);
+        }
+
+        return (batch(manifest, threads, limits.frames, blocks, accurate));
+    }
+
+    if (optind != argc - 1 || (recording != NULL && replay != NULL)) {
+        usage(argv[0]);
         return (1);
     }
 
     nes::emulator_t *emulator = new nes::emulator_t();
+    emulator->enable_block_cache(blocks);
+    emulator->set_ppu_mode(accurate ? nes::ppu_dot : nes::ppu_scanline);
 
-    if (emulator->load(string(argv[1]))) {
+    if (emulator->load(string(argv[optind]))) {
         return 1;
     }
 
-    if (emulator->run()) {
-        return 1;
+    if (lockstep) {
+        nes::emulator_t *reference = new nes::emulator_t();
+
+        if (reference->load(string(argv[optind]))) {
+            return 1;
+        }
+
+        return (emulator->lockstep(reference, lockstep));
+    }
+
+    if (debugger) {
+        return (emulator->debugger());
+    }
+
+    nes::movie_t movie;
+
+    if (replay != NULL && (movie.load(replay) != 0 || emulator->play(&movie) != 0)) {
+        return (1);
+    }
+
+    if (recording != NULL && emulator->record(&movie, false) != 0) {
+        return (1);
+    }
+
+    nes::run_stats_t stats;
+    int result;
+    result = emulator->run(limits, stats);
+
+    printf("Stopped on %s at %04hx: %lu instructions, %llu cycles, %lu frames in %.3fs (%.1f MIPS)\n",
+        reason(stats.reason), emulator->registers().program_counter, stats.instructions,
+        (unsigned long long)stats.cycles, stats.frames, stats.seconds,
+        stats.seconds > 0 ? stats.instructions / stats.seconds / 1e6 : 0.0);
+
+    if (replay != NULL) {
+        printf("Replayed %lu of %lu frames at %.1f frames/s\n", emulator->movie_frame(), movie.frames(),
+            stats.seconds > 0 ? stats.frames / stats.seconds : 0.0);
+
+        if (stats.reason == nes::stop_desync) {
+            fprintf(stderr, "%s: Desync after frame %lu\n", replay, emulator->movie_frame());
+            result = 1;
+        }
+    }
+
+    if (recording != NULL) {
+        if (movie.save(recording) != 0) {
+            return (1);
+        }
+
+        printf("Recorded %lu frames, %zu checkpoints, %zu bytes\n", movie.frames(), movie.checkpoints(),
+            movie.size());
+    }
+
+    if (output != NULL && screenshot(output, emulator->framebuffer()) != 0) {
+        return (1);
     }
 
     //delete(emulator);
-    return 0;
-}
\ No newline at end of file
+    return (result);
+}
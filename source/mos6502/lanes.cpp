@@ -0,0 +1,1163 @@
+/**
+ * Copyright (c) 2009 Roy van Dam <roy@8bit.cx>
+ * Copyright (c) 2009 Ed Schouten <ed@80386.nl> (original mos6502 emulator in c)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include <string.h>
+
+#include <algorithm>
+using namespace std;
+
+#include "mos6502/lanes.hpp"
+using namespace mos6502;
+
+typedef int8_t      lane8s_t  __attribute__((vector_size(_MOS_LANE_WIDTH)));
+typedef int16_t     lane16s_t __attribute__((vector_size(_MOS_LANE_WIDTH * 2)));
+
+/**
+ * Scalar core on a single lane, for the lanes that diverged. Registers
+ * are copied in from the lane arrays before a step and back after it.
+ */
+class lane_core_t : public core_t<lane_core_t>
+{
+    public:
+        lanes_t    *lanes;
+        size_t      lane;
+
+        uint8_t     read_byte   (uint16_t address) { return (this->lanes->peek(this->lane, address)); }
+        void        write_byte  (uint16_t address, uint8_t value) { this->lanes->poke(this->lane, address, value); }
+        bool        read_only   (uint16_t address) { return (false); }
+        const uint8_t *code_page (uint16_t address) { return (NULL); }
+};
+
+static inline lane8_t
+load8(const uint8_t *source)
+{
+    lane8_t value;
+    memcpy(&value, source, sizeof value);
+
+    return (value);
+}
+
+static inline void
+store8(uint8_t *destination, lane8_t value)
+{
+    memcpy(destination, &value, sizeof value);
+}
+
+/**
+ * Width changes. Comparison results are all ones or all zeros per lane,
+ * the mask versions keep them that way. Macros rather than functions,
+ * as 16 bit lane vectors are never passed by value.
+ */
+#define _LANE_WIDEN(value)          __builtin_convertvector((value), lane16_t)
+#define _LANE_WIDEN_MASK(mask)      ((lane16_t)__builtin_convertvector((lane8s_t)(mask), lane16s_t))
+#define _LANE_WORD(low, high)       (_LANE_WIDEN(low) | _LANE_WIDEN(high) << 8)
+
+static inline lane8_t
+narrow(const lane16_t &value)
+{
+    return (__builtin_convertvector(value, lane8_t));
+}
+
+static inline lane8_t
+narrow_mask(const lane16s_t &mask)
+{
+    return ((lane8_t)__builtin_convertvector(mask, lane8s_t));
+}
+
+static inline lane8_t
+blend(lane8_t mask, lane8_t value, lane8_t old)
+{
+    return ((value & mask) | (old & ~mask));
+}
+
+static inline bool
+any(lane8_t mask)
+{
+    uint64_t half[2];
+    memcpy(half, &mask, sizeof half);
+
+    return ((half[0] | half[1]) != 0);
+}
+
+static inline bool
+uniform(const lane16_t &address)
+{
+    lane16_t difference;
+    difference = address ^ address[0];
+
+    uint64_t quarter[4];
+    memcpy(quarter, &difference, sizeof quarter);
+
+    return ((quarter[0] | quarter[1] | quarter[2] | quarter[3]) == 0);
+}
+
+/**
+ * Lanes start out like a freshly constructed core, call reset() to
+ * load the reset vector. The ROM occupies the top rom_size bytes of the
+ * address space and RAM the bottom, up to where the ROM starts.
+ */
+lanes_t::lanes_t(size_t lanes, const uint8_t *rom, size_t rom_size, size_t ram_size)
+{
+    rom_size = min(rom_size, (size_t)0x10000);
+
+    this->_lanes = lanes;
+    this->_stride = (lanes + _MOS_LANE_WIDTH - 1) / _MOS_LANE_WIDTH * _MOS_LANE_WIDTH;
+    this->_rom = rom;
+    this->_rom_base = 0x10000 - rom_size;
+    this->_ram_size = min(ram_size, (size_t)this->_rom_base);
+
+    this->_accumulator.assign(this->_stride, 0);
+    this->_index_x.assign(this->_stride, 0);
+    this->_index_y.assign(this->_stride, 0);
+    this->_stack_pointer.assign(this->_stride, 0);
+    this->_status_flag.assign(this->_stride, 0);
+    this->_program_counter.assign(this->_stride, 32768);
+    this->_cycles.assign(this->_stride, 0);
+    this->_target.assign(this->_stride, 0);
+    this->_group.assign(this->_stride, 0);
+    this->_ram.assign(this->_ram_size * this->_stride, 0);
+
+    /* Padding up to a whole block never runs. */
+    this->_halted.assign(this->_stride, 1);
+    fill(this->_halted.begin(), this->_halted.begin() + lanes, 0);
+
+    this->_leader = 0;
+    this->_first = 0;
+    this->_members = 0;
+    this->_converged = false;
+    this->_finished = false;
+    this->_split = false;
+    this->_next = 0;
+    this->_stats = lanes_stats_t();
+}
+
+/**
+ * Reset sequence on every lane, as core_t::reset().
+ */
+void
+lanes_t::reset(void)
+{
+    for (size_t i = 0; i < this->_lanes; i++) {
+        this->_stack_pointer[i] = 0xfd;
+        this->_status_flag[i] |= _MOS_RF_NOINTERRUPT;
+        this->_program_counter[i] = this->peek(i, 0xfffc) | (uint16_t)this->peek(i, 0xfffd) << 8;
+        this->_cycles[i] += 7;
+    }
+}
+
+void
+lanes_t::save(size_t lane, state_t &state) const
+{
+    state.registers.program_counter = this->_program_counter[lane];
+    state.registers.accumulator = this->_accumulator[lane];
+    state.registers.index_x = this->_index_x[lane];
+    state.registers.index_y = this->_index_y[lane];
+    state.registers.stack_pointer = this->_stack_pointer[lane];
+    state.registers.status_flag = this->_status_flag[lane];
+    state.cycles = this->_cycles[lane];
+}
+
+void
+lanes_t::load(size_t lane, const state_t &state)
+{
+    this->_program_counter[lane] = state.registers.program_counter;
+    this->_accumulator[lane] = state.registers.accumulator;
+    this->_index_x[lane] = state.registers.index_x;
+    this->_index_y[lane] = state.registers.index_y;
+    this->_stack_pointer[lane] = state.registers.stack_pointer;
+    this->_status_flag[lane] = state.registers.status_flag;
+    this->_cycles[lane] = state.cycles;
+}
+
+/**
+ * Whether the lane stopped on an invalid instruction.
+ */
+bool
+lanes_t::halted(size_t lane) const
+{
+    return (this->_halted[lane] != 0);
+}
+
+lanes_stats_t
+lanes_t::stats(void) const
+{
+    lanes_stats_t stats;
+    stats = this->_stats;
+    stats.divergence = stats.steps ? (double)stats.diverged_steps / stats.steps : 0;
+
+    return (stats);
+}
+
+/**
+ * Run every lane until at least count more cycles have passed on it,
+ * as core_t::run_cycles(). Returns -1 when a lane hit an invalid
+ * instruction; it stays halted and the others run on.
+ */
+int
+lanes_t::run_cycles(unsigned long count)
+{
+    for (size_t i = 0; i < this->_lanes; i++) {
+        this->_target[i] = this->_cycles[i] + count;
+    }
+
+    this->_converged = false;
+
+    for (;;) {
+        if (!this->_converged && this->_select() == 0) {
+            break;
+        }
+
+        uint8_t instruction;
+        instruction = this->peek(this->_first, this->_leader);
+
+        this->_stats.steps++;
+
+        if (this->_members > 1 && this->_leader >= this->_rom_base && _kernels[instruction] != NULL) {
+            this->_vector(instruction);
+            continue;
+        }
+
+        for (size_t i = this->_first; i < this->_lanes; i++) {
+            if (this->_group[i]) {
+                this->_scalar(i);
+            }
+        }
+
+        this->_converged = false;
+    }
+
+    for (size_t i = 0; i < this->_lanes; i++) {
+        if (this->_halted[i]) {
+            return (-1);
+        }
+    }
+
+    return (0);
+}
+
+/**
+ * Pick the lanes that run next: of those still running, the ones at
+ * the lowest program counter. Lanes behind on a forward branch catch
+ * up with the ones that skipped ahead, and lanes still in a loop run
+ * it out before the ones that left it go on. Returns the number of
+ * lanes still running.
+ */
+size_t
+lanes_t::_select(void)
+{
+    size_t running = 0;
+    uint16_t leader = 0;
+
+    for (size_t i = 0; i < this->_lanes; i++) {
+        if (this->_halted[i] || this->_cycles[i] >= this->_target[i]) {
+            continue;
+        }
+
+        if (running == 0 || this->_program_counter[i] < leader) {
+            leader = this->_program_counter[i];
+        }
+
+        running++;
+    }
+
+    this->_leader = leader;
+    this->_members = 0;
+
+    for (size_t i = 0; i < this->_lanes; i++) {
+        bool member;
+        member = !this->_halted[i] && this->_cycles[i] < this->_target[i] &&
+            this->_program_counter[i] == leader;
+
+        if (member && this->_members++ == 0) {
+            this->_first = i;
+        }
+
+        this->_group[i] = member ? 0xff : 0x00;
+    }
+
+    this->_converged = running > 0 && this->_members == running;
+
+    if (running > 0 && !this->_converged) {
+        this->_stats.diverged_steps++;
+    }
+
+    return (running);
+}
+
+/**
+ * Run one instruction on every selected lane, a block of lanes at a
+ * time. The lanes stay together unless they end up at different
+ * addresses or one of them reaches its cycle target.
+ */
+void
+lanes_t::_vector(uint8_t instruction)
+{
+    uint16_t operand;
+    operand = this->peek(this->_first, this->_leader + 1);
+
+    if (_length[instruction] == 3) {
+        operand |= (uint16_t)this->peek(this->_first, this->_leader + 2) << 8;
+    }
+
+    uint16_t next;
+    next = this->_leader + _length[instruction];
+
+    _kernel_t kernel;
+    kernel = _kernels[instruction];
+
+    this->_finished = false;
+    this->_split = false;
+
+    for (size_t base = 0; base < this->_stride; base += _MOS_LANE_WIDTH) {
+        block_t block;
+        block.mask = load8(&this->_group[base]);
+
+        if (!any(block.mask)) {
+            continue;
+        }
+
+        this->_load_block(block, base);
+        block.program_counter = (lane16_t){} + next;
+
+        kernel(this, block, operand);
+        this->_store_block(block, _base_cycles[instruction]);
+    }
+
+    this->_stats.vector_steps++;
+    this->_stats.vector_instructions += this->_members;
+
+    if (this->_finished || this->_split) {
+        this->_converged = false;
+    } else {
+        this->_leader = this->_next;
+    }
+}
+
+/**
+ * One instruction on one lane through the scalar core.
+ */
+void
+lanes_t::_scalar(size_t lane)
+{
+    lane_core_t core;
+    core.lanes = this;
+    core.lane = lane;
+
+    state_t state;
+    this->save(lane, state);
+    core.load(state);
+
+    this->_stats.scalar_instructions++;
+
+    if (core.step() != 0) {
+        this->_halted[lane] = 1;
+        return;
+    }
+
+    core.save(state);
+    this->load(lane, state);
+}
+
+void
+lanes_t::_load_block(block_t &block, size_t base) const
+{
+    block.base = base;
+    block.accumulator = load8(&this->_accumulator[base]);
+    block.index_x = load8(&this->_index_x[base]);
+    block.index_y = load8(&this->_index_y[base]);
+    block.stack_pointer = load8(&this->_stack_pointer[base]);
+    block.status_flag = load8(&this->_status_flag[base]);
+    block.extra = (lane8_t){};
+}
+
+/**
+ * Write back the registers of the selected lanes and charge them the
+ * cycles of the instruction, noting whether they still agree on the
+ * program counter with the first of them.
+ */
+void
+lanes_t::_store_block(const block_t &block, uint8_t cycles)
+{
+    size_t base;
+    base = block.base;
+
+    lane8_t mask;
+    mask = block.mask;
+
+    store8(&this->_accumulator[base], blend(mask, block.accumulator, load8(&this->_accumulator[base])));
+    store8(&this->_index_x[base], blend(mask, block.index_x, load8(&this->_index_x[base])));
+    store8(&this->_index_y[base], blend(mask, block.index_y, load8(&this->_index_y[base])));
+    store8(&this->_stack_pointer[base], blend(mask, block.stack_pointer, load8(&this->_stack_pointer[base])));
+    store8(&this->_status_flag[base], blend(mask, block.status_flag, load8(&this->_status_flag[base])));
+
+    lane16_t wide, old;
+    wide = _LANE_WIDEN_MASK(mask);
+    memcpy(&old, &this->_program_counter[base], sizeof old);
+
+    old = (block.program_counter & wide) | (old & ~wide);
+    memcpy(&this->_program_counter[base], &old, sizeof old);
+
+    if (this->_first >= base && this->_first < base + _MOS_LANE_WIDTH) {
+        this->_next = block.program_counter[this->_first - base];
+    }
+
+    this->_split |= any(mask & narrow_mask(block.program_counter != this->_next));
+
+    uint64_t finished = 0;
+
+    for (size_t i = 0; i < _MOS_LANE_WIDTH; i++) {
+        uint64_t selected, count;
+        selected = -(uint64_t)(mask[i] & 1);
+        count = this->_cycles[base + i] + ((cycles + block.extra[i]) & selected);
+
+        this->_cycles[base + i] = count;
+        finished |= (count >= this->_target[base + i]) & selected;
+    }
+
+    this->_finished |= finished != 0;
+}
+
+lane8_t
+lanes_t::_row(uint16_t address, size_t base) const
+{
+    if (address < this->_ram_size) {
+        return (load8(&this->_ram[address * this->_stride + base]));
+    }
+
+    if (address >= this->_rom_base) {
+        return ((lane8_t){} + this->_rom[address - this->_rom_base]);
+    }
+
+    return ((lane8_t){});
+}
+
+void
+lanes_t::_write_row(uint16_t address, const block_t &block, lane8_t value)
+{
+    if (address < this->_ram_size) {
+        uint8_t *row;
+        row = &this->_ram[address * this->_stride + block.base];
+
+        store8(row, blend(block.mask, value, load8(row)));
+    }
+}
+
+lane8_t
+lanes_t::_gather(const lane16_t &address, size_t base) const
+{
+    if (uniform(address)) {
+        return (this->_row(address[0], base));
+    }
+
+    lane8_t value;
+
+    for (size_t i = 0; i < _MOS_LANE_WIDTH; i++) {
+        value[i] = this->peek(base + i, address[i]);
+    }
+
+    return (value);
+}
+
+void
+lanes_t::_scatter(const lane16_t &address, const block_t &block, lane8_t value)
+{
+    if (uniform(address)) {
+        this->_write_row(address[0], block, value);
+        return;
+    }
+
+    for (size_t i = 0; i < _MOS_LANE_WIDTH; i++) {
+        if (block.mask[i]) {
+            this->poke(block.base + i, address[i], value[i]);
+        }
+    }
+}
+
+/**
+ * Effective address per lane, as the scalar addressing conventions:
+ * zero page indexing does not wrap and indexed modes flag a page
+ * crossing per lane.
+ */
+template <int mode>
+void
+lanes_t::_address(lanes_t *self, block_t &block, uint16_t operand, lane8_t &cross, lane16_t &location)
+{
+    lane16_t base, pointer;
+    base = (lane16_t){} + operand;
+
+    switch (mode) {
+        case _mode_zpgx:
+        case _mode_absx:
+            location = base + _LANE_WIDEN(block.index_x);
+            break;
+
+        case _mode_zpgy:
+        case _mode_absy:
+            location = base + _LANE_WIDEN(block.index_y);
+            break;
+
+        case _mode_xind:
+            pointer = base + _LANE_WIDEN(block.index_x);
+            location = _LANE_WORD(self->_gather(pointer, block.base), self->_gather(pointer + 1, block.base));
+            break;
+
+        case _mode_indy:
+            base = _LANE_WORD(self->_row(operand, block.base), self->_row(operand + 1, block.base));
+            location = base + _LANE_WIDEN(block.index_y);
+            break;
+
+        default:
+            location = base;
+            break;
+    }
+
+    if (mode == _mode_absx || mode == _mode_absy || mode == _mode_indy) {
+        cross = narrow_mask(((location ^ base) >> 8) != 0) & 1;
+    }
+}
+
+template <int mode>
+lane8_t
+lanes_t::_read(lanes_t *self, block_t &block, uint16_t operand, const lane16_t &location)
+{
+    if (mode == _mode_zpg || mode == _mode_abs) {
+        return (self->_row(operand, block.base));
+    }
+
+    return (self->_gather(location, block.base));
+}
+
+template <int mode>
+void
+lanes_t::_write(lanes_t *self, block_t &block, uint16_t operand, const lane16_t &location, lane8_t value)
+{
+    if (mode == _mode_zpg || mode == _mode_abs) {
+        self->_write_row(operand, block, value);
+    } else {
+        self->_scatter(location, block, value);
+    }
+}
+
+void
+lanes_t::_push(lanes_t *self, block_t &block, lane8_t value)
+{
+    lane16_t address;
+    address = _LANE_WIDEN(block.stack_pointer) + 0x100;
+
+    self->_scatter(address, block, value);
+    block.stack_pointer -= 1;
+}
+
+lane8_t
+lanes_t::_pop(lanes_t *self, block_t &block)
+{
+    block.stack_pointer += 1;
+
+    lane16_t address;
+    address = _LANE_WIDEN(block.stack_pointer) + 0x100;
+
+    return (self->_gather(address, block.base));
+}
+
+void
+lanes_t::_push_word(lanes_t *self, block_t &block, const lane16_t &value)
+{
+    _push(self, block, narrow(value >> 8));
+    _push(self, block, narrow(value));
+}
+
+void
+lanes_t::_pop_word(lanes_t *self, block_t &block, lane16_t &value)
+{
+    lane8_t low;
+    low = _pop(self, block);
+
+    value = _LANE_WORD(low, _pop(self, block));
+}
+
+template <int mode, lanes_t::_ins_load_t instruction>
+void
+lanes_t::_load(lanes_t *self, block_t &block, uint16_t operand)
+{
+    lane8_t value;
+
+    if (mode == _mode_imm) {
+        value = (lane8_t){} + (uint8_t)operand;
+    } else {
+        lane8_t cross = {};
+        lane16_t location;
+        _address<mode>(self, block, operand, cross, location);
+        value = _read<mode>(self, block, operand, location);
+
+        /* As in the core, only indexed reads pay for a page crossing. */
+        block.extra += cross;
+    }
+
+    instruction(self, block, value);
+}
+
+template <int mode, lanes_t::_ins_store_t instruction>
+void
+lanes_t::_store(lanes_t *self, block_t &block, uint16_t operand)
+{
+    lane8_t cross;
+    lane16_t location;
+    _address<mode>(self, block, operand, cross, location);
+
+    _write<mode>(self, block, operand, location, instruction(self, block));
+}
+
+template <int mode, lanes_t::_ins_load_store_t instruction>
+void
+lanes_t::_load_store(lanes_t *self, block_t &block, uint16_t operand)
+{
+    lane8_t cross;
+    lane16_t location;
+    _address<mode>(self, block, operand, cross, location);
+
+    lane8_t value;
+    value = _read<mode>(self, block, operand, location);
+
+    _write<mode>(self, block, operand, location, instruction(self, block, value));
+}
+
+template <lanes_t::_ins_load_store_t instruction>
+void
+lanes_t::_load_store_acc(lanes_t *self, block_t &block, uint16_t operand)
+{
+    block.accumulator = instruction(self, block, block.accumulator);
+}
+
+template <int mode, lanes_t::_ins_load_word_t instruction>
+void
+lanes_t::_load_word(lanes_t *self, block_t &block, uint16_t operand)
+{
+    lane16_t value;
+    value = _LANE_WORD(self->_row(operand, block.base), self->_row(operand + 1, block.base));
+
+    instruction(self, block, value);
+}
+
+template <lanes_t::_ins_load_word_t instruction>
+void
+lanes_t::_load_word_imm(lanes_t *self, block_t &block, uint16_t operand)
+{
+    lane16_t value;
+    value = (lane16_t){} + operand;
+
+    instruction(self, block, value);
+}
+
+template <lanes_t::_ins_noarg_t instruction>
+void
+lanes_t::_noarg(lanes_t *self, block_t &block, uint16_t operand)
+{
+    instruction(self, block);
+}
+
+void
+lanes_t::_nop(lanes_t *self, block_t &block, uint16_t operand)
+{
+}
+
+void
+lanes_t::_flags_nz(block_t &block, lane8_t value)
+{
+    block.status_flag = (block.status_flag & (uint8_t)~(_MOS_RF_NEGATIVE | _MOS_RF_ZERO)) |
+        (value & _MOS_RF_NEGATIVE) | ((lane8_t)(value == 0) & _MOS_RF_ZERO);
+}
+
+void
+lanes_t::_compare(block_t &block, lane8_t a, lane8_t b)
+{
+    block.status_flag = (block.status_flag & (uint8_t)~(_MOS_RF_CARRY | _MOS_RF_NEGATIVE | _MOS_RF_ZERO)) |
+        ((lane8_t)(a >= b) & _MOS_RF_CARRY) | ((a - b) & _MOS_RF_NEGATIVE) |
+        ((lane8_t)(a == b) & _MOS_RF_ZERO);
+}
+
+/**
+ * Taken branches cost a cycle, two when the target is on another page.
+ */
+void
+lanes_t::_branch(block_t &block, lane8_t taken, lane8_t value)
+{
+    lane16_t target;
+    target = block.program_counter + (lane16_t)__builtin_convertvector((lane8s_t)value, lane16s_t);
+
+    lane8_t cross;
+    cross = narrow_mask(((block.program_counter ^ target) >> 8) != 0);
+
+    block.extra += taken & (1 + (cross & 1));
+
+    lane16_t jump;
+    jump = _LANE_WIDEN_MASK(taken);
+
+    block.program_counter = (target & jump) | (block.program_counter & ~jump);
+}
+
+#define _LANE_SET(block, flag)      ((lane8_t)(((block).status_flag & (flag)) != 0))
+#define _LANE_CLEAR(block, flag)    ((lane8_t)(((block).status_flag & (flag)) == 0))
+
+void
+lanes_t::_ins_adc(lanes_t *self, block_t &block, lane8_t value)
+{
+    lane16_t sum;
+    sum = _LANE_WIDEN(block.accumulator) + _LANE_WIDEN(value) + _LANE_WIDEN(block.status_flag & _MOS_RF_CARRY);
+
+    lane8_t result;
+    result = narrow(sum);
+
+    lane8_t overflow;
+    overflow = ((block.accumulator ^ result) & (value ^ result) & 0x80) >> 1;
+
+    block.status_flag = (block.status_flag & (uint8_t)~(_MOS_RF_CARRY | _MOS_RF_OVERFLOW)) |
+        narrow(sum >> 8) | overflow;
+    block.accumulator = result;
+
+    _flags_nz(block, block.accumulator);
+}
+
+void
+lanes_t::_ins_and(lanes_t *self, block_t &block, lane8_t value)
+{
+    block.accumulator &= value;
+    _flags_nz(block, block.accumulator);
+}
+
+lane8_t
+lanes_t::_ins_asl(lanes_t *self, block_t &block, lane8_t value)
+{
+    block.status_flag = (block.status_flag & (uint8_t)~_MOS_RF_CARRY) | (value >> 7);
+    value <<= 1;
+
+    _flags_nz(block, value);
+    return (value);
+}
+
+void
+lanes_t::_ins_bit(lanes_t *self, block_t &block, lane8_t value)
+{
+    block.status_flag = (block.status_flag & (uint8_t)~(_MOS_RF_NEGATIVE | _MOS_RF_OVERFLOW | _MOS_RF_ZERO)) |
+        (value & (_MOS_RF_NEGATIVE | _MOS_RF_OVERFLOW)) |
+        ((lane8_t)((block.accumulator & value) == 0) & _MOS_RF_ZERO);
+}
+
+void
+lanes_t::_ins_bcc(lanes_t *self, block_t &block, lane8_t value)
+{
+    _branch(block, _LANE_CLEAR(block, _MOS_RF_CARRY), value);
+}
+
+void
+lanes_t::_ins_bcs(lanes_t *self, block_t &block, lane8_t value)
+{
+    _branch(block, _LANE_SET(block, _MOS_RF_CARRY), value);
+}
+
+void
+lanes_t::_ins_beq(lanes_t *self, block_t &block, lane8_t value)
+{
+    _branch(block, _LANE_SET(block, _MOS_RF_ZERO), value);
+}
+
+void
+lanes_t::_ins_bmi(lanes_t *self, block_t &block, lane8_t value)
+{
+    _branch(block, _LANE_SET(block, _MOS_RF_NEGATIVE), value);
+}
+
+void
+lanes_t::_ins_bne(lanes_t *self, block_t &block, lane8_t value)
+{
+    _branch(block, _LANE_CLEAR(block, _MOS_RF_ZERO), value);
+}
+
+void
+lanes_t::_ins_bpl(lanes_t *self, block_t &block, lane8_t value)
+{
+    _branch(block, _LANE_CLEAR(block, _MOS_RF_NEGATIVE), value);
+}
+
+void
+lanes_t::_ins_brk(lanes_t *self, block_t &block)
+{
+    block.status_flag |= _MOS_RF_BREAK;
+
+    _push_word(self, block, block.program_counter);
+    _push(self, block, block.status_flag);
+    block.status_flag |= _MOS_RF_NOINTERRUPT;
+
+    block.program_counter = _LANE_WORD(self->_row(0xfffe, block.base), self->_row(0xffff, block.base));
+}
+
+void
+lanes_t::_ins_bvc(lanes_t *self, block_t &block, lane8_t value)
+{
+    _branch(block, _LANE_CLEAR(block, _MOS_RF_OVERFLOW), value);
+}
+
+void
+lanes_t::_ins_bvs(lanes_t *self, block_t &block, lane8_t value)
+{
+    _branch(block, _LANE_SET(block, _MOS_RF_OVERFLOW), value);
+}
+
+void
+lanes_t::_ins_clc(lanes_t *self, block_t &block)
+{
+    block.status_flag &= (uint8_t)~_MOS_RF_CARRY;
+}
+
+void
+lanes_t::_ins_cld(lanes_t *self, block_t &block)
+{
+    block.status_flag &= (uint8_t)~_MOS_RF_DECIMAL;
+}
+
+void
+lanes_t::_ins_cli(lanes_t *self, block_t &block)
+{
+    block.status_flag &= (uint8_t)~_MOS_RF_NOINTERRUPT;
+}
+
+void
+lanes_t::_ins_clv(lanes_t *self, block_t &block)
+{
+    block.status_flag &= (uint8_t)~_MOS_RF_OVERFLOW;
+}
+
+void
+lanes_t::_ins_cmp(lanes_t *self, block_t &block, lane8_t value)
+{
+    _compare(block, block.accumulator, value);
+}
+
+void
+lanes_t::_ins_cpx(lanes_t *self, block_t &block, lane8_t value)
+{
+    _compare(block, block.index_x, value);
+}
+
+void
+lanes_t::_ins_cpy(lanes_t *self, block_t &block, lane8_t value)
+{
+    _compare(block, block.index_y, value);
+}
+
+lane8_t
+lanes_t::_ins_dec(lanes_t *self, block_t &block, lane8_t value)
+{
+    value -= 1;
+    _flags_nz(block, value);
+
+    return (value);
+}
+
+void
+lanes_t::_ins_dex(lanes_t *self, block_t &block)
+{
+    block.index_x -= 1;
+    _flags_nz(block, block.index_x);
+}
+
+void
+lanes_t::_ins_dey(lanes_t *self, block_t &block)
+{
+    block.index_y -= 1;
+    _flags_nz(block, block.index_y);
+}
+
+void
+lanes_t::_ins_eor(lanes_t *self, block_t &block, lane8_t value)
+{
+    block.accumulator ^= value;
+    _flags_nz(block, block.accumulator);
+}
+
+lane8_t
+lanes_t::_ins_inc(lanes_t *self, block_t &block, lane8_t value)
+{
+    value += 1;
+    _flags_nz(block, value);
+
+    return (value);
+}
+
+void
+lanes_t::_ins_inx(lanes_t *self, block_t &block)
+{
+    block.index_x += 1;
+    _flags_nz(block, block.index_x);
+}
+
+void
+lanes_t::_ins_iny(lanes_t *self, block_t &block)
+{
+    block.index_y += 1;
+    _flags_nz(block, block.index_y);
+}
+
+void
+lanes_t::_ins_jmp(lanes_t *self, block_t &block, const lane16_t &value)
+{
+    block.program_counter = value;
+}
+
+void
+lanes_t::_ins_jsr(lanes_t *self, block_t &block, const lane16_t &value)
+{
+    lane16_t back;
+    back = block.program_counter - 1;
+
+    _push_word(self, block, back);
+    block.program_counter = value;
+}
+
+void
+lanes_t::_ins_lda(lanes_t *self, block_t &block, lane8_t value)
+{
+    block.accumulator = value;
+    _flags_nz(block, block.accumulator);
+}
+
+void
+lanes_t::_ins_ldx(lanes_t *self, block_t &block, lane8_t value)
+{
+    block.index_x = value;
+    _flags_nz(block, block.index_x);
+}
+
+void
+lanes_t::_ins_ldy(lanes_t *self, block_t &block, lane8_t value)
+{
+    block.index_y = value;
+    _flags_nz(block, block.index_y);
+}
+
+/**
+ * Leaves the negative flag alone, as the scalar core does.
+ */
+lane8_t
+lanes_t::_ins_lsr(lanes_t *self, block_t &block, lane8_t value)
+{
+    lane8_t result;
+    result = value >> 1;
+
+    block.status_flag = (block.status_flag & (uint8_t)~(_MOS_RF_CARRY | _MOS_RF_ZERO)) |
+        (value & _MOS_RF_CARRY) | ((lane8_t)(result == 0) & _MOS_RF_ZERO);
+
+    return (result);
+}
+
+void
+lanes_t::_ins_ora(lanes_t *self, block_t &block, lane8_t value)
+{
+    block.accumulator |= value;
+    _flags_nz(block, block.accumulator);
+}
+
+void
+lanes_t::_ins_pha(lanes_t *self, block_t &block)
+{
+    _push(self, block, block.accumulator);
+}
+
+void
+lanes_t::_ins_php(lanes_t *self, block_t &block)
+{
+    _push(self, block, block.status_flag | _MOS_RF_BREAK | 0x20);
+}
+
+void
+lanes_t::_ins_pla(lanes_t *self, block_t &block)
+{
+    block.accumulator = _pop(self, block);
+    _flags_nz(block, block.accumulator);
+}
+
+void
+lanes_t::_ins_plp(lanes_t *self, block_t &block)
+{
+    block.status_flag = _pop(self, block);
+}
+
+lane8_t
+lanes_t::_ins_rol(lanes_t *self, block_t &block, lane8_t value)
+{
+    lane8_t result;
+    result = (value << 1) | (block.status_flag & _MOS_RF_CARRY);
+
+    block.status_flag = (block.status_flag & (uint8_t)~_MOS_RF_CARRY) | (value >> 7);
+    _flags_nz(block, result);
+
+    return (result);
+}
+
+lane8_t
+lanes_t::_ins_ror(lanes_t *self, block_t &block, lane8_t value)
+{
+    lane8_t result;
+    result = (value >> 1) | (block.status_flag & _MOS_RF_CARRY) << 7;
+
+    block.status_flag = (block.status_flag & (uint8_t)~_MOS_RF_CARRY) | (value & _MOS_RF_CARRY);
+    _flags_nz(block, result);
+
+    return (result);
+}
+
+void
+lanes_t::_ins_rti(lanes_t *self, block_t &block)
+{
+    block.status_flag = _pop(self, block);
+    _pop_word(self, block, block.program_counter);
+}
+
+void
+lanes_t::_ins_rts(lanes_t *self, block_t &block)
+{
+    _pop_word(self, block, block.program_counter);
+    block.program_counter += 1;
+}
+
+void
+lanes_t::_ins_sbc(lanes_t *self, block_t &block, lane8_t value)
+{
+    _ins_adc(self, block, ~value);
+}
+
+void
+lanes_t::_ins_sec(lanes_t *self, block_t &block)
+{
+    block.status_flag |= _MOS_RF_CARRY;
+}
+
+void
+lanes_t::_ins_sed(lanes_t *self, block_t &block)
+{
+    block.status_flag |= _MOS_RF_DECIMAL;
+}
+
+void
+lanes_t::_ins_sei(lanes_t *self, block_t &block)
+{
+    block.status_flag |= _MOS_RF_NOINTERRUPT;
+}
+
+lane8_t
+lanes_t::_ins_sta(lanes_t *self, block_t &block)
+{
+    return (block.accumulator);
+}
+
+lane8_t
+lanes_t::_ins_stx(lanes_t *self, block_t &block)
+{
+    return (block.index_x);
+}
+
+lane8_t
+lanes_t::_ins_sty(lanes_t *self, block_t &block)
+{
+    return (block.index_y);
+}
+
+void
+lanes_t::_ins_tax(lanes_t *self, block_t &block)
+{
+    block.index_x = block.accumulator;
+    _flags_nz(block, block.index_x);
+}
+
+void
+lanes_t::_ins_tay(lanes_t *self, block_t &block)
+{
+    block.index_y = block.accumulator;
+    _flags_nz(block, block.index_y);
+}
+
+void
+lanes_t::_ins_tsx(lanes_t *self, block_t &block)
+{
+    block.index_x = block.stack_pointer;
+    _flags_nz(block, block.index_x);
+}
+
+void
+lanes_t::_ins_txa(lanes_t *self, block_t &block)
+{
+    block.accumulator = block.index_x;
+    _flags_nz(block, block.accumulator);
+}
+
+void
+lanes_t::_ins_txs(lanes_t *self, block_t &block)
+{
+    block.stack_pointer = block.index_x;
+}
+
+void
+lanes_t::_ins_tya(lanes_t *self, block_t &block)
+{
+    block.accumulator = block.index_y;
+    _flags_nz(block, block.accumulator);
+}
+
+#define _MOS_LANE_noarg(mode, instruction) \
+    &lanes_t::_noarg<&lanes_t::_ins_##instruction>
+#define _MOS_LANE_load(mode, instruction) \
+    &lanes_t::_load<lanes_t::_mode_##mode, &lanes_t::_ins_##instruction>
+#define _MOS_LANE_load_imm(mode, instruction) \
+    &lanes_t::_load<lanes_t::_mode_imm, &lanes_t::_ins_##instruction>
+#define _MOS_LANE_store(mode, instruction) \
+    &lanes_t::_store<lanes_t::_mode_##mode, &lanes_t::_ins_##instruction>
+#define _MOS_LANE_load_store(mode, instruction) \
+    &lanes_t::_load_store<lanes_t::_mode_##mode, &lanes_t::_ins_##instruction>
+#define _MOS_LANE_load_store_acc(mode, instruction) \
+    &lanes_t::_load_store_acc<&lanes_t::_ins_##instruction>
+#define _MOS_LANE_load_word(mode, instruction) \
+    &lanes_t::_load_word<lanes_t::_mode_##mode, &lanes_t::_ins_##instruction>
+#define _MOS_LANE_load_word_imm(mode, instruction) \
+    &lanes_t::_load_word_imm<&lanes_t::_ins_##instruction>
+#define _MOS_LANE_nop(mode, instruction) \
+    &lanes_t::_nop
+#define _MOS_LANE_invalid(mode, instruction) \
+    NULL
+
+#define _MOS_LANE(code, family, mode, instruction, cycles) \
+    _MOS_LANE_##family(mode, instruction),
+
+const lanes_t::_kernel_t lanes_t::_kernels[256] = {
+    _MOS_OPCODES(_MOS_LANE)
+};
+
+const uint8_t lanes_t::_base_cycles[256] = {
+    _MOS_OPCODES(_MOS_CYCLES)
+};
+
+const uint8_t lanes_t::_length[256] = {
+    _MOS_OPCODES(_MOS_LENGTH)
+};
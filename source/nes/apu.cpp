@@ -0,0 +1,1041 @@
+/**
+ * Copyright (c) 2009 Roy van Dam <roy@8bit.cx>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include <assert.h>
+#include <math.h>
+#include <string.h>
+
+#include <algorithm>
+using namespace std;
+
+#include "nes/apu.hpp"
+using namespace nes;
+
+static const uint8_t lengths[32] = {
+    10, 254, 20,  2, 40,  4, 80,  6, 160,  8, 60, 10, 14, 12, 26, 14,
+    12,  16, 24, 18, 48, 20, 96, 22, 192, 24, 72, 26, 16, 28, 32, 30,
+};
+
+static const uint8_t duties[4][8] = {
+    { 0, 1, 0, 0, 0, 0, 0, 0 },
+    { 0, 1, 1, 0, 0, 0, 0, 0 },
+    { 0, 1, 1, 1, 1, 0, 0, 0 },
+    { 1, 0, 0, 1, 1, 1, 1, 1 },
+};
+
+static const uint8_t triangle[32] = {
+    15, 14, 13, 12, 11, 10,  9,  8,  7,  6,  5,  4,  3,  2,  1,  0,
+     0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15,
+};
+
+static const uint16_t noise_periods[16] = {
+    4, 8, 16, 32, 64, 96, 128, 160, 202, 254, 380, 508, 762, 1016, 2034, 4068,
+};
+
+static const uint16_t dmc_periods[16] = {
+    428, 380, 340, 320, 286, 254, 226, 214, 190, 160, 142, 128, 106, 84, 72, 54,
+};
+
+/**
+ * Frame counter steps in CPU cycles from the $4017 write, what they
+ * clock, and the length of each sequence.
+ */
+#define STEP_QUARTER    0x01
+#define STEP_HALF       0x02
+#define STEP_IRQ        0x04
+
+static const unsigned int frame_steps[2][5] = {
+    { 7457, 14913, 22371, 29829, ~0U },
+    { 7457, 14913, 22371, 29829, 37281 },
+};
+
+static const uint8_t frame_actions[2][5] = {
+    { STEP_QUARTER, STEP_QUARTER | STEP_HALF, STEP_QUARTER, STEP_QUARTER | STEP_HALF | STEP_IRQ, 0 },
+    { STEP_QUARTER, STEP_QUARTER | STEP_HALF, STEP_QUARTER, 0, STEP_QUARTER | STEP_HALF },
+};
+
+static const unsigned int frame_lengths[2] = { 29830, 37282 };
+
+blip_buffer_t::blip_buffer_t(void)
+{
+    this->_factor = 0;
+    this->_offset = 0;
+    this->_sum = 0;
+    this->_capacity = 0;
+}
+
+/**
+ * Set the rates and the longest block, in clocks, that will be built
+ * before end_block().
+ */
+void
+blip_buffer_t::configure(double clock_rate, double sample_rate, uint64_t clocks)
+{
+    this->_factor = (uint64_t)(sample_rate / clock_rate * 4294967296.0);
+    this->_offset = 0;
+    this->_sum = 0;
+    this->_capacity = this->samples(clocks) + BLIP_WIDTH + 1;
+    this->_deltas.clear();
+}
+
+void
+blip_buffer_t::clear(void)
+{
+    this->_offset = 0;
+    this->_sum = 0;
+    fill(this->_deltas.begin(), this->_deltas.end(), 0.0f);
+}
+
+/**
+ * Start over without pending steps, with the output already settled on
+ * a level.
+ */
+void
+blip_buffer_t::settle(float level)
+{
+    this->clear();
+    this->_sum = level;
+}
+
+/**
+ * Number of samples that are complete once the block is clocks long.
+ */
+size_t
+blip_buffer_t::samples(uint64_t clocks) const
+{
+    return ((this->_offset + clocks * this->_factor) >> 32);
+}
+
+/**
+ * Integrate the complete samples of the block into output and keep the
+ * tails of the last steps for the next block.
+ */
+void
+blip_buffer_t::end_block(uint64_t clocks, float *output)
+{
+    size_t count;
+    count = this->samples(clocks);
+
+    this->_offset = (this->_offset + clocks * this->_factor) & 0xffffffffULL;
+
+    if (this->_deltas.empty()) {
+        fill(output, output + count, this->_sum);
+        return;
+    }
+
+    float sum;
+    sum = this->_sum;
+
+    for (size_t i = 0; i < count; i++) {
+        sum += this->_deltas[i];
+        output[i] = sum;
+    }
+
+    this->_sum = sum;
+
+    memmove(&this->_deltas[0], &this->_deltas[count], BLIP_WIDTH * sizeof(float));
+    fill(this->_deltas.begin() + BLIP_WIDTH, this->_deltas.begin() + count + BLIP_WIDTH, 0.0f);
+}
+
+/**
+ * Windowed sinc impulse for a step at every sub-sample phase, cut off
+ * a little below the output Nyquist rate. Every phase sums to one so
+ * the integrated output settles exactly on the step height.
+ */
+static bool
+blip_kernels(float kernels[BLIP_PHASES][BLIP_WIDTH])
+{
+    for (unsigned int p = 0; p < BLIP_PHASES; p++) {
+        double sum = 0;
+
+        for (unsigned int i = 0; i < BLIP_WIDTH; i++) {
+            double x, u, sinc, window;
+            x = (double)i - BLIP_WIDTH / 2 - (double)p / BLIP_PHASES;
+            u = (x + BLIP_WIDTH / 2 + 0.5) / (BLIP_WIDTH + 1);
+            sinc = x == 0 ? 1 : sin(M_PI * 0.9 * x) / (M_PI * 0.9 * x);
+            window = 0.42 - 0.5 * cos(2 * M_PI * u) + 0.08 * cos(4 * M_PI * u);
+
+            kernels[p][i] = sinc * window;
+            sum += kernels[p][i];
+        }
+
+        for (unsigned int i = 0; i < BLIP_WIDTH; i++) {
+            kernels[p][i] /= sum;
+        }
+    }
+
+    return (true);
+}
+
+/**
+ * The impulse for a phase. The table is built once, by whichever
+ * instance gets here first when several run on their own threads.
+ */
+const float *
+blip_buffer_t::_kernel(unsigned int phase)
+{
+    static float kernels[BLIP_PHASES][BLIP_WIDTH];
+    static bool ready = blip_kernels(kernels);
+    (void)ready;
+
+    return (kernels[phase]);
+}
+
+apu_t::apu_t(memory_map_t &memory, scheduler_t &scheduler)
+    : _memory(memory), _scheduler(scheduler)
+{
+    this->_event = this->_scheduler.add(this);
+    this->_time = 0;
+    this->_block_start = 0;
+    this->set_rate(NES_APU_RATE);
+}
+
+/**
+ * A copy for another machine, on its address space and scheduler. The
+ * channels and the frame counter carry over. The block being built and
+ * the samples waiting for the reader stay with the original, the copy
+ * starts a block of its own with each stream settled on the level its
+ * channel outputs.
+ */
+apu_t::apu_t(const apu_t &other, memory_map_t &memory, scheduler_t &scheduler)
+    : _memory(memory), _scheduler(scheduler)
+{
+    this->_event = other._event;
+    this->_scheduler.rebind(this->_event, this);
+
+    memcpy(this->_pulse, other._pulse, sizeof this->_pulse);
+    this->_triangle = other._triangle;
+    this->_noise = other._noise;
+    this->_dmc = other._dmc;
+    this->_enabled = other._enabled;
+
+    this->_five_step = other._five_step;
+    this->_irq_inhibit = other._irq_inhibit;
+    this->_frame_irq = other._frame_irq;
+    this->_dmc_irq = other._dmc_irq;
+    this->_frame_origin = other._frame_origin;
+    this->_frame_step = other._frame_step;
+
+    this->_time = other._time;
+    memcpy(this->_timers, other._timers, sizeof this->_timers);
+    memcpy(this->_levels, other._levels, sizeof this->_levels);
+    this->_block_start = other._time;
+    this->_block_clocks = other._block_clocks;
+    this->_rate = other._rate;
+
+    for (unsigned int i = 0; i < NES_APU_CHANNELS; i++) {
+        this->_blips[i].configure(NES_CPU_RATE, this->_rate, this->_block_clocks * 2);
+        this->_blips[i].settle(this->_levels[i]);
+    }
+
+    this->_head = 0;
+}
+
+/**
+ * Power-on state, with the frame counter and the first block starting
+ * at the given cycle.
+ */
+void
+apu_t::reset(uint64_t now)
+{
+    memset(this->_pulse, 0, sizeof this->_pulse);
+    memset(&this->_triangle, 0, sizeof this->_triangle);
+    memset(&this->_noise, 0, sizeof this->_noise);
+    memset(&this->_dmc, 0, sizeof this->_dmc);
+
+    this->_noise.period = noise_periods[0];
+    this->_noise.shift = 1;
+    this->_dmc.period = dmc_periods[0];
+    this->_dmc.bits = 8;
+    this->_dmc.silence = true;
+    this->_enabled = 0;
+
+    this->_five_step = false;
+    this->_irq_inhibit = false;
+    this->_frame_irq = false;
+    this->_dmc_irq = false;
+    this->_frame_origin = now;
+    this->_frame_step = 0;
+
+    this->_time = now;
+    this->_block_start = now;
+
+    for (unsigned int i = 0; i < NES_APU_CHANNELS; i++) {
+        this->_timers[i] = now;
+        this->_levels[i] = 0;
+        this->_blips[i].clear();
+        this->_streams[i].clear();
+    }
+
+    this->_head = 0;
+
+    this->_schedule_frame();
+}
+
+void
+apu_t::save(apu_state_t &state) const
+{
+    memcpy(state.pulse, this->_pulse, sizeof state.pulse);
+    state.triangle = this->_triangle;
+    state.noise = this->_noise;
+    state.dmc = this->_dmc;
+    state.enabled = this->_enabled;
+
+    state.five_step = this->_five_step;
+    state.irq_inhibit = this->_irq_inhibit;
+    state.frame_irq = this->_frame_irq;
+    state.dmc_irq = this->_dmc_irq;
+    state.frame_step = this->_frame_step;
+    state.frame_origin = this->_frame_origin;
+
+    state.time = this->_time;
+    memcpy(state.timers, this->_timers, sizeof state.timers);
+
+    for (unsigned int i = 0; i < NES_APU_CHANNELS; i++) {
+        state.levels[i] = this->_levels[i];
+    }
+}
+
+/**
+ * A state the APU could have saved at CPU cycle now: sequencer steps
+ * within their tables, timers that move on, and channels synced within
+ * a block of now with their timers in the period after it, so every
+ * step they output lands in the synthesis buffers.
+ */
+int
+apu_t::check(const apu_state_t &state, uint64_t now) const
+{
+    for (unsigned int i = 0; i < 2; i++) {
+        if (state.pulse[i].duty > 3 || state.pulse[i].step > 7) {
+            return (1);
+        }
+    }
+
+    if (state.triangle.step > 31 || state.noise.period == 0 || state.dmc.period == 0 ||
+        state.frame_step >= (state.five_step ? 5U : 4U)) {
+        return (1);
+    }
+
+    if (state.time > now || now - state.time >= this->_block_clocks ||
+        state.frame_origin > state.time + frame_lengths[1] || state.frame_origin + 2 * frame_lengths[1] < state.time) {
+        return (1);
+    }
+
+    for (unsigned int i = 0; i < NES_APU_CHANNELS; i++) {
+        if (state.timers[i] < state.time || state.timers[i] - state.time > 0x10000) {
+            return (1);
+        }
+    }
+
+    return (0);
+}
+
+/**
+ * Restore a checked state. The block being built is ended first, and a
+ * new one starts where the saved channels left off with each stream
+ * stepping to its saved level, so the audio stays continuous.
+ */
+void
+apu_t::load(const apu_state_t &state)
+{
+    this->end_frame(this->_time);
+
+    memcpy(this->_pulse, state.pulse, sizeof this->_pulse);
+    this->_triangle = state.triangle;
+    this->_noise = state.noise;
+    this->_dmc = state.dmc;
+    this->_enabled = state.enabled;
+
+    this->_five_step = state.five_step;
+    this->_irq_inhibit = state.irq_inhibit;
+    this->_frame_irq = state.frame_irq;
+    this->_dmc_irq = state.dmc_irq;
+    this->_frame_step = state.frame_step;
+    this->_frame_origin = state.frame_origin;
+
+    this->_time = state.time;
+    this->_block_start = state.time;
+    memcpy(this->_timers, state.timers, sizeof this->_timers);
+
+    for (unsigned int i = 0; i < NES_APU_CHANNELS; i++) {
+        this->_blips[i].add(0, state.levels[i] - this->_levels[i]);
+        this->_levels[i] = state.levels[i];
+    }
+
+    this->_schedule_frame();
+}
+
+/**
+ * Rate of the band-limited channel streams, samples already produced
+ * are dropped.
+ */
+void
+apu_t::set_rate(double rate)
+{
+    this->_rate = rate;
+    this->_block_clocks = NES_CPU_RATE / 30;
+
+    for (unsigned int i = 0; i < NES_APU_CHANNELS; i++) {
+        this->_blips[i].configure(NES_CPU_RATE, rate, this->_block_clocks * 2);
+        this->_streams[i].clear();
+    }
+
+    this->_head = 0;
+}
+
+double
+apu_t::rate(void) const
+{
+    return (this->_rate);
+}
+
+uint8_t
+apu_t::read(uint16_t address, uint64_t now)
+{
+    if (address != NES_APU_STATUS) {
+        return (0);
+    }
+
+    this->sync(now);
+
+    uint8_t value;
+    value = (this->_pulse[0].length ? 0x01 : 0) | (this->_pulse[1].length ? 0x02 : 0) |
+        (this->_triangle.length ? 0x04 : 0) | (this->_noise.length ? 0x08 : 0) |
+        (this->_dmc.remaining ? 0x10 : 0) | (this->_frame_irq ? 0x40 : 0) | (this->_dmc_irq ? 0x80 : 0);
+
+    this->_frame_irq = false;
+    return (value);
+}
+
+void
+apu_t::write(uint16_t address, uint8_t value, uint64_t now)
+{
+    this->sync(now);
+
+    switch (address) {
+        case 0x4000:
+        case 0x4004: {
+            pulse_t &pulse = this->_pulse[(address >> 2) & 1];
+            pulse.duty = value >> 6;
+            pulse.envelope.loop = value & 0x20;
+            pulse.envelope.constant = value & 0x10;
+            pulse.envelope.period = value & 0x0f;
+            break;
+        }
+
+        case 0x4001:
+        case 0x4005: {
+            pulse_t &pulse = this->_pulse[(address >> 2) & 1];
+            pulse.sweep_enabled = value & 0x80;
+            pulse.sweep_period = (value >> 4) & 0x07;
+            pulse.sweep_negate = value & 0x08;
+            pulse.sweep_shift = value & 0x07;
+            pulse.sweep_reload = true;
+            break;
+        }
+
+        case 0x4002:
+        case 0x4006: {
+            pulse_t &pulse = this->_pulse[(address >> 2) & 1];
+            pulse.period = (pulse.period & 0x0700) | value;
+            break;
+        }
+
+        case 0x4003:
+        case 0x4007: {
+            unsigned int index;
+            index = (address >> 2) & 1;
+
+            pulse_t &pulse = this->_pulse[index];
+            pulse.period = (pulse.period & 0x00ff) | (value & 0x07) << 8;
+            pulse.length = this->_enabled & (1 << index) ? lengths[value >> 3] : 0;
+            pulse.step = 0;
+            pulse.envelope.start = true;
+            break;
+        }
+
+        case 0x4008:
+            this->_triangle.control = value & 0x80;
+            this->_triangle.linear_period = value & 0x7f;
+            break;
+
+        case 0x400a:
+            this->_triangle.period = (this->_triangle.period & 0x0700) | value;
+            break;
+
+        case 0x400b:
+            this->_triangle.period = (this->_triangle.period & 0x00ff) | (value & 0x07) << 8;
+            this->_triangle.length = this->_enabled & 0x04 ? lengths[value >> 3] : 0;
+            this->_triangle.reload = true;
+            break;
+
+        case 0x400c:
+            this->_noise.envelope.loop = value & 0x20;
+            this->_noise.envelope.constant = value & 0x10;
+            this->_noise.envelope.period = value & 0x0f;
+            break;
+
+        case 0x400e:
+            this->_noise.mode = value & 0x80;
+            this->_noise.period = noise_periods[value & 0x0f];
+            break;
+
+        case 0x400f:
+            this->_noise.length = this->_enabled & 0x08 ? lengths[value >> 3] : 0;
+            this->_noise.envelope.start = true;
+            break;
+
+        case 0x4010:
+            this->_dmc.irq_enabled = value & 0x80;
+            this->_dmc.loop = value & 0x40;
+            this->_dmc.period = dmc_periods[value & 0x0f];
+
+            if (!this->_dmc.irq_enabled) {
+                this->_dmc_irq = false;
+            }
+            break;
+
+        case 0x4011:
+            this->_dmc.level = value & 0x7f;
+            break;
+
+        case 0x4012:
+            this->_dmc.start = 0xc000 | value << 6;
+            break;
+
+        case 0x4013:
+            this->_dmc.size = (value << 4) | 1;
+            break;
+
+        case NES_APU_STATUS:
+            this->_enabled = value & 0x1f;
+            this->_dmc_irq = false;
+
+            if (!(value & 0x01)) this->_pulse[0].length = 0;
+            if (!(value & 0x02)) this->_pulse[1].length = 0;
+            if (!(value & 0x04)) this->_triangle.length = 0;
+            if (!(value & 0x08)) this->_noise.length = 0;
+
+            if (!(value & 0x10)) {
+                this->_dmc.remaining = 0;
+            } else if (this->_dmc.remaining == 0) {
+                this->_dmc.address = this->_dmc.start;
+                this->_dmc.remaining = this->_dmc.size;
+                this->_fetch_dmc();
+            }
+            break;
+
+        case NES_APU_FRAME:
+            this->_five_step = value & 0x80;
+            this->_irq_inhibit = value & 0x40;
+            this->_frame_origin = now;
+            this->_frame_step = 0;
+
+            if (this->_irq_inhibit) {
+                this->_frame_irq = false;
+            }
+
+            if (this->_five_step) {
+                this->_quarter_frame();
+                this->_half_frame();
+            }
+            break;
+
+        default:
+            break;
+    }
+
+    this->_update();
+    this->_schedule_frame();
+}
+
+/**
+ * Catch up with the CPU. Blocks that grow too long without a video
+ * frame ending them, when the emulator single steps, are ended here.
+ * Events are delivered late, now can be behind the channels, which
+ * then stay where they are.
+ */
+void
+apu_t::sync(uint64_t now)
+{
+    this->_run(now);
+
+    assert(this->_time >= this->_block_start);
+
+    if (this->_time - this->_block_start >= this->_block_clocks) {
+        this->end_frame(this->_time);
+    }
+}
+
+/**
+ * End the block at the end of a video frame: the channel streams get
+ * every sample up to now, or up to where the channels already are when
+ * now is behind them. At most a second of samples is kept for the
+ * reader, older ones are dropped.
+ */
+void
+apu_t::end_frame(uint64_t now)
+{
+    this->_run(now);
+
+    assert(this->_time >= this->_block_start);
+
+    uint64_t clocks;
+    clocks = this->_time - this->_block_start;
+
+    for (unsigned int i = 0; i < NES_APU_CHANNELS; i++) {
+        std::vector<float> &stream = this->_streams[i];
+
+        size_t size;
+        size = stream.size();
+
+        stream.resize(size + this->_blips[i].samples(clocks));
+        this->_blips[i].end_block(clocks, &stream[0] + size);
+    }
+
+    this->_block_start = this->_time;
+
+    if (this->available() > this->_rate) {
+        this->consume(this->available() - (size_t)this->_rate);
+    }
+}
+
+size_t
+apu_t::available(void) const
+{
+    return (this->_streams[0].size() - this->_head);
+}
+
+/**
+ * Band-limited DAC levels of a channel, available() of them.
+ */
+const float *
+apu_t::stream(unsigned int channel) const
+{
+    return (this->_streams[channel].data() + this->_head);
+}
+
+/**
+ * Drop samples from the front of the streams. The storage is only
+ * compacted once a second's worth has been consumed, which keeps the
+ * cost per sample constant.
+ */
+void
+apu_t::consume(size_t count)
+{
+    this->_head += count;
+
+    if (this->_head < this->_rate) {
+        return;
+    }
+
+    for (unsigned int i = 0; i < NES_APU_CHANNELS; i++) {
+        this->_streams[i].erase(this->_streams[i].begin(), this->_streams[i].begin() + this->_head);
+    }
+
+    this->_head = 0;
+}
+
+/**
+ * Frame counter steps and the predicted DMC interrupt.
+ */
+void
+apu_t::event(uint64_t deadline)
+{
+    this->sync(deadline);
+
+    unsigned int sequence;
+    sequence = this->_five_step ? 1 : 0;
+
+    while (this->_frame_origin + frame_steps[sequence][this->_frame_step] <= deadline) {
+        uint8_t actions;
+        actions = frame_actions[sequence][this->_frame_step];
+
+        if (actions & STEP_QUARTER) {
+            this->_quarter_frame();
+        }
+
+        if (actions & STEP_HALF) {
+            this->_half_frame();
+        }
+
+        if ((actions & STEP_IRQ) && !this->_irq_inhibit) {
+            this->_frame_irq = true;
+        }
+
+        if (++this->_frame_step == 4 + sequence) {
+            this->_frame_step = 0;
+            this->_frame_origin += frame_lengths[sequence];
+        }
+    }
+
+    this->_update();
+    this->_schedule_frame();
+}
+
+/**
+ * Next frame counter step, or the cycle the DMC raises its interrupt
+ * if that comes first: after the bits left in the shifter, one byte
+ * every eight timer periods.
+ */
+void
+apu_t::_schedule_frame(void)
+{
+    uint64_t deadline;
+    deadline = this->_frame_origin + frame_steps[this->_five_step ? 1 : 0][this->_frame_step];
+
+    const dmc_t &dmc = this->_dmc;
+
+    if (dmc.irq_enabled && !dmc.loop && dmc.remaining > 0) {
+        deadline = min(deadline, this->_timers[NES_APU_DMC] +
+            (uint64_t)(dmc.bits - 1 + (dmc.remaining - 1) * 8) * dmc.period);
+    }
+
+    this->_scheduler.schedule(this->_event, deadline);
+}
+
+void
+apu_t::_run(uint64_t now)
+{
+    if (now <= this->_time) {
+        return;
+    }
+
+    this->_run_pulse(0, now);
+    this->_run_pulse(1, now);
+    this->_run_triangle(now);
+    this->_run_noise(now);
+    this->_run_dmc(now);
+
+    this->_time = now;
+}
+
+/**
+ * Skip the timer of a silent channel to the first tick at or after now,
+ * returning the number of ticks skipped.
+ */
+static inline uint64_t
+skip(uint64_t &timer, uint64_t period, uint64_t now)
+{
+    if (timer >= now) {
+        return (0);
+    }
+
+    uint64_t ticks;
+    ticks = (now - timer + period - 1) / period;
+
+    timer += ticks * period;
+    return (ticks);
+}
+
+void
+apu_t::_run_pulse(unsigned int index, uint64_t now)
+{
+    pulse_t &pulse = this->_pulse[index];
+    uint64_t &timer = this->_timers[index];
+
+    uint64_t period;
+    period = (pulse.period + 1) * 2;
+
+    int volume;
+    volume = this->_pulse_volume(pulse);
+
+    if (volume == 0) {
+        pulse.step = (pulse.step + skip(timer, period, now)) & 0x07;
+        return;
+    }
+
+    for (; timer < now; timer += period) {
+        pulse.step = (pulse.step + 1) & 0x07;
+        this->_output(index, duties[pulse.duty][pulse.step] ? volume : 0, timer);
+    }
+}
+
+/**
+ * The triangle holds its level when silenced, periods below two are
+ * ultrasonic and held as well rather than aliased.
+ */
+void
+apu_t::_run_triangle(uint64_t now)
+{
+    triangle_t &channel = this->_triangle;
+    uint64_t &timer = this->_timers[NES_APU_TRIANGLE];
+
+    uint64_t period;
+    period = channel.period + 1;
+
+    if (channel.length == 0 || channel.linear == 0 || channel.period < 2) {
+        skip(timer, period, now);
+        return;
+    }
+
+    for (; timer < now; timer += period) {
+        channel.step = (channel.step + 1) & 0x1f;
+        this->_output(NES_APU_TRIANGLE, triangle[channel.step], timer);
+    }
+}
+
+/**
+ * The shift register is only clocked while it can be heard.
+ */
+void
+apu_t::_run_noise(uint64_t now)
+{
+    noise_t &noise = this->_noise;
+    uint64_t &timer = this->_timers[NES_APU_NOISE];
+
+    int volume;
+    volume = noise.length ? (noise.envelope.constant ? noise.envelope.period : noise.envelope.decay) : 0;
+
+    if (volume == 0) {
+        skip(timer, noise.period, now);
+        return;
+    }
+
+    for (; timer < now; timer += noise.period) {
+        uint16_t feedback;
+        feedback = (noise.shift ^ (noise.shift >> (noise.mode ? 6 : 1))) & 0x01;
+
+        noise.shift = (noise.shift >> 1) | feedback << 14;
+        this->_output(NES_APU_NOISE, noise.shift & 0x01 ? 0 : volume, timer);
+    }
+}
+
+void
+apu_t::_run_dmc(uint64_t now)
+{
+    dmc_t &dmc = this->_dmc;
+    uint64_t &timer = this->_timers[NES_APU_DMC];
+
+    if (dmc.silence && !dmc.buffered) {
+        skip(timer, dmc.period, now);
+        return;
+    }
+
+    for (; timer < now; timer += dmc.period) {
+        if (!dmc.silence) {
+            if (dmc.shift & 0x01) {
+                dmc.level += dmc.level <= 125 ? 2 : 0;
+            } else {
+                dmc.level -= dmc.level >= 2 ? 2 : 0;
+            }
+
+            this->_output(NES_APU_DMC, dmc.level, timer);
+        }
+
+        dmc.shift >>= 1;
+
+        if (--dmc.bits == 0) {
+            dmc.bits = 8;
+            dmc.silence = !dmc.buffered;
+
+            if (dmc.buffered) {
+                dmc.shift = dmc.buffer;
+                dmc.buffered = false;
+                this->_fetch_dmc();
+            }
+        }
+    }
+}
+
+/**
+ * Refill the sample buffer from CPU memory. The cycles the fetch
+ * steals from the CPU are not accounted for.
+ */
+void
+apu_t::_fetch_dmc(void)
+{
+    dmc_t &dmc = this->_dmc;
+
+    if (dmc.buffered || dmc.remaining == 0) {
+        return;
+    }
+
+    dmc.buffer = this->_memory.read_byte(dmc.address);
+    dmc.buffered = true;
+    dmc.address = dmc.address == 0xffff ? 0x8000 : dmc.address + 1;
+
+    if (--dmc.remaining == 0) {
+        if (dmc.loop) {
+            dmc.address = dmc.start;
+            dmc.remaining = dmc.size;
+        } else if (dmc.irq_enabled) {
+            this->_dmc_irq = true;
+        }
+    }
+}
+
+/**
+ * A channel changes its DAC level at the given cycle.
+ */
+void
+apu_t::_output(unsigned int channel, int level, uint64_t time)
+{
+    if (level == this->_levels[channel]) {
+        return;
+    }
+
+    this->_blips[channel].add(time - this->_block_start, level - this->_levels[channel]);
+    this->_levels[channel] = level;
+}
+
+/**
+ * Levels after a register write or a frame counter step changed what
+ * the channels output.
+ */
+void
+apu_t::_update(void)
+{
+    for (unsigned int i = 0; i < 2; i++) {
+        const pulse_t &pulse = this->_pulse[i];
+        this->_output(i, duties[pulse.duty][pulse.step] ? this->_pulse_volume(pulse) : 0, this->_time);
+    }
+
+    this->_output(NES_APU_TRIANGLE, triangle[this->_triangle.step], this->_time);
+
+    const noise_t &noise = this->_noise;
+    this->_output(NES_APU_NOISE, noise.length && !(noise.shift & 0x01) ?
+        (noise.envelope.constant ? noise.envelope.period : noise.envelope.decay) : 0, this->_time);
+
+    this->_output(NES_APU_DMC, this->_dmc.level, this->_time);
+}
+
+/**
+ * Pulse volume, zero when the length counter ran out, the period is
+ * below 8 or the sweep target overflows.
+ */
+int
+apu_t::_pulse_volume(const pulse_t &pulse) const
+{
+    if (pulse.length == 0 || pulse.period < 8 || this->_sweep_target(&pulse - this->_pulse) > 0x7ff) {
+        return (0);
+    }
+
+    return (pulse.envelope.constant ? pulse.envelope.period : pulse.envelope.decay);
+}
+
+/**
+ * Sweep target period, the first pulse negates in ones' complement.
+ */
+uint16_t
+apu_t::_sweep_target(unsigned int index) const
+{
+    const pulse_t &pulse = this->_pulse[index];
+
+    uint16_t change;
+    change = pulse.period >> pulse.sweep_shift;
+
+    if (!pulse.sweep_negate) {
+        return (pulse.period + change);
+    }
+
+    return (pulse.period - change - (index == 0 ? 1 : 0));
+}
+
+static void
+clock_envelope(uint8_t &divider, uint8_t &decay, bool &start, uint8_t period, bool loop)
+{
+    if (start) {
+        start = false;
+        decay = 15;
+        divider = period;
+    } else if (divider == 0) {
+        divider = period;
+
+        if (decay > 0) {
+            decay--;
+        } else if (loop) {
+            decay = 15;
+        }
+    } else {
+        divider--;
+    }
+}
+
+/**
+ * Envelopes and the triangle linear counter.
+ */
+void
+apu_t::_quarter_frame(void)
+{
+    for (unsigned int i = 0; i < 2; i++) {
+        envelope_t &envelope = this->_pulse[i].envelope;
+        clock_envelope(envelope.divider, envelope.decay, envelope.start, envelope.period, envelope.loop);
+    }
+
+    envelope_t &envelope = this->_noise.envelope;
+    clock_envelope(envelope.divider, envelope.decay, envelope.start, envelope.period, envelope.loop);
+
+    triangle_t &channel = this->_triangle;
+
+    if (channel.reload) {
+        channel.linear = channel.linear_period;
+    } else if (channel.linear > 0) {
+        channel.linear--;
+    }
+
+    if (!channel.control) {
+        channel.reload = false;
+    }
+}
+
+/**
+ * Length counters and sweeps.
+ */
+void
+apu_t::_half_frame(void)
+{
+    for (unsigned int i = 0; i < 2; i++) {
+        pulse_t &pulse = this->_pulse[i];
+
+        if (!pulse.envelope.loop && pulse.length > 0) {
+            pulse.length--;
+        }
+
+        uint16_t target;
+        target = this->_sweep_target(i);
+
+        if (pulse.sweep_divider == 0 && pulse.sweep_enabled && pulse.sweep_shift > 0 &&
+            pulse.period >= 8 && target <= 0x7ff) {
+            pulse.period = target;
+        }
+
+        if (pulse.sweep_divider == 0 || pulse.sweep_reload) {
+            pulse.sweep_divider = pulse.sweep_period;
+            pulse.sweep_reload = false;
+        } else {
+            pulse.sweep_divider--;
+        }
+    }
+
+    if (!this->_triangle.control && this->_triangle.length > 0) {
+        this->_triangle.length--;
+    }
+
+    if (!this->_noise.envelope.loop && this->_noise.length > 0) {
+        this->_noise.length--;
+    }
+}
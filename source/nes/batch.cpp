@@ -0,0 +1,347 @@
+/**
+ * Copyright (c) 2009 Roy van Dam <roy@8bit.cx>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+
+#include <algorithm>
+#include <thread>
+using namespace std;
+
+#include "nes/batch.hpp"
+using namespace nes;
+
+/**
+ * A thread count of zero starts one worker per core.
+ */
+batch_t::batch_t(unsigned int threads, unsigned long quantum)
+{
+    if (threads == 0) {
+        threads = max(std::thread::hardware_concurrency(), 1U);
+    }
+
+    this->_threads = threads;
+    this->_quantum = max(quantum, 1UL);
+    this->_workers = NULL;
+    this->_count = 0;
+    this->_remaining = 0;
+    this->_wakeups = 0;
+}
+
+batch_t::~batch_t(void)
+{
+    for (size_t i = 0; i < this->_instances.size(); i++) {
+        delete this->_instances[i].emulator;
+    }
+}
+
+/**
+ * Create and power on an instance for the job. The first instance of a
+ * title maps the ROM, later ones share its image.
+ */
+int
+batch_t::add(const batch_job_t &job)
+{
+    emulator_t *emulator = new emulator_t();
+    emulator->enable_block_cache(job.block_cache);
+    emulator->enable_framebuffer(job.framebuffer);
+    emulator->set_ppu_mode(job.ppu_mode);
+
+    map<string, size_t>::const_iterator title;
+    title = this->_titles.find(job.rom);
+
+    int result;
+    if (title != this->_titles.end()) {
+        result = emulator->load(*this->_instances[title->second].emulator);
+    } else {
+        result = emulator->load(job.rom);
+    }
+
+    if (result != 0) {
+        delete emulator;
+        return (1);
+    }
+
+    if (title == this->_titles.end()) {
+        this->_titles[job.rom] = this->_instances.size();
+    }
+
+    instance_t instance;
+    instance.emulator = emulator;
+    instance.job = job;
+    instance.result = batch_result_t();
+
+    this->_instances.push_back(instance);
+    return (0);
+}
+
+static double
+now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (ts.tv_sec + ts.tv_nsec / 1e9);
+}
+
+/**
+ * Run every instance to the end of its job. The instances are dealt
+ * out to the workers round robin, no more workers are started than
+ * there are instances.
+ */
+batch_stats_t
+batch_t::run(void)
+{
+    batch_stats_t stats = batch_stats_t();
+    stats.instances = this->_instances.size();
+
+    this->_count = (unsigned int)min((size_t)this->_threads, max(this->_instances.size(), (size_t)1));
+    this->_workers = new worker_t[this->_count];
+
+    for (unsigned int i = 0; i < this->_count; i++) {
+        this->_workers[i].quanta = 0;
+        this->_workers[i].steals = 0;
+    }
+
+    for (size_t i = 0; i < this->_instances.size(); i++) {
+        this->_workers[i % this->_count].queue.push_back(i);
+    }
+
+    this->_remaining = this->_instances.size();
+
+    double start;
+    start = now();
+
+    vector<std::thread> threads;
+    for (unsigned int i = 0; i < this->_count; i++) {
+        threads.push_back(std::thread(&batch_t::_work, this, i));
+    }
+
+    for (size_t i = 0; i < threads.size(); i++) {
+        threads[i].join();
+    }
+
+    stats.seconds = now() - start;
+    stats.threads = this->_count;
+
+    for (unsigned int i = 0; i < this->_count; i++) {
+        stats.quanta += this->_workers[i].quanta;
+        stats.steals += this->_workers[i].steals;
+    }
+
+    for (size_t i = 0; i < this->_instances.size(); i++) {
+        stats.frames += this->_instances[i].result.stats.frames;
+    }
+
+    delete[] this->_workers;
+    this->_workers = NULL;
+
+    return (stats);
+}
+
+/**
+ * Worker loop: run instances from the own queue, or stolen from the
+ * others, until every instance is done. Instances that are not done
+ * after their quantum go back on the queue of the worker that ran them.
+ */
+void
+batch_t::_work(unsigned int id)
+{
+    this->_pin(id);
+
+    worker_t &self = this->_workers[id];
+
+    while (this->_remaining.load(std::memory_order_acquire) > 0) {
+        size_t index;
+
+        if (!this->_take(id, index) && !this->_wait(id, index)) {
+            continue;
+        }
+
+        self.quanta++;
+
+        if (this->_step(this->_instances[index])) {
+            {
+                lock_guard<std::mutex> guard(self.lock);
+                self.queue.push_back(index);
+            }
+
+            this->_wake(false);
+        } else if (this->_remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            this->_wake(true);
+        }
+    }
+}
+
+/**
+ * The newest instance on the own queue, else the oldest on the first
+ * other queue that has one, starting with the next worker along.
+ */
+bool
+batch_t::_take(unsigned int id, size_t &index)
+{
+    worker_t &self = this->_workers[id];
+
+    {
+        lock_guard<std::mutex> guard(self.lock);
+
+        if (!self.queue.empty()) {
+            index = self.queue.back();
+            self.queue.pop_back();
+            return (true);
+        }
+    }
+
+    for (unsigned int i = 1; i < this->_count; i++) {
+        worker_t &victim = this->_workers[(id + i) % this->_count];
+        lock_guard<std::mutex> guard(victim.lock);
+
+        if (!victim.queue.empty()) {
+            index = victim.queue.front();
+            victim.queue.pop_front();
+            self.steals++;
+            return (true);
+        }
+    }
+
+    return (false);
+}
+
+/**
+ * Look for an instance a few more times, then sleep until one goes
+ * back on a queue or the batch is done. Returns false when woken
+ * without having taken one.
+ */
+bool
+batch_t::_wait(unsigned int id, size_t &index)
+{
+    for (unsigned int i = 0; i < NES_BATCH_SPINS; i++) {
+        std::this_thread::yield();
+
+        if (this->_take(id, index)) {
+            return (true);
+        }
+    }
+
+    unique_lock<std::mutex> guard(this->_idle_lock);
+
+    unsigned long wakeups;
+    wakeups = this->_wakeups;
+
+    guard.unlock();
+
+    if (this->_take(id, index)) {
+        return (true);
+    }
+
+    guard.lock();
+
+    while (this->_wakeups == wakeups && this->_remaining.load(std::memory_order_acquire) > 0) {
+        this->_idle.wait(guard);
+    }
+
+    return (false);
+}
+
+/**
+ * Wake one sleeping worker after an instance went back on a queue, or
+ * all of them when the last instance is done.
+ */
+void
+batch_t::_wake(bool all)
+{
+    {
+        lock_guard<std::mutex> guard(this->_idle_lock);
+        this->_wakeups++;
+    }
+
+    if (all) {
+        this->_idle.notify_all();
+    } else {
+        this->_idle.notify_one();
+    }
+}
+
+/**
+ * Run an instance for a quantum, returns whether it has frames left.
+ */
+bool
+batch_t::_step(instance_t &instance)
+{
+    run_stats_t &total = instance.result.stats;
+
+    if (instance.result.status != 0 || total.frames >= instance.job.frames) {
+        return (false);
+    }
+
+    run_limits_t limits = run_limits_t();
+    limits.frames = min(this->_quantum, instance.job.frames - total.frames);
+    limits.breakpoint = -1;
+
+    run_stats_t stats;
+    instance.result.status = instance.emulator->run(limits, stats);
+
+    total.reason = stats.reason;
+    total.instructions += stats.instructions;
+    total.cycles += stats.cycles;
+    total.frames += stats.frames;
+    total.seconds += stats.seconds;
+
+    return (instance.result.status == 0 && total.frames < instance.job.frames);
+}
+
+/**
+ * Pin the calling worker to the id-th core it may run on.
+ */
+void
+batch_t::_pin(unsigned int id)
+{
+#if defined(__linux__)
+    cpu_set_t allowed;
+
+    if (sched_getaffinity(0, sizeof allowed, &allowed) != 0 || CPU_COUNT(&allowed) == 0) {
+        return;
+    }
+
+    int target, cpu;
+    target = id % CPU_COUNT(&allowed);
+
+    for (cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+        if (CPU_ISSET(cpu, &allowed) && target-- == 0) {
+            break;
+        }
+    }
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+
+    pthread_setaffinity_np(pthread_self(), sizeof set, &set);
+#else
+    (void)id;
+#endif
+}
@@ -0,0 +1,290 @@
+/**
+ * Copyright (c) 2009 Roy van Dam <roy@8bit.cx>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+using namespace std;
+
+#include "trace.hpp"
+#include "nes/cartridge.hpp"
+using namespace nes;
+
+cartridge_t::cartridge_t(void)
+{
+    this->_image = NULL;
+    this->header = NULL;
+    this->hash = 0;
+}
+
+/**
+ * A copy shares the image and gets its own copy of the cartridge RAM,
+ * the CHR bank table pointing into it for CHR-RAM.
+ */
+cartridge_t::cartridge_t(const cartridge_t &other)
+    : _image(other._image), header(other.header), nes2(other.nes2), hash(other.hash),
+      mapper(other.mapper), submapper(other.submapper), mirroring(other.mirroring),
+      region(other.region), battery(other.battery), trainer(other.trainer),
+      prg(other.prg), prg_size(other.prg_size), chr(other.chr), chr_size(other.chr_size),
+      chr_writable(other.chr_writable), prg_ram(other.prg_ram), chr_ram(other.chr_ram),
+      prg_banks(other.prg_banks), chr_banks(other.chr_banks)
+{
+    if (this->_image != NULL) {
+        rom_retain(this->_image);
+    }
+
+    if (this->chr_writable) {
+        this->chr = &this->chr_ram[0];
+
+        for (size_t i = 0; i < this->chr_banks.size(); i++) {
+            this->chr_banks[i] = this->chr + i * NES_CHR_BANK;
+        }
+    }
+}
+
+cartridge_t::~cartridge_t(void)
+{
+    this->_unload();
+}
+
+void
+cartridge_t::_unload(void)
+{
+    if (this->_image != NULL) {
+        rom_release(this->_image);
+    }
+
+    this->_image = NULL;
+    this->header = NULL;
+
+    this->prg_ram.clear();
+    this->chr_ram.clear();
+    this->prg_banks.clear();
+    this->chr_banks.clear();
+}
+
+int
+cartridge_t::load(const std::string &filename)
+{
+    this->_unload();
+
+    if ((this->_image = rom_acquire(filename)) == NULL) {
+        return (1);
+    }
+
+    if (this->_image->size < NES_HEADER_SIZE) {
+        fprintf(stderr, "%s: Not a NES rom\n", filename.c_str());
+        this->_unload();
+        return (1);
+    }
+
+    if (this->_parse() != 0) {
+        fprintf(stderr, "%s: Unsupported image\n", filename.c_str());
+        this->_unload();
+        return (1);
+    }
+
+    return (0);
+}
+
+/**
+ * Insert the ROM of another cartridge without mapping or hashing the
+ * file again.
+ */
+int
+cartridge_t::share(const cartridge_t &other)
+{
+    if (other._image == NULL) {
+        return (1);
+    }
+
+    rom_retain(other._image);
+
+    this->_unload();
+    this->_image = other._image;
+
+    return (this->_parse());
+}
+
+/**
+ * NES 2.0 sizes: a 12 bit unit count, or when the upper nibble is all
+ * ones an exponent-multiplier pair in the low byte. Exponents that
+ * would overflow give SIZE_MAX, which no image is large enough for.
+ */
+static size_t
+rom_size(uint8_t lsb, uint8_t msb, size_t unit)
+{
+    if (msb == 0x0f) {
+        if ((lsb >> 2) >= sizeof(size_t) * 8 - 3) {
+            return (SIZE_MAX);
+        }
+
+        return (((size_t)1 << (lsb >> 2)) * ((lsb & 0x03) * 2 + 1));
+    }
+
+    return ((((size_t)msb << 8) | lsb) * unit);
+}
+
+static size_t
+ram_size(uint8_t shift)
+{
+    return (shift == 0 ? 0 : (size_t)64 << shift);
+}
+
+int
+cartridge_t::_parse(void)
+{
+    rom_header_t *header;
+    header = this->header = (rom_header_t *)this->_image->data;
+
+    if (memcmp(header->name, "NES\x1A", 4) != 0) {
+        fprintf(stderr, "Not a NES rom\n");
+        return (1);
+    }
+
+    this->nes2 = (header->flags2 & 0x0c) == 0x08;
+    this->hash = this->_image->hash;
+    this->battery = (header->flags1 & 0x02) != 0;
+    this->trainer = (header->flags1 & 0x04) != 0;
+
+    if (header->flags1 & 0x08) {
+        this->mirroring = mirror_four_screen;
+    } else if (header->flags1 & 0x01) {
+        this->mirroring = mirror_vertical;
+    } else {
+        this->mirroring = mirror_horizontal;
+    }
+
+    size_t prg_ram_size, chr_ram_size;
+    uint8_t flags2;
+    flags2 = header->flags2;
+
+    if (this->nes2) {
+        this->mapper = (header->flags1 >> 4) | (header->flags2 & 0xf0) | ((header->mapper_msb & 0x0f) << 8);
+        this->submapper = header->mapper_msb >> 4;
+        this->region = (region_t)(header->timing & 0x03);
+
+        this->prg_size = rom_size(header->nrombank, header->prg_chr_msb & 0x0f, NES_PRG_UNIT);
+        this->chr_size = rom_size(header->nvrombank, header->prg_chr_msb >> 4, NES_CHR_UNIT);
+
+        prg_ram_size = ram_size(header->prg_ram & 0x0f) + ram_size(header->prg_ram >> 4);
+        chr_ram_size = ram_size(header->chr_ram & 0x0f) + ram_size(header->chr_ram >> 4);
+    } else {
+        /*
+         * Bytes 12 to 15 are unused in iNES, old tools wrote their
+         * name over byte 7 onwards; ignore all of those then.
+         */
+        bool garbage;
+        garbage = header->console != 0 || header->misc_roms != 0 || header->expansion != 0 ||
+            header->timing != 0;
+
+        flags2 = garbage ? 0 : header->flags2;
+
+        this->mapper = (header->flags1 >> 4) | (flags2 & 0xf0);
+        this->submapper = 0;
+        this->region = (!garbage && (header->prg_chr_msb & 0x01)) ? region_pal : region_ntsc;
+
+        this->prg_size = header->nrombank * NES_PRG_UNIT;
+        this->chr_size = header->nvrombank * NES_CHR_UNIT;
+
+        prg_ram_size = (garbage || header->mapper_msb == 0 ? 1 : header->mapper_msb) * 0x2000;
+        chr_ram_size = this->chr_size == 0 ? NES_CHR_UNIT : 0;
+    }
+
+    if ((flags2 & 0x03) != 0) {
+        fprintf(stderr, "Unsupported console type %hhu\n", flags2 & 0x03);
+        return (1);
+    }
+
+    if (this->prg_size == 0 || this->prg_size % NES_PRG_BANK != 0 ||
+        this->chr_size % NES_CHR_BANK != 0 || chr_ram_size % NES_CHR_BANK != 0) {
+        fprintf(stderr, "Bad PRG/CHR size %zu/%zu\n", this->prg_size, this->chr_size);
+        return (1);
+    }
+
+    size_t offset;
+    offset = NES_HEADER_SIZE + (this->trainer ? NES_TRAINER_SIZE : 0);
+
+    if (offset > this->_image->size || this->prg_size > this->_image->size - offset ||
+        this->chr_size > this->_image->size - offset - this->prg_size) {
+        fprintf(stderr, "Truncated image of %zu bytes for PRG/CHR size %zu/%zu\n",
+            this->_image->size, this->prg_size, this->chr_size);
+        return (1);
+    }
+
+    this->prg = this->_image->data + offset;
+    this->prg_ram.assign(prg_ram_size, 0);
+
+    if (this->chr_size > 0) {
+        this->chr = this->prg + this->prg_size;
+        this->chr_writable = false;
+    } else {
+        this->chr_ram.assign(chr_ram_size > 0 ? chr_ram_size : NES_CHR_UNIT, 0);
+        this->chr = &this->chr_ram[0];
+        this->chr_size = this->chr_ram.size();
+        this->chr_writable = true;
+    }
+
+    for (offset = 0; offset < this->prg_size; offset += NES_PRG_BANK) {
+        this->prg_banks.push_back(this->prg + offset);
+    }
+
+    for (offset = 0; offset < this->chr_size; offset += NES_CHR_BANK) {
+        this->chr_banks.push_back(this->chr + offset);
+    }
+
+    trace(TRACE_MAPPER, TRACE_INFO, "%s image, mapper %hu.%hhu\n",
+        this->nes2 ? "NES 2.0" : "iNES", this->mapper, this->submapper);
+    trace(TRACE_MAPPER, TRACE_INFO, "PRG-ROM %zu KiB, %s %zu KiB\n",
+        this->prg_size / 1024, this->chr_writable ? "CHR-RAM" : "CHR-ROM", this->chr_size / 1024);
+    trace(TRACE_MAPPER, TRACE_INFO, "PRG-RAM %zu KiB, battery %d, region %d\n",
+        this->prg_ram.size() / 1024, this->battery, this->region);
+
+    return (0);
+}
+
+/**
+ * Bank lookup for a window of size bytes, the bank number wraps
+ * around the image like the address lines of the real chips do.
+ */
+uint8_t *
+cartridge_t::prg_bank(unsigned int bank, size_t size)
+{
+    size_t count;
+    count = max(this->prg_size / size, (size_t)1);
+
+    return (this->prg_banks[(bank % count) * (size / NES_PRG_BANK)]);
+}
+
+uint8_t *
+cartridge_t::chr_bank(unsigned int bank, size_t size)
+{
+    size_t count;
+    count = max(this->chr_size / size, (size_t)1);
+
+    return (this->chr_banks[(bank % count) * (size / NES_CHR_BANK)]);
+}
@@ -1,6 +1,5 @@
 /**
  * Copyright (c) 2009 Roy van Dam <roy@8bit.cx>
- * Copyright (c) 2009 Ed Schouten <ed@80386.nl> (original mos6502 emulator in c)
  * All rights reserved.
  *
  * Redistribution and use in source and binary forms, with or without
@@ -25,64 +24,78 @@
  * SUCH DAMAGE.
  */
 
-#include "debug.hpp"
-#include "mos6502/emulator.hpp"
-using namespace mos6502;
+#include <string.h>
 
-void
-emulator_t::_store(_ins_store_t instruction, uint16_t address)
-{
-    uint8_t value;
-    value = (this->*instruction)();
-
-    debug("STORE: %hx: %hhu\n", address, value);
-    this->_write_byte(address, value);
-}
+#include "nes/controller.hpp"
+using namespace nes;
 
-void
-emulator_t::_store_abs(_ins_store_t instruction)
+controller_t::controller_t(void)
 {
-    this->_store(instruction, this->_addr_abs());
+    this->reset();
 }
 
 void
-emulator_t::_store_absx(_ins_store_t instruction)
+controller_t::reset(void)
 {
-    this->_store(instruction, this->_addr_absx());
+    memset(this->_buttons, 0, sizeof this->_buttons);
+    memset(this->_shift, 0, sizeof this->_shift);
+    this->_strobe = false;
 }
 
 void
-emulator_t::_store_absy(_ins_store_t instruction)
+controller_t::set_buttons(unsigned int port, uint8_t buttons)
 {
-    this->_store(instruction, this->_addr_absy());
+    this->_buttons[port] = buttons;
 }
 
-void
-emulator_t::_store_xind(_ins_store_t instruction)
+uint8_t
+controller_t::buttons(unsigned int port) const
 {
-    this->_store(instruction, this->_addr_xind());
+    return (this->_buttons[port]);
 }
 
-void
-emulator_t::_store_indy(_ins_store_t instruction)
+uint8_t
+controller_t::read(uint16_t address)
 {
-    this->_store(instruction, this->_addr_indy());
+    unsigned int port;
+    port = address - NES_CONTROLLER_PORT;
+
+    if (this->_strobe) {
+        this->_shift[port] = this->_buttons[port];
+    }
+
+    uint8_t value;
+    value = this->_shift[port] & 0x01;
+
+    if (!this->_strobe) {
+        this->_shift[port] = 0x80 | (this->_shift[port] >> 1);
+    }
+
+    return ((address >> 8) | value);
 }
 
 void
-emulator_t::_store_zpg(_ins_store_t instruction)
+controller_t::write(uint8_t value)
 {
-    this->_store(instruction, this->_addr_zpg());
+    this->_strobe = (value & 0x01) != 0;
+
+    if (this->_strobe) {
+        memcpy(this->_shift, this->_buttons, sizeof this->_shift);
+    }
 }
 
 void
-emulator_t::_store_zpgx(_ins_store_t instruction)
+controller_t::save(controller_state_t &state) const
 {
-    this->_store(instruction, this->_addr_zpgx());
+    memcpy(state.buttons, this->_buttons, sizeof state.buttons);
+    memcpy(state.shift, this->_shift, sizeof state.shift);
+    state.strobe = this->_strobe;
 }
 
 void
-emulator_t::_store_zpgy(_ins_store_t instruction)
+controller_t::load(const controller_state_t &state)
 {
-    this->_store(instruction, this->_addr_zpgy());
-}
\ No newline at end of file
+    memcpy(this->_buttons, state.buttons, sizeof this->_buttons);
+    memcpy(this->_shift, state.shift, sizeof this->_shift);
+    this->_strobe = state.strobe;
+}
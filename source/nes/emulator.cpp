@@ -24,54 +24,297 @@
  * SUCH DAMAGE.
  */
 
-#include "debug.hpp"
+#include "trace.hpp"
 #include "nes/emulator.hpp"
 using namespace nes;
 
+template class mos6502::core_t<nes::emulator_t>;
+
+emulator_t::emulator_t(void)
+    : ppu(video, scheduler), apu(memory, scheduler)
+{
+    this->mapper = NULL;
+    this->movie = NULL;
+    this->movie_mode = movie_off;
+    this->movie_position = 0;
+
+    memset(this->input, 0, sizeof this->input);
+}
+
+/**
+ * A copy in the same state, see fork(). Memory blocks are copied in one
+ * go and the maps copied along with them moved over to the copies, the
+ * mapper is duplicated with its banks, and the devices take over the
+ * events of the originals on the copied scheduler.
+ */
+emulator_t::emulator_t(const emulator_t &other)
+    : mos6502::core_t<emulator_t>(), io_handler_t(),
+      memory(other.memory), video(other.video), scheduler(other.scheduler), cartridge(other.cartridge),
+      mapper(other.mapper->clone(this->cartridge, this->memory, this->video, this->vram)),
+      ppu(other.ppu, video, scheduler, mapper, cartridge.chr, cartridge.chr_size),
+      apu(other.apu, memory, scheduler), controller(other.controller), resampler(other.resampler)
+{
+    memcpy(this->ram, other.ram, sizeof this->ram);
+    memcpy(this->vram, other.vram, sizeof this->vram);
+    memcpy(this->input, other.input, sizeof this->input);
+
+    this->memory.rebase(other.ram, sizeof this->ram, this->ram);
+    this->memory.rebind(&other, this);
+    this->video.rebase(other.vram, sizeof this->vram, this->vram);
+
+    if (!this->cartridge.prg_ram.empty()) {
+        this->memory.rebase(&other.cartridge.prg_ram[0], this->cartridge.prg_ram.size(),
+            &this->cartridge.prg_ram[0]);
+    }
+
+    if (!this->cartridge.chr_ram.empty()) {
+        this->video.rebase(&other.cartridge.chr_ram[0], this->cartridge.chr_ram.size(),
+            &this->cartridge.chr_ram[0]);
+    }
+
+    mos6502::state_t cpu;
+    other.save(cpu);
+
+    this->mos6502::core_t<emulator_t>::load(cpu);
+    this->enable_block_cache(other.block_cache_enabled());
+
+    this->movie = NULL;
+    this->movie_mode = movie_off;
+    this->movie_position = 0;
+}
+
+emulator_t::~emulator_t(void)
+{
+    delete this->mapper;
+}
+
 int
 emulator_t::load(string filename)
 {
-    int fd;
-    struct stat st;
-    uint8_t mapper;
-
-    if ((fd = open(filename.c_str(), O_RDONLY)) < 0) {
-        perror("open");
+    if (this->cartridge.load(filename) != 0) {
         return (1);
     }
 
-    if (fstat(fd, &st) == -1) {
-        perror("fstat");
+    return (this->_insert(filename.c_str()));
+}
+
+/**
+ * Power on with the cartridge of another instance, sharing its ROM
+ * image instead of mapping the file again.
+ */
+int
+emulator_t::load(const emulator_t &other)
+{
+    if (this->cartridge.share(other.cartridge) != 0) {
         return (1);
     }
 
-    this->rom = (uint8_t *)mmap(NULL, st.st_size, PROT_READ, MAP_FILE | MAP_PRIVATE, fd, 0);
-    this->rom_size = st.st_size - 16;
+    return (this->_insert("shared"));
+}
+
+/**
+ * A new instance in the same state, to explore another future of the
+ * game from here. The child shares the ROM image and gets its own RAM,
+ * banks and devices, copied from the parent's; rewind history and
+ * pending audio stay with the parent. Only the mutable state is copied,
+ * the framebuffer, audio buffers and decoded tiles of the child are
+ * allocated once it draws or plays.
+ */
+emulator_t *
+emulator_t::fork(void) const
+{
+    if (this->mapper == NULL) {
+        return (NULL);
+    }
+
+    return (new emulator_t(*this));
+}
+
+/**
+ * Power on with the cartridge that was just loaded.
+ */
+int
+emulator_t::_insert(const char *name)
+{
+    delete this->mapper;
+    this->mapper = mapper_t::create(this->cartridge, this->memory, this->video, this->vram);
 
-    if (this->rom == MAP_FAILED) {
-        perror("mmap");
+    if (this->mapper == NULL) {
+        fprintf(stderr, "%s: Unsupported mapper %hu\n", name, this->cartridge.mapper);
         return (1);
     }
 
     memset(this->ram, 0x42424242, sizeof this->ram);
-    this->rom_header = (rom_header_t *)this->rom;
-    if (memcmp(this->rom_header->name, "NES\x1A", 4) != 0) {
-        fprintf(stderr, "Not a NES rom\n");
-        return (1);
+    memset(this->vram, 0, sizeof this->vram);
+
+    /*
+     * Internal RAM and its mirrors, the PPU and APU registers and the
+     * cartridge RAM. The mapper takes the PRG-ROM window and the pattern
+     * tables and nametables on the PPU side, its registers are written
+     * through here so the PPU can catch up before banks change under it.
+     */
+    this->memory.map(0, NES_RAM_END, this->ram, sizeof this->ram, true);
+    this->memory.map_io(NES_IO_OFFSET, NES_IO_SIZE, this);
+    this->memory.map_io(NES_APU_OFFSET, NES_APU_SIZE, this);
+    this->memory.map_io(NES_ROM_OFFSET, NES_ROM_SIZE, this);
+
+    if (!this->cartridge.prg_ram.empty()) {
+        this->memory.map(NES_SRAM_OFFSET, NES_SRAM_SIZE, &this->cartridge.prg_ram[0],
+            this->cartridge.prg_ram.size(), true);
     }
 
-    printf("%hhu %hhu %hhx %hhx\n",
-        this->rom_header->nrombank, this->rom_header->nvrombank,
-        this->rom_header->flags1, this->rom_header->flags2);
-        
-    mapper = (this->rom_header->flags1 >> 4) | (this->rom_header->flags2 & 0xf0);
-    printf("Mapper: %hhu\n", mapper);
+    this->mapper->reset();
+    this->ppu.reset(this->mapper, this->cartridge.chr, this->cartridge.chr_size);
+    this->apu.reset(this->cycles());
+    this->controller.reset();
+    this->resampler.clear();
+    this->history.clear();
+
+    this->invalidate_blocks();
+    this->reset();
 
     return (0);
 }
 
+/**
+ * Power cycle for movies starting at power on: the CPU starts from the
+ * registers and cycle count of a new instance and the cartridge RAM is
+ * cleared, so a recording plays back the same whatever the instance
+ * ran before.
+ */
+int
+emulator_t::_power_on(void)
+{
+    mos6502::state_t cpu;
+    memset(&cpu, 0, sizeof cpu);
+    cpu.registers.program_counter = 0x8000;
+
+    this->mos6502::core_t<emulator_t>::load(cpu);
+
+    fill(this->cartridge.prg_ram.begin(), this->cartridge.prg_ram.end(), 0);
+    fill(this->cartridge.chr_ram.begin(), this->cartridge.chr_ram.end(), 0);
+
+    return (this->_insert("movie"));
+}
+
+static double
+elapsed(const struct timespec &start)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return ((now.tv_sec - start.tv_sec) + (now.tv_nsec - start.tv_nsec) / 1e9);
+}
+
+/**
+ * Run headless at full speed until one of the limits is reached. The
+ * CPU executes uninterrupted in batches that end at the next scheduled
+ * event, which then fires at that instruction boundary. A breakpoint
+ * makes the batches single instructions so the program counter can be
+ * checked after each of them, as does a masked IRQ so it is taken as
+ * soon as the interrupt disable flag clears. Each finished video frame
+ * ends an audio block and latches the input of the next one, see
+ * _end_frame(), before it is captured for rewinding so a restored
+ * snapshot carries the controller state the frame is resumed with.
+ */
+int
+emulator_t::run(const run_limits_t &limits, run_stats_t &stats)
+{
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    uint64_t cycles;
+    cycles = this->cycles();
+
+    unsigned long frame, last, iterations;
+    frame = this->ppu.frame();
+    last = frame;
+
+    stats.instructions = 0;
+
+    for (iterations = 0;; iterations++) {
+        if (limits.instructions && stats.instructions >= limits.instructions) {
+            stats.reason = stop_instructions;
+            break;
+        }
+
+        if (limits.cycles && this->cycles() - cycles >= limits.cycles) {
+            stats.reason = stop_cycles;
+            break;
+        }
+
+        if (limits.frames && this->ppu.frame() - frame >= limits.frames) {
+            stats.reason = stop_frames;
+            break;
+        }
+
+        if (limits.seconds > 0 && (iterations & 0x3ff) == 0 && elapsed(start) >= limits.seconds) {
+            stats.reason = stop_seconds;
+            break;
+        }
+
+        uint64_t deadline;
+        deadline = this->scheduler.next();
+
+        if (limits.cycles) {
+            deadline = min(deadline, cycles + limits.cycles);
+        }
+
+        unsigned long batch;
+        batch = deadline > this->cycles() ? (deadline - this->cycles()) / _MOS_MAX_CYCLES : 0;
+
+        if (limits.instructions) {
+            batch = min(batch, limits.instructions - stats.instructions);
+        }
+
+        if (batch == 0 || limits.breakpoint >= 0 || this->mapper->irq() || this->apu.irq()) {
+            batch = 1;
+        }
+
+        long executed;
+        executed = this->execute(batch);
+
+        if (executed < 0) {
+            stats.reason = stop_invalid;
+            break;
+        }
+
+        stats.instructions += executed;
+        this->scheduler.run(this->cycles());
+        this->_poll_interrupts();
+
+        if (this->ppu.frame() != last) {
+            last = this->ppu.frame();
+            this->apu.end_frame(this->cycles());
+
+            bool more;
+            more = this->_end_frame(stats.reason);
+            this->_capture();
+
+            if (!more) {
+                break;
+            }
+        }
+
+        if (limits.breakpoint >= 0 && this->registers().program_counter == limits.breakpoint) {
+            stats.reason = stop_breakpoint;
+            break;
+        }
+    }
+
+    stats.cycles = this->cycles() - cycles;
+    stats.frames = this->ppu.frame() - frame;
+    stats.seconds = elapsed(start);
+
+    return (stats.reason == stop_invalid ? 1 : 0);
+}
+
+/**
+ * Interactive single stepping, one instruction per line on stdin until
+ * end of input.
+ */
 int
-emulator_t::run(void)
+emulator_t::debugger(void)
 {
     for (;;) {
         if (this->step() != 0) {
@@ -79,7 +322,81 @@ emulator_t::run(void)
             return (1);
         }
 
+        this->scheduler.run(this->cycles());
+        this->_poll_interrupts();
+
         cin.ignore(numeric_limits<streamsize>::max(), '\n');
+
+        if (cin.eof()) {
+            break;
+        }
+    }
+
+    return (0);
+}
+
+int
+emulator_t::lockstep(emulator_t *reference, unsigned long count)
+{
+    mos6502::registers_t a, b;
+    unsigned long executed, stride;
+    long burst;
+    int result;
+
+    /*
+     * Run this instance through execute() in short bursts and the
+     * reference through as many step() calls, comparing the machine
+     * state after every burst. A burst ends early on a DMA stall.
+     */
+    for (executed = 0, result = 0; executed < count && result == 0; executed += stride) {
+        burst = this->execute(min(16UL, count - executed));
+        stride = burst < 0 ? min(16UL, count - executed) : burst;
+
+        for (unsigned long i = 0; i < stride && result == 0; i++) {
+            result = reference->step();
+        }
+
+        if ((burst < 0) != (result != 0)) {
+            fprintf(stderr, "Lockstep: result mismatch after %lu instructions\n", executed);
+            return (1);
+        }
+
+        reference->scheduler.run(reference->cycles());
+        reference->_poll_interrupts();
+        this->scheduler.run(this->cycles());
+        this->_poll_interrupts();
+
+        a = reference->registers();
+        b = this->registers();
+
+        if (a.program_counter != b.program_counter || a.accumulator != b.accumulator ||
+            a.index_x != b.index_x || a.index_y != b.index_y ||
+            a.stack_pointer != b.stack_pointer || a.status_flag != b.status_flag) {
+            fprintf(stderr, "Lockstep: register mismatch after %lu instructions\n", executed);
+            return (1);
+        }
+
+        if (reference->cycles() != this->cycles()) {
+            fprintf(stderr, "Lockstep: cycle mismatch after %lu instructions\n", executed);
+            return (1);
+        }
+
+        if (memcmp(reference->ram, this->ram, sizeof this->ram) != 0) {
+            fprintf(stderr, "Lockstep: memory mismatch after %lu instructions\n", executed);
+            return (1);
+        }
+    }
+
+    printf("Lockstep: %lu instructions, %llu cycles identical%s\n", executed,
+        (unsigned long long)this->cycles(), result != 0 ? " up to an invalid instruction" : "");
+
+    mos6502::block_stats_t stats;
+    stats = this->block_stats();
+
+    if (stats.hits + stats.misses > 0) {
+        printf("Block cache: %lu blocks, %.2f%% hit rate, %lu interpreted, %lu invalidations\n",
+            stats.blocks, 100.0 * stats.hits / (stats.hits + stats.misses),
+            stats.fallbacks, stats.invalidations);
     }
 
     return (0);
@@ -88,33 +405,580 @@ emulator_t::run(void)
 uint8_t
 emulator_t::read_byte(uint16_t address)
 {
-    if (address < 0x2000) {
-        uint8_t value;
-        value = this->ram[address % 0x800];
+    return (this->memory.read_byte(address));
+}
+
+void
+emulator_t::write_byte(uint16_t address, uint8_t value)
+{
+    this->memory.write_byte(address, value);
+}
+
+bool
+emulator_t::read_only(uint16_t address)
+{
+    return (this->memory.read_only(address));
+}
+
+const uint8_t *
+emulator_t::code_page(uint16_t address)
+{
+    return (this->memory.code_page(address));
+}
+
+uint8_t
+emulator_t::read_io(uint16_t address)
+{
+    if (address < NES_IO_OFFSET + NES_IO_SIZE) {
+        return (this->ppu.read(address, this->cycles()));
+    }
+
+    if (address == NES_APU_STATUS) {
+        return (this->apu.read(address, this->cycles()));
+    }
+
+    if (address == NES_CONTROLLER_PORT || address == NES_CONTROLLER_PORT + 1) {
+        return (this->controller.read(address));
+    }
+
+    trace(TRACE_MEMORY, TRACE_ERROR, "Bad read on %hx\n", address);
+    return (0);
+}
+
+void
+emulator_t::write_io(uint16_t address, uint8_t value)
+{
+    if (address < NES_IO_OFFSET + NES_IO_SIZE) {
+        this->ppu.write(address, value, this->cycles());
+        return;
+    }
+
+    if (address <= 0x4013 || address == NES_APU_STATUS || address == NES_APU_FRAME) {
+        this->apu.write(address, value, this->cycles());
+        return;
+    }
+
+    if (address == NES_OAM_DMA) {
+        this->_oam_dma(value);
+        return;
+    }
+
+    if (address == NES_CONTROLLER_PORT) {
+        this->controller.write(value);
+        return;
+    }
+
+    if (address >= NES_ROM_OFFSET) {
+        this->ppu.sync(this->cycles());
+        this->mapper->write_io(address, value);
+        return;
+    }
+
+    trace(TRACE_MEMORY, TRACE_ERROR, "Bad write on %hx: %hhx\n", address, value);
+}
+
+unsigned long
+emulator_t::frame(void) const
+{
+    return (this->ppu.frame());
+}
+
+const uint32_t *
+emulator_t::framebuffer(void) const
+{
+    return (this->ppu.framebuffer());
+}
+
+void
+emulator_t::attach_framebuffer(uint32_t *pixels, size_t pitch)
+{
+    this->ppu.attach_framebuffer(pixels, pitch);
+}
+
+/**
+ * Headless instances that never look at the picture can run without a
+ * framebuffer, framebuffer() is NULL then.
+ */
+void
+emulator_t::enable_framebuffer(bool enable)
+{
+    this->ppu.enable_framebuffer(enable);
+}
+
+/**
+ * Scanline or dot accurate PPU, from the next load on.
+ */
+void
+emulator_t::set_ppu_mode(ppu_mode_t mode)
+{
+    this->ppu.set_mode(mode);
+}
+
+/**
+ * Host audio rate, NES_AUDIO_RATE unless set.
+ */
+void
+emulator_t::set_audio_rate(double rate)
+{
+    this->resampler.configure(this->apu.rate(), rate);
+}
+
+/**
+ * Nudge the audio rate to follow video pacing, see resampler_t.
+ */
+void
+emulator_t::adjust_audio_rate(double ratio)
+{
+    this->resampler.adjust(ratio);
+}
+
+/**
+ * Audio at the host rate, produced at the end of every frame and
+ * pulled into the caller's buffer.
+ */
+size_t
+emulator_t::audio_available(void) const
+{
+    return (this->resampler.available(this->apu.available()));
+}
+
+size_t
+emulator_t::read_audio(float *output, size_t count)
+{
+    return (this->resampler.pull(this->apu, output, count));
+}
+
+/**
+ * Rewind history of budget bytes, see rewind_t, zero turns it off.
+ */
+void
+emulator_t::enable_rewind(size_t budget, unsigned int interval)
+{
+    this->history.configure(budget, interval);
+}
+
+/**
+ * Go back the given number of frames, or to the oldest snapshot when
+ * the history does not reach that far. History after it is dropped.
+ */
+int
+emulator_t::rewind(unsigned long frames)
+{
+    unsigned long frame;
+    frame = this->ppu.frame() - min(frames, this->ppu.frame());
+
+    this->snapshot.resize(this->state_size());
+
+    if (this->history.seek(frame, &this->snapshot[0], this->snapshot.size()) < 0) {
+        return (1);
+    }
+
+    return (this->load_state(&this->snapshot[0], this->snapshot.size()));
+}
+
+rewind_stats_t
+emulator_t::rewind_stats(void) const
+{
+    return (this->history.stats());
+}
+
+/**
+ * Buttons held on a controller port, latched on the next frame
+ * boundary so a frame always sees the same input from start to end.
+ */
+void
+emulator_t::set_buttons(unsigned int port, uint8_t buttons)
+{
+    this->input[port] = buttons;
+}
+
+/**
+ * Record the input of the first ports into a movie from now on, along
+ * with a checkpoint every interval frames. The movie starts from the
+ * current state, or from power on.
+ */
+int
+emulator_t::record(movie_t *movie, bool from_state, unsigned int ports, unsigned int interval)
+{
+    if (this->mapper == NULL || ports == 0 || ports > NES_CONTROLLER_PORTS) {
+        return (1);
+    }
+
+    if (!from_state && this->_power_on() != 0) {
+        return (1);
+    }
+
+    movie->start(this->cartridge.hash, ports, interval, this->ppu.mode());
+
+    if (from_state) {
+        this->snapshot.resize(this->state_size());
+        this->save_state(&this->snapshot[0]);
+        movie->set_state(&this->snapshot[0], this->snapshot.size());
+    }
+
+    this->movie = movie;
+    this->movie_mode = movie_record;
+    this->movie_position = 0;
+    this->_latch_input();
+
+    return (0);
+}
+
+/**
+ * Play a movie back from its starting state, or from power on in the
+ * PPU mode it was recorded in. Input set with set_buttons is ignored
+ * until the movie ends, run() then stops with stop_movie_end, or with
+ * stop_desync as soon as a checkpoint does not match.
+ */
+int
+emulator_t::play(movie_t *movie)
+{
+    if (this->mapper == NULL || movie->rom_hash() != this->cartridge.hash) {
+        fprintf(stderr, "Movie of another ROM\n");
+        return (1);
+    }
 
-        if (value == 0x42) {
-            debug("Address %hx may not be initialized\n", address);
+    if (movie->frames() == 0) {
+        fprintf(stderr, "Empty movie\n");
+        return (1);
+    }
+
+    if (movie->state().empty()) {
+        this->set_ppu_mode((ppu_mode_t)movie->ppu_mode());
+
+        if (this->_power_on() != 0) {
+            return (1);
         }
+    } else if (this->load_state(&movie->state()[0], movie->state().size()) != 0) {
+        return (1);
+    }
 
-        return (value);
-    } else if (address == 0x2002) {
-        /* XXX: Hit and vblank flags. */
-        return (0xc0);
-    } else if ((address >= NES_ROM_OFFSET) && (address < (NES_ROM_OFFSET + this->rom_size))) {
-        return rom[address - NES_ROM_OFFSET + 16];
-    } else {
-        debug("Bad read on %hx\n", address);
-        return (0);
+    this->movie = movie;
+    this->movie_mode = movie_play;
+    this->movie_position = 0;
+    this->_latch_input();
+
+    return (0);
+}
+
+void
+emulator_t::stop_movie(void)
+{
+    this->movie = NULL;
+    this->movie_mode = movie_off;
+}
+
+/**
+ * Frames recorded or played since the movie started, on a desync the
+ * frame after which the checkpoint did not match.
+ */
+unsigned long
+emulator_t::movie_frame(void) const
+{
+    return (this->movie_position);
+}
+
+/**
+ * Hash of the save-state, FNV-1a over 64 bit words folded back on
+ * itself so the high bits of every word reach the whole hash.
+ */
+uint64_t
+emulator_t::state_hash(void)
+{
+    this->snapshot.resize(this->state_size());
+    this->save_state(&this->snapshot[0]);
+
+    const uint8_t *state;
+    state = &this->snapshot[0];
+
+    size_t size, i;
+    size = this->snapshot.size();
+
+    uint64_t hash;
+    hash = 0xcbf29ce484222325ULL;
+
+    for (i = 0; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t)) {
+        uint64_t word;
+        memcpy(&word, state + i, sizeof word);
+
+        hash = (hash ^ word) * 0x100000001b3ULL;
+        hash ^= hash >> 32;
+    }
+
+    for (; i < size; i++) {
+        hash = (hash ^ state[i]) * 0x100000001b3ULL;
+    }
+
+    return (hash);
+}
+
+/**
+ * Frame boundary: a recording keeps the input of the frame that just
+ * ended, a movie takes or checks its checkpoint, then the input of the
+ * next frame is latched. False when a replay ran out of frames or
+ * diverged from its recording.
+ */
+bool
+emulator_t::_end_frame(stop_reason_t &reason)
+{
+    if (this->movie_mode == movie_record) {
+        uint8_t buttons[NES_CONTROLLER_PORTS];
+
+        for (unsigned int port = 0; port < NES_CONTROLLER_PORTS; port++) {
+            buttons[port] = this->controller.buttons(port);
+        }
+
+        this->movie->add_input(buttons);
+    }
+
+    if (this->movie_mode != movie_off) {
+        this->movie_position++;
+
+        if (this->movie_position % this->movie->interval() == 0) {
+            uint64_t hash;
+            hash = this->state_hash();
+
+            size_t index;
+            index = this->movie_position / this->movie->interval() - 1;
+
+            if (this->movie_mode == movie_record) {
+                this->movie->add_checkpoint(hash);
+            } else if (index < this->movie->checkpoints() && this->movie->checkpoint(index) != hash) {
+                this->movie_mode = movie_off;
+                reason = stop_desync;
+                return (false);
+            }
+        }
+
+        if (this->movie_mode == movie_play && this->movie_position >= this->movie->frames()) {
+            this->movie_mode = movie_off;
+            reason = stop_movie_end;
+            return (false);
+        }
     }
+
+    this->_latch_input();
+    return (true);
 }
 
+/**
+ * Input of the next frame: from the movie when playing, otherwise the
+ * buttons last set. Ports a movie does not cover read as released.
+ */
 void
-emulator_t::write_byte(uint16_t address, uint8_t value)
+emulator_t::_latch_input(void)
 {
-    if (address < 0x2000) {
-        debug("RAM write on %hx\n", address);
-        this->ram[address % 0x800] = value;
+    const uint8_t *buttons;
+    buttons = this->input;
+
+    unsigned int ports;
+    ports = NES_CONTROLLER_PORTS;
+
+    if (this->movie_mode != movie_off) {
+        ports = this->movie->ports();
+    }
+
+    if (this->movie_mode == movie_play) {
+        buttons = this->movie->input(this->movie_position);
+    }
+
+    for (unsigned int port = 0; port < NES_CONTROLLER_PORTS; port++) {
+        this->controller.set_buttons(port, port < ports ? buttons[port] : 0);
+    }
+}
+
+void
+emulator_t::_capture(void)
+{
+    if (!this->history.enabled()) {
+        return;
+    }
+
+    this->snapshot.resize(this->state_size());
+    this->save_state(&this->snapshot[0]);
+    this->history.capture(this->ppu.frame(), &this->snapshot[0], this->snapshot.size());
+}
+
+/**
+ * Sprite DMA from a CPU page. RAM and ROM pages are copied into OAM
+ * straight from host memory, only I/O pages are read a byte at a time
+ * with their side effects. The CPU is halted for 513 cycles, one more
+ * when the transfer starts on an odd cycle.
+ */
+void
+emulator_t::_oam_dma(uint8_t page)
+{
+    uint16_t address;
+    address = page << NES_PAGE_SHIFT;
+
+    const uint8_t *source;
+    source = this->memory.code_page(address);
+
+    if (source == NULL) {
+        uint8_t buffer[NES_OAM_SIZE];
+
+        for (unsigned int i = 0; i < NES_OAM_SIZE; i++) {
+            buffer[i] = this->memory.read_byte(address + i);
+        }
+
+        this->ppu.dma(buffer, this->cycles());
     } else {
-        debug("Bad write on %hx: %hhx\n", address, value);
+        this->ppu.dma(source, this->cycles());
+    }
+
+    this->stall(NES_OAM_DMA_CYCLES + (this->cycles() & 1));
+}
+
+/**
+ * Save-states, see state_header_t for the layout. The size only
+ * depends on the cartridge, so one buffer serves every state of a run.
+ */
+size_t
+emulator_t::state_size(void) const
+{
+    return (sizeof(state_header_t) + sizeof(mos6502::state_t) + sizeof this->ram +
+        sizeof this->vram + sizeof(ppu_state_t) + sizeof(apu_state_t) + sizeof(controller_state_t) +
+        sizeof(mapper_state_t) +
+        this->cartridge.prg_ram.size() + this->cartridge.chr_ram.size());
+}
+
+static uint8_t *
+put(uint8_t *state, const void *block, size_t size)
+{
+    memcpy(state, block, size);
+    return (state + size);
+}
+
+static const uint8_t *
+get(const uint8_t *state, void *block, size_t size)
+{
+    memcpy(block, state, size);
+    return (state + size);
+}
+
+/**
+ * Blocks are cleared before they are filled so padding saves as zeros
+ * and equal machines give equal states.
+ */
+void
+emulator_t::save_state(uint8_t *state) const
+{
+    state_header_t header;
+    mos6502::state_t cpu;
+    ppu_state_t ppu;
+    apu_state_t apu;
+    controller_state_t controller;
+    mapper_state_t mapper;
+
+    memset(&header, 0, sizeof header);
+    memset(&cpu, 0, sizeof cpu);
+    memset(&ppu, 0, sizeof ppu);
+    memset(&apu, 0, sizeof apu);
+    memset(&controller, 0, sizeof controller);
+    memset(&mapper, 0, sizeof mapper);
+
+    header.magic = NES_STATE_MAGIC;
+    header.version = NES_STATE_VERSION;
+    header.size = this->state_size();
+    header.rom_hash = this->cartridge.hash;
+    header.prg_ram_size = this->cartridge.prg_ram.size();
+    header.chr_ram_size = this->cartridge.chr_ram.size();
+
+    this->save(cpu);
+    this->ppu.save(ppu);
+    this->apu.save(apu);
+    this->controller.save(controller);
+    this->mapper->save(mapper);
+
+    state = put(state, &header, sizeof header);
+    state = put(state, &cpu, sizeof cpu);
+    state = put(state, this->ram, sizeof this->ram);
+    state = put(state, this->vram, sizeof this->vram);
+    state = put(state, &ppu, sizeof ppu);
+    state = put(state, &apu, sizeof apu);
+    state = put(state, &controller, sizeof controller);
+    state = put(state, &mapper, sizeof mapper);
+    state = put(state, this->cartridge.prg_ram.data(), this->cartridge.prg_ram.size());
+    state = put(state, this->cartridge.chr_ram.data(), this->cartridge.chr_ram.size());
+}
+
+/**
+ * A state is rejected before anything is restored unless its header
+ * matches this ROM and every component accepts its block, so a corrupt
+ * state leaves the machine as it was.
+ */
+int
+emulator_t::load_state(const uint8_t *state, size_t size)
+{
+    state_header_t header;
+
+    if (size < sizeof header) {
+        fprintf(stderr, "Truncated state\n");
+        return (1);
     }
-}
\ No newline at end of file
+
+    state = get(state, &header, sizeof header);
+
+    if (header.magic != NES_STATE_MAGIC || header.version != NES_STATE_VERSION) {
+        fprintf(stderr, "Unsupported state version %u\n", header.version);
+        return (1);
+    }
+
+    if (header.rom_hash != this->cartridge.hash || header.size != this->state_size() || size < header.size ||
+        header.prg_ram_size != this->cartridge.prg_ram.size() ||
+        header.chr_ram_size != this->cartridge.chr_ram.size()) {
+        fprintf(stderr, "State of another ROM\n");
+        return (1);
+    }
+
+    mos6502::state_t cpu;
+    ppu_state_t ppu;
+    apu_state_t apu;
+    controller_state_t controller;
+    mapper_state_t mapper;
+
+    const uint8_t *memory;
+    state = get(state, &cpu, sizeof cpu);
+    memory = state;
+    state += sizeof this->ram + sizeof this->vram;
+    state = get(state, &ppu, sizeof ppu);
+    state = get(state, &apu, sizeof apu);
+    state = get(state, &controller, sizeof controller);
+    state = get(state, &mapper, sizeof mapper);
+
+    if (this->mapper->check(mapper) != 0 || this->ppu.check(ppu, cpu.cycles) != 0 ||
+        this->apu.check(apu, cpu.cycles) != 0) {
+        fprintf(stderr, "Corrupt state\n");
+        return (1);
+    }
+
+    memory = get(memory, this->ram, sizeof this->ram);
+    memory = get(memory, this->vram, sizeof this->vram);
+    state = get(state, this->cartridge.prg_ram.data(), this->cartridge.prg_ram.size());
+    state = get(state, this->cartridge.chr_ram.data(), this->cartridge.chr_ram.size());
+
+    this->mos6502::core_t<emulator_t>::load(cpu);
+    this->mapper->load(mapper);
+    this->ppu.load(ppu);
+    this->apu.load(apu);
+    this->controller.load(controller);
+
+    return (0);
+}
+
+/**
+ * The PPU NMI is edge triggered and taken once. The cartridge and APU
+ * IRQs are level triggered: they are taken whenever a line is asserted
+ * and interrupts are enabled, until the device drops it.
+ */
+void
+emulator_t::_poll_interrupts(void)
+{
+    if (this->ppu.nmi()) {
+        this->interrupt(NES_NMI_VECTOR);
+    }
+
+    if ((this->mapper->irq() || this->apu.irq()) && !(this->registers().status_flag & _MOS_RF_NOINTERRUPT)) {
+        this->interrupt(NES_IRQ_VECTOR);
+    }
+}
@@ -0,0 +1,274 @@
+/**
+ * Copyright (c) 2009 Roy van Dam <roy@8bit.cx>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include <string.h>
+
+#include <algorithm>
+using namespace std;
+
+#include "trace.hpp"
+#include "nes/mapper.hpp"
+using namespace nes;
+
+mapper_t::mapper_t(cartridge_t &cartridge, memory_map_t &cpu, memory_map_t &ppu, uint8_t *vram)
+    : cartridge(cartridge), cpu(cpu), ppu(ppu), vram(vram)
+{
+    this->irq_line = false;
+}
+
+mapper_t *
+mapper_t::create(cartridge_t &cartridge, memory_map_t &cpu, memory_map_t &ppu, uint8_t *vram)
+{
+    switch (cartridge.mapper) {
+        case 0:
+            return (new nrom_t(cartridge, cpu, ppu, vram));
+
+        case 1:
+            return (new mmc1_t(cartridge, cpu, ppu, vram));
+
+        case 2:
+            return (new uxrom_t(cartridge, cpu, ppu, vram));
+
+        case 3:
+            return (new cnrom_t(cartridge, cpu, ppu, vram));
+
+        case 4:
+            return (new mmc3_t(cartridge, cpu, ppu, vram));
+
+        default:
+            return (NULL);
+    }
+}
+
+/**
+ * The same mapper in the same state on another cartridge and address
+ * spaces, for a copy of the machine. Its registers go through the
+ * saved state, which switches the banks in on the new maps.
+ */
+mapper_t *
+mapper_t::clone(cartridge_t &cartridge, memory_map_t &cpu, memory_map_t &ppu, uint8_t *vram) const
+{
+    mapper_t *mapper = create(cartridge, cpu, ppu, vram);
+
+    if (mapper != NULL) {
+        mapper_state_t state;
+        memset(&state, 0, sizeof state);
+
+        this->save(state);
+        mapper->load(state);
+    }
+
+    return (mapper);
+}
+
+/**
+ * Power-on state: the first and last 16 KiB of PRG-ROM, the first
+ * 8 KiB of CHR and the mirroring from the header. Mappers override
+ * this to set up their registers after calling it.
+ */
+void
+mapper_t::reset(void)
+{
+    this->irq_line = false;
+
+    this->_map_prg(0x8000, 0x4000, 0);
+    this->_map_prg(0xc000, 0x4000, this->_last_prg(0x4000));
+    this->_map_chr(0x0000, NES_PATTERN_SIZE, 0);
+    this->_mirror(this->cartridge.mirroring);
+}
+
+/**
+ * The base state is the IRQ line, mappers with registers add them and
+ * rebuild their banks on load. A state is checked before it is loaded:
+ * it must come from the same mapper, and mappers whose registers index
+ * tables reject values they could never have written themselves.
+ * Bank numbers need no check, they wrap around the cartridge.
+ */
+void
+mapper_t::save(mapper_state_t &state) const
+{
+    state.mapper = this->cartridge.mapper;
+    state.irq_line = this->irq_line;
+}
+
+int
+mapper_t::check(const mapper_state_t &state) const
+{
+    return (state.mapper != this->cartridge.mapper);
+}
+
+void
+mapper_t::load(const mapper_state_t &state)
+{
+    this->irq_line = state.irq_line;
+}
+
+bool
+mapper_t::counts_scanlines(void) const
+{
+    return (false);
+}
+
+void
+mapper_t::scanline(void)
+{
+}
+
+uint8_t
+mapper_t::read_io(uint16_t address)
+{
+    trace(TRACE_MAPPER, TRACE_ERROR, "Bad read on %hx\n", address);
+    return (0);
+}
+
+void
+mapper_t::write_io(uint16_t address, uint8_t value)
+{
+    trace(TRACE_MAPPER, TRACE_ERROR, "Bad write on %hx: %hhx\n", address, value);
+}
+
+/**
+ * Point a CPU window at a PRG-ROM bank of the same size, a window
+ * larger than the whole image mirrors it.
+ */
+void
+mapper_t::_map_prg(uint16_t address, size_t size, unsigned int bank)
+{
+    this->cpu.map(address, size, this->cartridge.prg_bank(bank, size),
+        min(size, this->cartridge.prg_size), false);
+}
+
+void
+mapper_t::_map_chr(uint16_t address, size_t size, unsigned int bank)
+{
+    this->ppu.map(address, size, this->cartridge.chr_bank(bank, size),
+        min(size, this->cartridge.chr_size), this->cartridge.chr_writable);
+}
+
+unsigned int
+mapper_t::_last_prg(size_t size) const
+{
+    return (max(this->cartridge.prg_size / size, (size_t)1) - 1);
+}
+
+/**
+ * Point the four nametables, and their mirror up to the palette, at
+ * the console VRAM. Four screen boards bring the other 2 KiB along.
+ */
+void
+mapper_t::_mirror(mirroring_t mirroring)
+{
+    static const uint8_t layouts[][4] = {
+        { 0, 0, 1, 1 },     // Horizontal
+        { 0, 1, 0, 1 },     // Vertical
+        { 0, 1, 2, 3 },     // Four screen
+        { 0, 0, 0, 0 },     // Single screen, lower
+        { 1, 1, 1, 1 },     // Single screen, upper
+    };
+
+    for (unsigned int i = 0; i < 4; i++) {
+        uint8_t *table;
+        table = this->vram + layouts[mirroring][i] * NES_NAMETABLE_SIZE;
+
+        uint16_t address;
+        address = NES_NAMETABLE_OFFSET + i * NES_NAMETABLE_SIZE;
+
+        this->ppu.map(address, NES_NAMETABLE_SIZE, table, NES_NAMETABLE_SIZE, true);
+        this->ppu.map(address + 0x1000, min(NES_NAMETABLE_END - (address + 0x1000), NES_NAMETABLE_SIZE),
+            table, NES_NAMETABLE_SIZE, true);
+    }
+}
+
+nrom_t::nrom_t(cartridge_t &cartridge, memory_map_t &cpu, memory_map_t &ppu, uint8_t *vram)
+    : mapper_t(cartridge, cpu, ppu, vram)
+{
+}
+
+uxrom_t::uxrom_t(cartridge_t &cartridge, memory_map_t &cpu, memory_map_t &ppu, uint8_t *vram)
+    : mapper_t(cartridge, cpu, ppu, vram)
+{
+}
+
+void
+uxrom_t::reset(void)
+{
+    mapper_t::reset();
+    this->_bank = 0;
+}
+
+void
+uxrom_t::save(mapper_state_t &state) const
+{
+    mapper_t::save(state);
+    state.registers[0] = this->_bank;
+}
+
+void
+uxrom_t::load(const mapper_state_t &state)
+{
+    mapper_t::load(state);
+    this->write_io(NES_ROM_OFFSET, state.registers[0]);
+}
+
+void
+uxrom_t::write_io(uint16_t address, uint8_t value)
+{
+    this->_bank = value;
+    this->_map_prg(0x8000, 0x4000, value);
+}
+
+cnrom_t::cnrom_t(cartridge_t &cartridge, memory_map_t &cpu, memory_map_t &ppu, uint8_t *vram)
+    : mapper_t(cartridge, cpu, ppu, vram)
+{
+}
+
+void
+cnrom_t::reset(void)
+{
+    mapper_t::reset();
+    this->_bank = 0;
+}
+
+void
+cnrom_t::save(mapper_state_t &state) const
+{
+    mapper_t::save(state);
+    state.registers[0] = this->_bank;
+}
+
+void
+cnrom_t::load(const mapper_state_t &state)
+{
+    mapper_t::load(state);
+    this->write_io(NES_ROM_OFFSET, state.registers[0]);
+}
+
+void
+cnrom_t::write_io(uint16_t address, uint8_t value)
+{
+    this->_bank = value;
+    this->_map_chr(0x0000, NES_PATTERN_SIZE, value);
+}
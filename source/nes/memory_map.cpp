@@ -0,0 +1,141 @@
+/**
+ * Copyright (c) 2009 Roy van Dam <roy@8bit.cx>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include <string.h>
+
+#include "trace.hpp"
+#include "nes/memory_map.hpp"
+using namespace nes;
+
+memory_map_t::memory_map_t(void)
+{
+    memset(this->_pages, 0, sizeof this->_pages);
+}
+
+/**
+ * Map host memory of the given length over size bytes of address
+ * space starting at address. The memory is mirrored when the range is
+ * larger than the memory, e.g. the 2 KiB of internal RAM over 8 KiB.
+ */
+void
+memory_map_t::map(uint16_t address, size_t size, uint8_t *memory, size_t length, bool writable)
+{
+    size_t offset;
+
+    for (offset = 0; offset < size; offset += NES_PAGE_SIZE) {
+        page_t &page = this->_pages[(address + offset) >> NES_PAGE_SHIFT];
+
+        page.read = memory + (offset % length);
+        page.write = writable ? page.read : NULL;
+    }
+}
+
+/**
+ * Route the accesses on a range that do not go through a page pointer
+ * to an I/O handler: all of them for plain register pages, only the
+ * writes for read-only memory with registers behind it.
+ */
+void
+memory_map_t::map_io(uint16_t address, size_t size, io_handler_t *io)
+{
+    size_t offset;
+
+    for (offset = 0; offset < size; offset += NES_PAGE_SIZE) {
+        this->_pages[(address + offset) >> NES_PAGE_SHIFT].io = io;
+    }
+}
+
+void
+memory_map_t::unmap(uint16_t address, size_t size)
+{
+    size_t offset;
+
+    for (offset = 0; offset < size; offset += NES_PAGE_SIZE) {
+        page_t &page = this->_pages[(address + offset) >> NES_PAGE_SHIFT];
+
+        page.read = NULL;
+        page.write = NULL;
+        page.io = NULL;
+    }
+}
+
+/**
+ * Move the pages backed by size bytes of host memory at from to the
+ * same offsets in to, and the pages of one I/O handler to another, so
+ * a copy of a map addresses copies of the memory and devices.
+ */
+void
+memory_map_t::rebase(const uint8_t *from, size_t size, uint8_t *to)
+{
+    for (unsigned int i = 0; i < NES_PAGES; i++) {
+        page_t &page = this->_pages[i];
+
+        if (page.read == NULL || (uintptr_t)page.read - (uintptr_t)from >= size) {
+            continue;
+        }
+
+        page.read = to + (page.read - from);
+        page.write = page.write != NULL ? page.read : NULL;
+    }
+}
+
+void
+memory_map_t::rebind(const io_handler_t *from, io_handler_t *to)
+{
+    for (unsigned int i = 0; i < NES_PAGES; i++) {
+        if (this->_pages[i].io == from) {
+            this->_pages[i].io = to;
+        }
+    }
+}
+
+uint8_t
+memory_map_t::_read_io(uint16_t address)
+{
+    io_handler_t *io;
+    io = this->_pages[address >> NES_PAGE_SHIFT].io;
+
+    if (io == NULL) {
+        trace(TRACE_MEMORY, TRACE_ERROR, "Bad read on %hx\n", address);
+        return (0);
+    }
+
+    return (io->read_io(address));
+}
+
+void
+memory_map_t::_write_io(uint16_t address, uint8_t value)
+{
+    io_handler_t *io;
+    io = this->_pages[address >> NES_PAGE_SHIFT].io;
+
+    if (io == NULL) {
+        trace(TRACE_MEMORY, TRACE_ERROR, "Bad write on %hx: %hhx\n", address, value);
+        return;
+    }
+
+    io->write_io(address, value);
+}
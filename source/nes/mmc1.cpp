@@ -0,0 +1,179 @@
+/**
+ * Copyright (c) 2009 Roy van Dam <roy@8bit.cx>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include "trace.hpp"
+#include "nes/mapper.hpp"
+using namespace nes;
+
+mmc1_t::mmc1_t(cartridge_t &cartridge, memory_map_t &cpu, memory_map_t &ppu, uint8_t *vram)
+    : mapper_t(cartridge, cpu, ppu, vram)
+{
+}
+
+void
+mmc1_t::reset(void)
+{
+    mapper_t::reset();
+
+    this->_shift = 0;
+    this->_count = 0;
+    this->_control = 0x0c;
+    this->_chr[0] = 0;
+    this->_chr[1] = 0;
+    this->_prg = 0;
+
+    this->_update();
+}
+
+void
+mmc1_t::save(mapper_state_t &state) const
+{
+    mapper_t::save(state);
+
+    state.registers[0] = this->_shift;
+    state.registers[1] = this->_count;
+    state.registers[2] = this->_control;
+    state.registers[3] = this->_chr[0];
+    state.registers[4] = this->_chr[1];
+    state.registers[5] = this->_prg;
+}
+
+/**
+ * The shift register holds fewer than five bits.
+ */
+int
+mmc1_t::check(const mapper_state_t &state) const
+{
+    if (mapper_t::check(state) != 0) {
+        return (1);
+    }
+
+    return (state.registers[1] >= 5 || state.registers[0] >= 1 << state.registers[1]);
+}
+
+void
+mmc1_t::load(const mapper_state_t &state)
+{
+    mapper_t::load(state);
+
+    this->_shift = state.registers[0];
+    this->_count = state.registers[1];
+    this->_control = state.registers[2];
+    this->_chr[0] = state.registers[3];
+    this->_chr[1] = state.registers[4];
+    this->_prg = state.registers[5];
+
+    this->_update();
+}
+
+/**
+ * Writes shift bit 0 in, least significant first, and the fifth write
+ * stores the value in the register selected by address bits 13-14.
+ * Bit 7 resets the shift register and fixes the last PRG bank.
+ */
+void
+mmc1_t::write_io(uint16_t address, uint8_t value)
+{
+    if (value & 0x80) {
+        this->_shift = 0;
+        this->_count = 0;
+        this->_control |= 0x0c;
+        this->_update();
+        return;
+    }
+
+    this->_shift |= (value & 0x01) << this->_count;
+
+    if (++this->_count < 5) {
+        return;
+    }
+
+    switch ((address >> 13) & 0x03) {
+        case 0:
+            this->_control = this->_shift;
+            break;
+
+        case 1:
+            this->_chr[0] = this->_shift;
+            break;
+
+        case 2:
+            this->_chr[1] = this->_shift;
+            break;
+
+        case 3:
+            this->_prg = this->_shift;
+            break;
+    }
+
+    trace(TRACE_MAPPER, TRACE_VERBOSE, "MMC1 register %hx = %hhx\n", address & 0xe000, this->_shift);
+
+    this->_shift = 0;
+    this->_count = 0;
+    this->_update();
+}
+
+void
+mmc1_t::_update(void)
+{
+    static const mirroring_t mirroring[4] = {
+        mirror_single_lower, mirror_single_upper, mirror_vertical, mirror_horizontal
+    };
+
+    this->_mirror(mirroring[this->_control & 0x03]);
+
+    /*
+     * SUROM and friends use CHR bank bit 4 to select the 256 KiB half
+     * of a 512 KiB PRG-ROM.
+     */
+    unsigned int outer, bank;
+    outer = this->cartridge.prg_size > 0x40000 ? this->_chr[0] & 0x10 : 0;
+    bank = (this->_prg & 0x0f) | outer;
+
+    switch ((this->_control >> 2) & 0x03) {
+        case 0:
+        case 1:
+            this->_map_prg(0x8000, 0x8000, bank >> 1);
+            break;
+
+        case 2:
+            this->_map_prg(0x8000, 0x4000, outer);
+            this->_map_prg(0xc000, 0x4000, bank);
+            break;
+
+        case 3:
+            this->_map_prg(0x8000, 0x4000, bank);
+            this->_map_prg(0xc000, 0x4000, 0x0f | outer);
+            break;
+    }
+
+    if (this->_control & 0x10) {
+        this->_map_chr(0x0000, 0x1000, this->_chr[0]);
+        this->_map_chr(0x1000, 0x1000, this->_chr[1]);
+    } else {
+        this->_map_chr(0x0000, NES_PATTERN_SIZE, this->_chr[0] >> 1);
+    }
+}
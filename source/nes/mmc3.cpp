@@ -0,0 +1,222 @@
+/**
+ * Copyright (c) 2009 Roy van Dam <roy@8bit.cx>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include <string.h>
+
+#include "trace.hpp"
+#include "nes/mapper.hpp"
+using namespace nes;
+
+mmc3_t::mmc3_t(cartridge_t &cartridge, memory_map_t &cpu, memory_map_t &ppu, uint8_t *vram)
+    : mapper_t(cartridge, cpu, ppu, vram)
+{
+}
+
+void
+mmc3_t::reset(void)
+{
+    static const uint8_t banks[8] = { 0, 2, 4, 5, 6, 7, 0, 1 };
+
+    mapper_t::reset();
+
+    this->_select = 0;
+    memcpy(this->_banks, banks, sizeof this->_banks);
+    this->_latch = 0;
+    this->_counter = 0;
+    this->_reload = false;
+    this->_enabled = false;
+    this->_mirroring = this->cartridge.mirroring;
+
+    this->_update_prg();
+    this->_update_chr();
+}
+
+bool
+mmc3_t::counts_scanlines(void) const
+{
+    return (true);
+}
+
+/**
+ * Clocked by the rise of PPU A12 once per rendered scanline. The
+ * counter reloads when it is zero or a reload was requested, and
+ * otherwise counts down; reaching zero raises the IRQ line if enabled.
+ */
+void
+mmc3_t::scanline(void)
+{
+    if (this->_counter == 0 || this->_reload) {
+        this->_counter = this->_latch;
+        this->_reload = false;
+    } else {
+        this->_counter--;
+    }
+
+    if (this->_counter == 0 && this->_enabled) {
+        trace(TRACE_MAPPER, TRACE_VERBOSE, "MMC3 IRQ\n");
+        this->irq_line = true;
+    }
+}
+
+void
+mmc3_t::save(mapper_state_t &state) const
+{
+    mapper_t::save(state);
+
+    state.registers[0] = this->_select;
+    memcpy(state.registers + 1, this->_banks, sizeof this->_banks);
+    state.registers[9] = this->_latch;
+    state.registers[10] = this->_counter;
+    state.registers[11] = this->_reload;
+    state.registers[12] = this->_enabled;
+    state.registers[13] = this->_mirroring;
+}
+
+/**
+ * The mirroring indexes the nametable layouts.
+ */
+int
+mmc3_t::check(const mapper_state_t &state) const
+{
+    if (mapper_t::check(state) != 0) {
+        return (1);
+    }
+
+    return (state.registers[13] > mirror_single_upper);
+}
+
+void
+mmc3_t::load(const mapper_state_t &state)
+{
+    mapper_t::load(state);
+
+    this->_select = state.registers[0];
+    memcpy(this->_banks, state.registers + 1, sizeof this->_banks);
+    this->_latch = state.registers[9];
+    this->_counter = state.registers[10];
+    this->_reload = state.registers[11];
+    this->_enabled = state.registers[12];
+    this->_mirroring = (mirroring_t)state.registers[13];
+
+    this->_update_prg();
+    this->_update_chr();
+    this->_mirror(this->_mirroring);
+}
+
+/**
+ * Four register pairs at $8000, $A000, $C000 and $E000, even and odd
+ * addresses select the register within the pair.
+ */
+void
+mmc3_t::write_io(uint16_t address, uint8_t value)
+{
+    switch (address & 0xe001) {
+        case 0x8000:
+            this->_select = value;
+            this->_update_prg();
+            this->_update_chr();
+            break;
+
+        case 0x8001:
+            this->_banks[this->_select & 0x07] = value;
+
+            if ((this->_select & 0x07) < 6) {
+                this->_update_chr();
+            } else {
+                this->_update_prg();
+            }
+            break;
+
+        case 0xa000:
+            if (this->cartridge.mirroring != mirror_four_screen) {
+                this->_mirroring = value & 0x01 ? mirror_horizontal : mirror_vertical;
+                this->_mirror(this->_mirroring);
+            }
+            break;
+
+        case 0xa001:
+            /* PRG-RAM protect, not emulated. */
+            break;
+
+        case 0xc000:
+            this->_latch = value;
+            break;
+
+        case 0xc001:
+            this->_counter = 0;
+            this->_reload = true;
+            break;
+
+        case 0xe000:
+            this->_enabled = false;
+            this->irq_line = false;
+            break;
+
+        case 0xe001:
+            this->_enabled = true;
+            break;
+    }
+}
+
+/**
+ * R6 and R7 are the switchable 8 KiB banks, bit 6 of the bank select
+ * swaps R6 with the fixed second to last bank.
+ */
+void
+mmc3_t::_update_prg(void)
+{
+    unsigned int last;
+    last = this->_last_prg(0x2000);
+
+    if (this->_select & 0x40) {
+        this->_map_prg(0x8000, 0x2000, last - 1);
+        this->_map_prg(0xc000, 0x2000, this->_banks[6]);
+    } else {
+        this->_map_prg(0x8000, 0x2000, this->_banks[6]);
+        this->_map_prg(0xc000, 0x2000, last - 1);
+    }
+
+    this->_map_prg(0xa000, 0x2000, this->_banks[7]);
+    this->_map_prg(0xe000, 0x2000, last);
+}
+
+/**
+ * R0 and R1 are 2 KiB banks, R2 to R5 1 KiB banks, bit 7 of the bank
+ * select swaps the two pattern tables.
+ */
+void
+mmc3_t::_update_chr(void)
+{
+    uint16_t invert;
+    invert = this->_select & 0x80 ? 0x1000 : 0;
+
+    this->_map_chr(0x0000 ^ invert, 0x800, this->_banks[0] >> 1);
+    this->_map_chr(0x0800 ^ invert, 0x800, this->_banks[1] >> 1);
+    this->_map_chr(0x1000 ^ invert, 0x400, this->_banks[2]);
+    this->_map_chr(0x1400 ^ invert, 0x400, this->_banks[3]);
+    this->_map_chr(0x1800 ^ invert, 0x400, this->_banks[4]);
+    this->_map_chr(0x1c00 ^ invert, 0x400, this->_banks[5]);
+}
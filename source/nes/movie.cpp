@@ -0,0 +1,258 @@
+/**
+ * Copyright (c) 2009 Roy van Dam <roy@8bit.cx>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "nes/movie.hpp"
+#include "nes/ppu.hpp"
+using namespace nes;
+
+movie_t::movie_t(void)
+{
+    this->start(0, 1, NES_MOVIE_CHECKPOINTS, 0);
+}
+
+/**
+ * Forget everything recorded and start over for a ROM.
+ */
+void
+movie_t::start(uint64_t rom_hash, unsigned int ports, unsigned int interval, uint32_t ppu_mode)
+{
+    this->_rom_hash = rom_hash;
+    this->_ports = ports;
+    this->_interval = interval > 0 ? interval : 1;
+    this->_ppu_mode = ppu_mode;
+
+    this->_inputs.clear();
+    this->_checkpoints.clear();
+    this->_state.clear();
+}
+
+int
+movie_t::save(const std::string &filename) const
+{
+    FILE *file;
+
+    if ((file = fopen(filename.c_str(), "wb")) == NULL) {
+        perror(filename.c_str());
+        return (1);
+    }
+
+    movie_header_t header;
+    memset(&header, 0, sizeof header);
+
+    header.magic = NES_MOVIE_MAGIC;
+    header.version = NES_MOVIE_VERSION;
+    header.rom_hash = this->_rom_hash;
+    header.frames = this->frames();
+    header.ports = this->_ports;
+    header.interval = this->_interval;
+    header.checkpoints = this->_checkpoints.size();
+    header.ppu_mode = this->_ppu_mode;
+    header.state_size = this->_state.size();
+
+    bool written;
+    written = fwrite(&header, sizeof header, 1, file) == 1 &&
+        fwrite(this->_inputs.data(), 1, this->_inputs.size(), file) == this->_inputs.size() &&
+        fwrite(this->_checkpoints.data(), sizeof(uint64_t), this->_checkpoints.size(), file) ==
+            this->_checkpoints.size() &&
+        fwrite(this->_state.data(), 1, this->_state.size(), file) == this->_state.size();
+
+    if (fclose(file) != 0 || !written) {
+        fprintf(stderr, "%s: Write failed\n", filename.c_str());
+        return (1);
+    }
+
+    return (0);
+}
+
+int
+movie_t::load(const std::string &filename)
+{
+    FILE *file;
+
+    if ((file = fopen(filename.c_str(), "rb")) == NULL) {
+        perror(filename.c_str());
+        return (1);
+    }
+
+    movie_header_t header;
+
+    if (fread(&header, sizeof header, 1, file) != 1 || header.magic != NES_MOVIE_MAGIC) {
+        fprintf(stderr, "%s: Not a movie\n", filename.c_str());
+        fclose(file);
+        return (1);
+    }
+
+    if (header.version != NES_MOVIE_VERSION) {
+        fprintf(stderr, "%s: Unsupported movie version %u\n", filename.c_str(), header.version);
+        fclose(file);
+        return (1);
+    }
+
+    /*
+     * A recording takes a checkpoint at every full interval, a movie
+     * with fewer would stop being checked part way through.
+     */
+    if (header.ports == 0 || header.ports > NES_CONTROLLER_PORTS || header.interval == 0 ||
+        header.checkpoints != header.frames / header.interval ||
+        header.ppu_mode > (uint32_t)ppu_dot) {
+        fprintf(stderr, "%s: Bad movie header\n", filename.c_str());
+        fclose(file);
+        return (1);
+    }
+
+    /*
+     * The blocks must fit in the file before anything is allocated for
+     * them, the header sizes are not trusted.
+     */
+    long length;
+
+    if (fseek(file, 0, SEEK_END) != 0 || (length = ftell(file)) < 0 ||
+        fseek(file, sizeof header, SEEK_SET) != 0) {
+        perror(filename.c_str());
+        fclose(file);
+        return (1);
+    }
+
+    uint64_t body;
+    body = (uint64_t)length - sizeof header;
+
+    if (header.state_size > body || (uint64_t)header.frames * header.ports +
+        (uint64_t)header.checkpoints * sizeof(uint64_t) > body - header.state_size) {
+        fprintf(stderr, "%s: Truncated movie\n", filename.c_str());
+        fclose(file);
+        return (1);
+    }
+
+    this->start(header.rom_hash, header.ports, header.interval, header.ppu_mode);
+
+    this->_inputs.resize((size_t)header.frames * header.ports);
+    this->_checkpoints.resize(header.checkpoints);
+    this->_state.resize(header.state_size);
+
+    bool read;
+    read = fread(this->_inputs.data(), 1, this->_inputs.size(), file) == this->_inputs.size() &&
+        fread(this->_checkpoints.data(), sizeof(uint64_t), this->_checkpoints.size(), file) ==
+            this->_checkpoints.size() &&
+        fread(this->_state.data(), 1, this->_state.size(), file) == this->_state.size();
+
+    fclose(file);
+
+    if (!read) {
+        fprintf(stderr, "%s: Truncated movie\n", filename.c_str());
+        this->start(0, 1, NES_MOVIE_CHECKPOINTS, 0);
+        return (1);
+    }
+
+    return (0);
+}
+
+uint64_t
+movie_t::rom_hash(void) const
+{
+    return (this->_rom_hash);
+}
+
+unsigned int
+movie_t::ports(void) const
+{
+    return (this->_ports);
+}
+
+unsigned int
+movie_t::interval(void) const
+{
+    return (this->_interval);
+}
+
+uint32_t
+movie_t::ppu_mode(void) const
+{
+    return (this->_ppu_mode);
+}
+
+unsigned long
+movie_t::frames(void) const
+{
+    return (this->_inputs.size() / this->_ports);
+}
+
+/**
+ * Bytes the movie takes on disk.
+ */
+size_t
+movie_t::size(void) const
+{
+    return (sizeof(movie_header_t) + this->_inputs.size() +
+        this->_checkpoints.size() * sizeof(uint64_t) + this->_state.size());
+}
+
+/**
+ * Button masks of every port on a frame.
+ */
+const uint8_t *
+movie_t::input(unsigned long frame) const
+{
+    return (&this->_inputs[frame * this->_ports]);
+}
+
+void
+movie_t::add_input(const uint8_t *buttons)
+{
+    this->_inputs.insert(this->_inputs.end(), buttons, buttons + this->_ports);
+}
+
+size_t
+movie_t::checkpoints(void) const
+{
+    return (this->_checkpoints.size());
+}
+
+uint64_t
+movie_t::checkpoint(size_t index) const
+{
+    return (this->_checkpoints[index]);
+}
+
+void
+movie_t::add_checkpoint(uint64_t hash)
+{
+    this->_checkpoints.push_back(hash);
+}
+
+const std::vector<uint8_t> &
+movie_t::state(void) const
+{
+    return (this->_state);
+}
+
+void
+movie_t::set_state(const uint8_t *state, size_t size)
+{
+    this->_state.assign(state, state + size);
+}
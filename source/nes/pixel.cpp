@@ -0,0 +1,290 @@
+/**
+ * Copyright (c) 2009 Roy van Dam <roy@8bit.cx>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define PIXEL_X86
+#endif
+
+#include "nes/pixel.hpp"
+using namespace nes;
+
+static void
+decode_scalar(const uint8_t *tile, uint64_t *rows)
+{
+    for (unsigned int y = 0; y < 8; y++) {
+        rows[y] = pixel_decode_row(tile[y], tile[y + 8]);
+    }
+}
+
+/**
+ * A sprite pixel carries its palette index in bits 0-4, the behind
+ * background bit (0x20) and the sprite zero bit (0x40). Transparent
+ * background pixels are zero.
+ */
+static int
+compose_scalar(const uint8_t *background, const uint8_t *sprites, uint8_t *output, unsigned int count)
+{
+    int hit = -1;
+
+    for (unsigned int i = 0; i < count; i++) {
+        uint8_t b, s;
+        b = background[i];
+        s = sprites[i];
+
+        if ((s & 0x03) && (b & 0x03) && (s & 0x40) && hit < 0) {
+            hit = i;
+        }
+
+        output[i] = (s & 0x03) && (!(b & 0x03) || !(s & 0x20)) ? s & 0x1f : b;
+    }
+
+    return (hit);
+}
+
+static void
+convert_scalar(const uint8_t *indices, const uint32_t *palette, uint32_t *output, unsigned int count)
+{
+    for (unsigned int i = 0; i < count; i++) {
+        output[i] = palette[indices[i]];
+    }
+}
+
+static const pixel_kernels_t scalar = {
+    "scalar", decode_scalar, compose_scalar, convert_scalar
+};
+
+#if defined(PIXEL_X86)
+
+/**
+ * SSE2: two pattern rows, 16 composed pixels or 4 converted pixels per
+ * step. There is no gather, so the colour lookup only batches the
+ * stores.
+ */
+__attribute__((target("sse2"))) static inline __m128i
+spread_sse2(__m128i rows, __m128i bits, __m128i value)
+{
+    return (_mm_and_si128(_mm_cmpeq_epi8(_mm_and_si128(rows, bits), bits), value));
+}
+
+__attribute__((target("sse2"))) static void
+decode_sse2(const uint8_t *tile, uint64_t *rows)
+{
+    const __m128i bits = _mm_set_epi8(1, 2, 4, 8, 16, 32, 64, (char)128, 1, 2, 4, 8, 16, 32, 64, (char)128);
+    const __m128i one = _mm_set1_epi8(1), two = _mm_set1_epi8(2);
+
+    __m128i low, high;
+    low = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)tile), _mm_loadl_epi64((const __m128i *)tile));
+    high = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(tile + 8)),
+        _mm_loadl_epi64((const __m128i *)(tile + 8)));
+
+    __m128i l[2], h[2];
+    l[0] = _mm_unpacklo_epi16(low, low);
+    l[1] = _mm_unpackhi_epi16(low, low);
+    h[0] = _mm_unpacklo_epi16(high, high);
+    h[1] = _mm_unpackhi_epi16(high, high);
+
+    for (unsigned int i = 0; i < 2; i++) {
+        __m128i pair;
+        pair = _mm_or_si128(spread_sse2(_mm_unpacklo_epi32(l[i], l[i]), bits, one),
+            spread_sse2(_mm_unpacklo_epi32(h[i], h[i]), bits, two));
+        _mm_storeu_si128((__m128i *)(rows + i * 4), pair);
+
+        pair = _mm_or_si128(spread_sse2(_mm_unpackhi_epi32(l[i], l[i]), bits, one),
+            spread_sse2(_mm_unpackhi_epi32(h[i], h[i]), bits, two));
+        _mm_storeu_si128((__m128i *)(rows + i * 4 + 2), pair);
+    }
+}
+
+__attribute__((target("sse2"))) static int
+compose_sse2(const uint8_t *background, const uint8_t *sprites, uint8_t *output, unsigned int count)
+{
+    const __m128i zero = _mm_setzero_si128(), colour = _mm_set1_epi8(0x03);
+    const __m128i index = _mm_set1_epi8(0x1f), behind = _mm_set1_epi8(0x20), zeroth = _mm_set1_epi8(0x40);
+    int hit = -1;
+
+    for (unsigned int i = 0; i < count; i += 16) {
+        __m128i b, s;
+        b = _mm_loadu_si128((const __m128i *)(background + i));
+        s = _mm_loadu_si128((const __m128i *)(sprites + i));
+
+        __m128i clear_s, clear_b, front, take;
+        clear_s = _mm_cmpeq_epi8(_mm_and_si128(s, colour), zero);
+        clear_b = _mm_cmpeq_epi8(_mm_and_si128(b, colour), zero);
+        front = _mm_cmpeq_epi8(_mm_and_si128(s, behind), zero);
+        take = _mm_andnot_si128(clear_s, _mm_or_si128(clear_b, front));
+
+        _mm_storeu_si128((__m128i *)(output + i),
+            _mm_or_si128(_mm_and_si128(take, _mm_and_si128(s, index)), _mm_andnot_si128(take, b)));
+
+        if (hit < 0) {
+            int mask;
+            mask = _mm_movemask_epi8(_mm_andnot_si128(_mm_or_si128(clear_s, clear_b),
+                _mm_cmpeq_epi8(_mm_and_si128(s, zeroth), zeroth)));
+
+            if (mask != 0) {
+                hit = i + __builtin_ctz(mask);
+            }
+        }
+    }
+
+    return (hit);
+}
+
+__attribute__((target("sse2"))) static void
+convert_sse2(const uint8_t *indices, const uint32_t *palette, uint32_t *output, unsigned int count)
+{
+    for (unsigned int i = 0; i < count; i += 4) {
+        _mm_storeu_si128((__m128i *)(output + i), _mm_set_epi32(palette[indices[i + 3]],
+            palette[indices[i + 2]], palette[indices[i + 1]], palette[indices[i]]));
+    }
+}
+
+static const pixel_kernels_t sse2 = {
+    "sse2", decode_sse2, compose_sse2, convert_sse2
+};
+
+/**
+ * AVX2: four pattern rows, 32 composed pixels or 8 gathered colours
+ * per step.
+ */
+__attribute__((target("avx2"))) static inline __m256i
+spread_avx2(__m256i rows, __m256i bits, __m256i value)
+{
+    return (_mm256_and_si256(_mm256_cmpeq_epi8(_mm256_and_si256(rows, bits), bits), value));
+}
+
+__attribute__((target("avx2"))) static void
+decode_avx2(const uint8_t *tile, uint64_t *rows)
+{
+    const __m256i bits = _mm256_set1_epi64x(0x0102040810204080LL);
+    const __m256i one = _mm256_set1_epi8(1), two = _mm256_set1_epi8(2);
+    const __m256i first = _mm256_setr_epi8(0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1,
+                                           2, 2, 2, 2, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 3, 3);
+    const __m256i second = _mm256_add_epi8(first, _mm256_set1_epi8(4));
+
+    int64_t planes[2];
+    memcpy(planes, tile, sizeof planes);
+
+    __m256i low, high;
+    low = _mm256_set1_epi64x(planes[0]);
+    high = _mm256_set1_epi64x(planes[1]);
+
+    _mm256_storeu_si256((__m256i *)rows, _mm256_or_si256(
+        spread_avx2(_mm256_shuffle_epi8(low, first), bits, one),
+        spread_avx2(_mm256_shuffle_epi8(high, first), bits, two)));
+    _mm256_storeu_si256((__m256i *)(rows + 4), _mm256_or_si256(
+        spread_avx2(_mm256_shuffle_epi8(low, second), bits, one),
+        spread_avx2(_mm256_shuffle_epi8(high, second), bits, two)));
+}
+
+__attribute__((target("avx2"))) static int
+compose_avx2(const uint8_t *background, const uint8_t *sprites, uint8_t *output, unsigned int count)
+{
+    const __m256i zero = _mm256_setzero_si256(), colour = _mm256_set1_epi8(0x03);
+    const __m256i index = _mm256_set1_epi8(0x1f), behind = _mm256_set1_epi8(0x20), zeroth = _mm256_set1_epi8(0x40);
+    int hit = -1;
+
+    for (unsigned int i = 0; i < count; i += 32) {
+        __m256i b, s;
+        b = _mm256_loadu_si256((const __m256i *)(background + i));
+        s = _mm256_loadu_si256((const __m256i *)(sprites + i));
+
+        __m256i clear_s, clear_b, front, take;
+        clear_s = _mm256_cmpeq_epi8(_mm256_and_si256(s, colour), zero);
+        clear_b = _mm256_cmpeq_epi8(_mm256_and_si256(b, colour), zero);
+        front = _mm256_cmpeq_epi8(_mm256_and_si256(s, behind), zero);
+        take = _mm256_andnot_si256(clear_s, _mm256_or_si256(clear_b, front));
+
+        _mm256_storeu_si256((__m256i *)(output + i),
+            _mm256_blendv_epi8(b, _mm256_and_si256(s, index), take));
+
+        if (hit < 0) {
+            unsigned int mask;
+            mask = _mm256_movemask_epi8(_mm256_andnot_si256(_mm256_or_si256(clear_s, clear_b),
+                _mm256_cmpeq_epi8(_mm256_and_si256(s, zeroth), zeroth)));
+
+            if (mask != 0) {
+                hit = i + __builtin_ctz(mask);
+            }
+        }
+    }
+
+    return (hit);
+}
+
+__attribute__((target("avx2"))) static void
+convert_avx2(const uint8_t *indices, const uint32_t *palette, uint32_t *output, unsigned int count)
+{
+    for (unsigned int i = 0; i < count; i += 8) {
+        __m256i index;
+        index = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(indices + i)));
+
+        _mm256_storeu_si256((__m256i *)(output + i),
+            _mm256_i32gather_epi32((const int *)palette, index, 4));
+    }
+}
+
+static const pixel_kernels_t avx2 = {
+    "avx2", decode_avx2, compose_avx2, convert_avx2
+};
+
+#endif // PIXEL_X86
+
+const pixel_kernels_t *
+nes::pixel_kernels(const char *name)
+{
+    const pixel_kernels_t *supported[3];
+    size_t count = 0;
+
+#if defined(PIXEL_X86)
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("avx2")) {
+        supported[count++] = &avx2;
+    }
+
+    if (__builtin_cpu_supports("sse2")) {
+        supported[count++] = &sse2;
+    }
+#endif
+
+    supported[count++] = &scalar;
+
+    if (name == NULL) {
+        return (supported[0]);
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        if (strcmp(supported[i]->name, name) == 0) {
+            return (supported[i]);
+        }
+    }
+
+    return (NULL);
+}
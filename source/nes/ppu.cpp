@@ -0,0 +1,1045 @@
+/**
+ * Copyright (c) 2009 Roy van Dam <roy@8bit.cx>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include <string.h>
+
+#include <algorithm>
+using namespace std;
+
+#include "trace.hpp"
+#include "nes/ppu.hpp"
+using namespace nes;
+
+/**
+ * 2C02 colours as 0xAARRGGBB
+ */
+static const uint32_t colours[64] = {
+    0xff666666, 0xff002a88, 0xff1412a7, 0xff3b00a4, 0xff5c007e, 0xff6e0040, 0xff6c0600, 0xff561d00,
+    0xff333500, 0xff0b4800, 0xff005200, 0xff004f08, 0xff00404d, 0xff000000, 0xff000000, 0xff000000,
+    0xffadadad, 0xff155fd9, 0xff4240ff, 0xff7527fe, 0xffa01acc, 0xffb71e7b, 0xffb53120, 0xff994e00,
+    0xff6b6d00, 0xff388700, 0xff0c9300, 0xff008f32, 0xff007c8d, 0xff000000, 0xff000000, 0xff000000,
+    0xfffffeff, 0xff64b0ff, 0xff9290ff, 0xffc676ff, 0xfff36aff, 0xfffe6ecc, 0xfffe8170, 0xffea9e22,
+    0xffbcbe00, 0xff88d800, 0xff5ce430, 0xff45e082, 0xff48cdde, 0xff4f4f4f, 0xff000000, 0xff000000,
+    0xfffffeff, 0xffc0dfff, 0xffd3d2ff, 0xffe8c8ff, 0xfffbc2ff, 0xfffec4ea, 0xfffeccc5, 0xfff7d8a5,
+    0xffe4e594, 0xffcfef96, 0xffbdf4ab, 0xffb3f3cc, 0xffb5ebf2, 0xffb8b8b8, 0xff000000, 0xff000000,
+};
+
+#define NO_HIT  (~(uint64_t)0)
+
+tile_cache_t::tile_cache_t(void)
+{
+    this->_kernels = pixel_kernels();
+    this->_base = NULL;
+    this->_size = 0;
+    this->_rows = NULL;
+}
+
+tile_cache_t::~tile_cache_t(void)
+{
+    delete[] this->_rows;
+}
+
+void
+tile_cache_t::attach(const uint8_t *base, size_t size)
+{
+    this->_base = base;
+    this->_size = size & ~(size_t)0x0f;
+
+    delete[] this->_rows;
+    this->_rows = NULL;
+    this->_valid.assign(this->_size / 16, 0);
+}
+
+void
+tile_cache_t::invalidate(const uint8_t *address)
+{
+    size_t offset;
+    offset = (uintptr_t)address - (uintptr_t)this->_base;
+
+    if (offset < this->_size) {
+        this->_valid[offset >> 4] = 0;
+    }
+}
+
+void
+tile_cache_t::invalidate(void)
+{
+    fill(this->_valid.begin(), this->_valid.end(), 0);
+}
+
+void
+tile_cache_t::_decode(size_t index)
+{
+    if (this->_rows == NULL) {
+        this->_rows = new uint64_t[this->_size / 2];
+    }
+
+    this->_kernels->decode(this->_base + index * 16, &this->_rows[index * 8]);
+    this->_valid[index] = 1;
+}
+
+ppu_t::ppu_t(memory_map_t &video, scheduler_t &scheduler)
+    : _video(video), _scheduler(scheduler)
+{
+    this->_mapper = NULL;
+    this->_kernels = pixel_kernels();
+    this->_mode = ppu_scanline;
+    this->_selected = ppu_scanline;
+    this->_event = this->_scheduler.add(this);
+
+    this->_drawing = true;
+    this->attach_framebuffer(NULL, 0);
+}
+
+/**
+ * A copy for another machine, on its address space, scheduler, mapper
+ * and CHR. Registers and timeline carry over; the internal framebuffer
+ * is not, it is allocated blank once the copy draws its first line from
+ * the one the beam is on, and tiles are decoded again as they are drawn.
+ */
+ppu_t::ppu_t(const ppu_t &other, memory_map_t &video, scheduler_t &scheduler,
+    mapper_t *mapper, const uint8_t *chr, size_t chr_size)
+    : _video(video), _scheduler(scheduler)
+{
+    this->_mapper = mapper;
+    this->_tiles.attach(chr, chr_size);
+    this->_kernels = other._kernels;
+    this->_mode = other._mode;
+    this->_selected = other._selected;
+    this->_event = other._event;
+    this->_scheduler.rebind(this->_event, this);
+
+    this->_control = other._control;
+    this->_mask = other._mask;
+    this->_status = other._status;
+    this->_oam_address = other._oam_address;
+    this->_buffer = other._buffer;
+    this->_v = other._v;
+    this->_t = other._t;
+    this->_x = other._x;
+    this->_w = other._w;
+    memcpy(this->_oam, other._oam, sizeof this->_oam);
+    memcpy(this->_palette, other._palette, sizeof this->_palette);
+    memcpy(this->_colours, other._colours, sizeof this->_colours);
+
+    this->_event_frame = other._event_frame;
+    this->_event_dot = other._event_dot;
+    this->_render_frame = other._render_frame;
+    this->_line = other._line;
+    this->_dot = other._dot;
+    this->_sprite0_hit = other._sprite0_hit;
+    this->_frame = other._frame;
+    this->_nmi = other._nmi;
+
+    this->_tile = other._tile;
+    this->_next_tile = other._next_tile;
+    memcpy(this->_sprites, other._sprites, sizeof this->_sprites);
+
+    this->_drawing = other._drawing;
+    this->attach_framebuffer(NULL, 0);
+}
+
+void
+ppu_t::reset(mapper_t *mapper, const uint8_t *chr, size_t chr_size)
+{
+    this->_mapper = mapper;
+    this->_mode = this->_selected;
+    this->_tiles.attach(chr, chr_size);
+
+    this->_control = 0;
+    this->_mask = 0;
+    this->_status = 0;
+    this->_oam_address = 0;
+    this->_buffer = 0;
+    this->_v = 0;
+    this->_t = 0;
+    this->_x = 0;
+    this->_w = false;
+
+    memset(this->_oam, 0xff, sizeof this->_oam);
+    memset(this->_palette, 0, sizeof this->_palette);
+    this->_resolve_colours();
+
+    this->_render_frame = 0;
+    this->_line = 0;
+    this->_dot = 0;
+    this->_tile = 0;
+    this->_next_tile = 0;
+    memset(this->_sprites, 0, sizeof this->_sprites);
+    this->_sprite0_hit = NO_HIT;
+    this->_frame = 0;
+    this->_nmi = false;
+
+    this->_event_frame = 0;
+    this->_event_dot = this->_next_dot(0);
+    this->_scheduler.schedule(this->_event, this->_event_dot / 3);
+}
+
+uint8_t
+ppu_t::read(uint16_t address, uint64_t now)
+{
+    uint8_t value;
+
+    switch (address & 0x07) {
+        case 2:
+            /*
+             * Draw the current line ahead of time so a sprite zero hit
+             * on it shows up at the right dot.
+             */
+            this->_sync(now * 3, true);
+
+            value = (this->_status & 0xa0) | (this->_buffer & 0x1f);
+            value |= now * 3 >= this->_sprite0_hit ? 0x40 : 0;
+
+            this->_status &= ~0x80;
+            this->_w = false;
+            return (value);
+
+        case 4:
+            return (this->_oam[this->_oam_address]);
+
+        case 7:
+            this->_sync(now * 3, false);
+            address = this->_v & 0x3fff;
+
+            if (address >= NES_PALETTE_OFFSET) {
+                value = this->_read_vram(address);
+                this->_buffer = this->_read_vram(address - 0x1000);
+            } else {
+                value = this->_buffer;
+                this->_buffer = this->_read_vram(address);
+            }
+
+            this->_v += this->_control & 0x04 ? 32 : 1;
+            return (value);
+
+        default:
+            return (this->_buffer);
+    }
+}
+
+void
+ppu_t::write(uint16_t address, uint8_t value, uint64_t now)
+{
+    this->_sync(now * 3, false);
+
+    switch (address & 0x07) {
+        case 0:
+            if (!(this->_control & 0x80) && (value & 0x80) && (this->_status & 0x80)) {
+                this->_nmi = true;
+            }
+
+            this->_control = value;
+            this->_t = (this->_t & ~0x0c00) | (value & 0x03) << 10;
+            break;
+
+        case 1:
+            this->_mask = value;
+            this->_resolve_colours();
+            break;
+
+        case 3:
+            this->_oam_address = value;
+            break;
+
+        case 4:
+            this->_oam[this->_oam_address++] = value;
+            break;
+
+        case 5:
+            if (!this->_w) {
+                this->_t = (this->_t & ~0x001f) | value >> 3;
+                this->_x = value & 0x07;
+            } else {
+                this->_t = (this->_t & ~0x73e0) | (value & 0x07) << 12 | (value & 0xf8) << 2;
+            }
+
+            this->_w = !this->_w;
+            break;
+
+        case 6:
+            if (!this->_w) {
+                this->_t = (this->_t & 0x00ff) | (value & 0x3f) << 8;
+            } else {
+                this->_t = (this->_t & 0xff00) | value;
+                this->_v = this->_t;
+            }
+
+            this->_w = !this->_w;
+            break;
+
+        case 7:
+            this->_write_vram(this->_v & 0x3fff, value);
+            this->_v += this->_control & 0x04 ? 32 : 1;
+            break;
+
+        default:
+            break;
+    }
+}
+
+/**
+ * OAM DMA: a whole page written through OAMDATA, starting at and
+ * wrapping around to the current OAM address.
+ */
+void
+ppu_t::dma(const uint8_t *page, uint64_t now)
+{
+    this->_sync(now * 3, false);
+
+    size_t head;
+    head = NES_OAM_SIZE - this->_oam_address;
+
+    memcpy(this->_oam + this->_oam_address, page, head);
+    memcpy(this->_oam, page + head, this->_oam_address);
+}
+
+/**
+ * Bring the picture up to date with the CPU, called before anything
+ * outside the PPU changes what it would draw.
+ */
+void
+ppu_t::sync(uint64_t now)
+{
+    this->_sync(now * 3, false);
+}
+
+void
+ppu_t::save(ppu_state_t &state) const
+{
+    state.control = this->_control;
+    state.mask = this->_mask;
+    state.status = this->_status;
+    state.oam_address = this->_oam_address;
+    state.buffer = this->_buffer;
+    state.x = this->_x;
+    state.w = this->_w;
+    state.nmi = this->_nmi;
+    state.v = this->_v;
+    state.t = this->_t;
+    state.mode = this->_mode;
+    memcpy(state.oam, this->_oam, sizeof state.oam);
+    memcpy(state.palette, this->_palette, sizeof state.palette);
+
+    state.event_frame = this->_event_frame;
+    state.event_dot = this->_event_dot;
+    state.render_frame = this->_render_frame;
+    state.frame = this->_frame;
+    state.sprite0_hit = this->_sprite0_hit;
+    state.line = this->_line;
+    state.dot = this->_dot;
+    state.tile = this->_tile;
+    state.next_tile = this->_next_tile;
+    memcpy(state.sprites, this->_sprites, sizeof state.sprites);
+}
+
+/**
+ * A state the PPU could have saved at CPU cycle now: the back end, the
+ * scroll registers and the beam within their ranges, pipeline pixels
+ * that are 4 bit palette indices, and a timeline around now with the
+ * renderer no more than a couple of frames behind the next event, so
+ * catching up neither reads out of bounds nor takes forever.
+ */
+int
+ppu_t::check(const ppu_state_t &state, uint64_t now) const
+{
+    if (state.mode > ppu_dot || state.x > 7 || state.v > 0x7fff || state.t > 0x7fff ||
+        state.line > NES_PRERENDER_LINE || state.dot >= NES_DOTS_PER_LINE ||
+        state.event_dot >= NES_DOTS_PER_FRAME || ((state.tile | state.next_tile) & 0xf0f0f0f0f0f0f0f0ULL) != 0) {
+        return (1);
+    }
+
+    if (now > ~(uint64_t)0 / 3) {
+        return (1);
+    }
+
+    uint64_t frame;
+    frame = now * 3 / NES_DOTS_PER_FRAME;
+
+    return (state.event_frame > frame + 1 || state.event_frame + 1 < frame ||
+        state.render_frame > state.event_frame || state.render_frame + 2 < state.event_frame);
+}
+
+/**
+ * Restore a checked state, including the back end it was saved with.
+ * The tile cache is dropped since CHR-RAM may have been restored under
+ * it, and the timeline rescheduled. Lines already drawn into the
+ * framebuffer are kept until the beam comes by again.
+ */
+void
+ppu_t::load(const ppu_state_t &state)
+{
+    this->_control = state.control;
+    this->_mask = state.mask;
+    this->_status = state.status;
+    this->_oam_address = state.oam_address;
+    this->_buffer = state.buffer;
+    this->_x = state.x;
+    this->_w = state.w;
+    this->_nmi = state.nmi;
+    this->_v = state.v;
+    this->_t = state.t;
+    this->_mode = (ppu_mode_t)state.mode;
+    memcpy(this->_oam, state.oam, sizeof this->_oam);
+    memcpy(this->_palette, state.palette, sizeof this->_palette);
+
+    this->_event_frame = state.event_frame;
+    this->_event_dot = state.event_dot;
+    this->_render_frame = state.render_frame;
+    this->_frame = state.frame;
+    this->_sprite0_hit = state.sprite0_hit;
+    this->_line = state.line;
+    this->_dot = state.dot;
+    this->_tile = state.tile;
+    this->_next_tile = state.next_tile;
+    memcpy(this->_sprites, state.sprites, sizeof this->_sprites);
+
+    this->_resolve_colours();
+    this->_tiles.invalidate();
+
+    this->_scheduler.schedule(this->_event,
+        (this->_event_frame * NES_DOTS_PER_FRAME + this->_event_dot) / 3);
+}
+
+/**
+ * Edge triggered NMI output, cleared once taken.
+ */
+bool
+ppu_t::nmi(void)
+{
+    bool pending;
+    pending = this->_nmi;
+
+    this->_nmi = false;
+    return (pending);
+}
+
+/**
+ * Pick the back end, it takes effect at the next reset.
+ */
+void
+ppu_t::set_mode(ppu_mode_t mode)
+{
+    this->_selected = mode;
+}
+
+ppu_mode_t
+ppu_t::mode(void) const
+{
+    return (this->_selected);
+}
+
+unsigned long
+ppu_t::frame(void) const
+{
+    return (this->_frame);
+}
+
+/**
+ * The framebuffer pixels are drawn into, NULL while the internal one
+ * has not been drawn into yet or when no pixels are drawn.
+ */
+const uint32_t *
+ppu_t::framebuffer(void) const
+{
+    return (this->_drawing ? this->_output : NULL);
+}
+
+/**
+ * Render into pixels, a buffer of NES_SCREEN_HEIGHT rows that are pitch
+ * pixels apart, or back into the internal framebuffer when pixels is
+ * NULL. The buffer must stay valid while frames are being rendered.
+ */
+void
+ppu_t::attach_framebuffer(uint32_t *pixels, size_t pitch)
+{
+    if (pixels == NULL) {
+        this->_output = this->_framebuffer.empty() ? NULL : &this->_framebuffer[0];
+        this->_pitch = NES_SCREEN_WIDTH;
+        return;
+    }
+
+    this->_output = pixels;
+    this->_pitch = max(pitch, (size_t)NES_SCREEN_WIDTH);
+}
+
+/**
+ * Draw pixels or not, the internal framebuffer is released when not.
+ */
+void
+ppu_t::enable_framebuffer(bool enable)
+{
+    this->_drawing = enable;
+
+    if (enable || this->_framebuffer.empty() || this->_output != &this->_framebuffer[0]) {
+        return;
+    }
+
+    vector<uint32_t>().swap(this->_framebuffer);
+    this->_output = NULL;
+}
+
+/**
+ * PPU timeline. Vertical blank raises the status flag and the NMI at
+ * the start of scanline 241 and the pre-render scanline drops it
+ * again. Mappers counting scanlines are clocked at dot 260 of every
+ * rendered scanline while rendering is enabled, where the sprite
+ * pattern fetches raise PPU A12.
+ */
+void
+ppu_t::event(uint64_t deadline)
+{
+    this->_sync(this->_event_frame * NES_DOTS_PER_FRAME + this->_event_dot, false);
+
+    switch (this->_event_dot) {
+        case NES_VBLANK_DOT:
+            this->_status |= 0x80;
+
+            if (this->_control & 0x80) {
+                this->_nmi = true;
+            }
+            break;
+
+        case NES_PRERENDER_DOT:
+            this->_status &= ~0xa0;
+            this->_sprite0_hit = NO_HIT;
+            this->_frame++;
+            break;
+
+        default:
+            if (this->_rendering()) {
+                this->_mapper->scanline();
+            }
+            break;
+    }
+
+    this->_event_dot = this->_next_dot(this->_event_dot);
+
+    if (this->_event_dot == NES_DOTS_PER_FRAME) {
+        this->_event_frame++;
+        this->_event_dot = this->_next_dot(0);
+    }
+
+    this->_scheduler.schedule(this->_event,
+        (this->_event_frame * NES_DOTS_PER_FRAME + this->_event_dot) / 3);
+}
+
+/**
+ * Catch up with the given dot: every visible line is drawn once the
+ * beam reaches its horizontal blank, or as soon as it starts with
+ * early set, and the pre-render line reloads the scroll position.
+ */
+void
+ppu_t::_sync(uint64_t dots, bool early)
+{
+    if (this->_mode == ppu_dot) {
+        this->_step(dots);
+        return;
+    }
+
+    for (;;) {
+        uint64_t origin;
+        origin = this->_render_frame * NES_DOTS_PER_FRAME;
+
+        if (dots < origin) {
+            return;
+        }
+
+        uint64_t position;
+        position = dots - origin;
+
+        if (this->_line < NES_VISIBLE_LINES) {
+            if (position < this->_line * NES_DOTS_PER_LINE + (early ? 0 : NES_SCREEN_WIDTH)) {
+                return;
+            }
+
+            this->_render_line(this->_line++);
+            continue;
+        }
+
+        if (this->_line == NES_VISIBLE_LINES) {
+            if (position < NES_PRERENDER_LINE * NES_DOTS_PER_LINE + 304) {
+                return;
+            }
+
+            if (this->_rendering()) {
+                this->_v = this->_t;
+            }
+
+            this->_line++;
+            continue;
+        }
+
+        if (position < NES_DOTS_PER_FRAME) {
+            return;
+        }
+
+        this->_render_frame++;
+        this->_line = 0;
+    }
+}
+
+/**
+ * Dot back end: run every dot before the given one. The lines between
+ * the picture and the pre-render line do nothing and are skipped over
+ * whole.
+ */
+void
+ppu_t::_step(uint64_t dots)
+{
+    uint64_t origin;
+    origin = this->_render_frame * NES_DOTS_PER_FRAME + this->_line * NES_DOTS_PER_LINE;
+
+    while (origin + this->_dot < dots) {
+        if (this->_line >= NES_VISIBLE_LINES && this->_line != NES_PRERENDER_LINE) {
+            this->_dot = min(dots - origin, (uint64_t)NES_DOTS_PER_LINE);
+        } else {
+            this->_step_dot();
+        }
+
+        if (this->_dot == NES_DOTS_PER_LINE) {
+            this->_dot = 0;
+            origin += NES_DOTS_PER_LINE;
+
+            if (++this->_line == NES_PRERENDER_LINE + 1) {
+                this->_line = 0;
+                this->_render_frame++;
+            }
+        }
+    }
+}
+
+/**
+ * One dot of a visible or the pre-render line. Tiles are fetched in
+ * one go on the last dot of their eight dot slot, which is also when
+ * they move into the pipeline, so the tile being drawn always has the
+ * next one behind it for fine X scroll.
+ */
+void
+ppu_t::_step_dot(void)
+{
+    unsigned int dot;
+    dot = this->_dot++;
+
+    if (dot >= 1 && dot <= NES_SCREEN_WIDTH && this->_line < NES_VISIBLE_LINES) {
+        this->_draw_dot(dot - 1);
+    }
+
+    if (!this->_rendering()) {
+        return;
+    }
+
+    if ((dot & 0x07) == 0 && ((dot >= 8 && dot <= 256) || dot == 328 || dot == 336)) {
+        this->_tile = this->_next_tile;
+        this->_next_tile = this->_fetch_tile(this->_v);
+        this->_increment_x();
+    }
+
+    if (dot == 256) {
+        this->_increment_y();
+    } else if (dot == 257) {
+        this->_v = (this->_v & ~0x041f) | (this->_t & 0x041f);
+
+        unsigned int next;
+        next = this->_line == NES_PRERENDER_LINE ? 0 : this->_line + 1;
+
+        memset(this->_sprites, 0, sizeof this->_sprites);
+
+        if (next < NES_VISIBLE_LINES && (this->_mask & 0x10)) {
+            this->_render_sprites(next, this->_sprites);
+        }
+    } else if (dot >= 280 && dot <= 304 && this->_line == NES_PRERENDER_LINE) {
+        this->_v = (this->_v & ~0x7be0) | (this->_t & 0x7be0);
+    }
+}
+
+/**
+ * Output one pixel with the mask, the palette and fine X scroll as they
+ * are at this dot.
+ */
+void
+ppu_t::_draw_dot(unsigned int x)
+{
+    uint32_t *output;
+    output = this->_output_line(this->_line);
+
+    if (!this->_rendering()) {
+        if (output != NULL) {
+            output[x] = this->_colours[0];
+        }
+        return;
+    }
+
+    uint8_t colour, sprite;
+    colour = 0;
+    sprite = 0;
+
+    if ((this->_mask & 0x08) && (x >= 8 || (this->_mask & 0x02))) {
+        unsigned int i;
+        i = (x & 0x07) + this->_x;
+        colour = (i < 8 ? this->_tile >> (i * 8) : this->_next_tile >> ((i - 8) * 8)) & 0xff;
+    }
+
+    if ((this->_mask & 0x10) && (x >= 8 || (this->_mask & 0x04))) {
+        sprite = this->_sprites[x];
+    }
+
+    if (sprite & 0x03) {
+        if (colour & 0x03) {
+            if ((sprite & 0x40) && x != 255 && this->_sprite0_hit == NO_HIT) {
+                this->_sprite0_hit = this->_render_frame * NES_DOTS_PER_FRAME +
+                    this->_line * NES_DOTS_PER_LINE + x + 2;
+            }
+
+            if (!(sprite & 0x20)) {
+                colour = sprite & 0x1f;
+            }
+        } else {
+            colour = sprite & 0x1f;
+        }
+    }
+
+    if (output != NULL) {
+        output[x] = this->_colours[colour];
+    }
+}
+
+/**
+ * First dot of interest after the given one, or the end of the frame.
+ */
+unsigned long
+ppu_t::_next_dot(unsigned long dot) const
+{
+    unsigned long next;
+    next = dot < NES_VBLANK_DOT ? NES_VBLANK_DOT :
+        dot < NES_PRERENDER_DOT ? NES_PRERENDER_DOT : NES_DOTS_PER_FRAME;
+
+    if (this->_mapper->counts_scanlines()) {
+        unsigned long line;
+        line = (dot + NES_DOTS_PER_LINE - NES_SCANLINE_DOT) / NES_DOTS_PER_LINE;
+
+        if (line >= NES_VISIBLE_LINES && line < NES_PRERENDER_LINE) {
+            line = NES_PRERENDER_LINE;
+        }
+
+        if (line <= NES_PRERENDER_LINE) {
+            next = min(next, line * NES_DOTS_PER_LINE + NES_SCANLINE_DOT);
+        }
+    }
+
+    return (next);
+}
+
+/**
+ * Draw one scanline: background and sprites into palette indices, the
+ * priority mux and sprite zero detection, then the colour lookup.
+ * Afterwards the scroll position moves on like it does at dots 256
+ * and 257.
+ */
+void
+ppu_t::_render_line(unsigned int line)
+{
+    uint32_t *output;
+    output = this->_output_line(line);
+
+    if (!this->_rendering()) {
+        if (output == NULL) {
+            return;
+        }
+
+        uint32_t colour;
+        colour = this->_colours[0];
+
+        for (unsigned int x = 0; x < NES_SCREEN_WIDTH; x++) {
+            output[x] = colour;
+        }
+        return;
+    }
+
+    uint8_t background[NES_SCREEN_WIDTH + 16];
+    uint8_t sprites[NES_SCREEN_WIDTH];
+
+    memset(sprites, 0, sizeof sprites);
+
+    if (this->_mask & 0x08) {
+        this->_render_background(background);
+    } else {
+        memset(background, 0, sizeof background);
+    }
+
+    if (this->_mask & 0x10) {
+        this->_render_sprites(line, sprites);
+    }
+
+    if (!(this->_mask & 0x02)) {
+        memset(background + this->_x, 0, 8);
+    }
+
+    if (!(this->_mask & 0x04)) {
+        memset(sprites, 0, 8);
+    }
+
+    uint64_t origin;
+    origin = this->_render_frame * NES_DOTS_PER_FRAME + line * NES_DOTS_PER_LINE;
+
+    uint8_t indices[NES_SCREEN_WIDTH];
+    int hit;
+    hit = this->_kernels->compose(background + this->_x, sprites, indices, NES_SCREEN_WIDTH);
+
+    if (hit >= 0 && hit != 255 && this->_sprite0_hit == NO_HIT) {
+        this->_sprite0_hit = origin + hit + 2;
+    }
+
+    if (output != NULL) {
+        this->_kernels->convert(indices, this->_colours, output, NES_SCREEN_WIDTH);
+    }
+
+    this->_increment_y();
+    this->_v = (this->_v & ~0x041f) | (this->_t & 0x041f);
+}
+
+/**
+ * Fetch the 33 tiles the line touches, fine X scroll selects where the
+ * line starts within the first of them. The decoded rows are stored
+ * with memcpy, which puts the leftmost pixel first on little endian
+ * hosts.
+ */
+void
+ppu_t::_render_background(uint8_t *pixels)
+{
+    uint16_t v;
+    v = this->_v;
+
+    for (unsigned int i = 0; i < 33; i++) {
+        uint64_t row;
+        row = this->_fetch_tile(v);
+        memcpy(pixels + i * 8, &row, sizeof row);
+
+        if ((v & 0x001f) == 0x001f) {
+            v = (v & ~0x001f) ^ 0x0400;
+        } else {
+            v++;
+        }
+    }
+}
+
+/**
+ * Nametable, attribute and pattern fetch for the tile at v: the row of
+ * pixels with the attribute palette merged into the opaque ones.
+ */
+uint64_t
+ppu_t::_fetch_tile(uint16_t v)
+{
+    uint8_t tile, attribute;
+    tile = this->_video.read_byte(0x2000 | (v & 0x0fff));
+    attribute = this->_video.read_byte(0x23c0 | (v & 0x0c00) | ((v >> 4) & 0x38) | ((v >> 2) & 0x07));
+
+    uint64_t row, opaque, palette;
+    row = this->_pattern((this->_control & 0x10) << 8 | tile << 4 | v >> 12);
+    opaque = (row | row >> 1) & 0x0101010101010101ULL;
+    palette = (attribute >> (((v >> 4) & 0x04) | (v & 0x02))) & 0x03;
+
+    return (row | opaque * (palette << 2));
+}
+
+/**
+ * Evaluate and draw the sprites on a line, lower OAM entries win. The
+ * sprite pixels carry their palette index, the priority bit (0x20)
+ * and whether they belong to sprite zero (0x40).
+ */
+void
+ppu_t::_render_sprites(unsigned int line, uint8_t *pixels)
+{
+    unsigned int height, count;
+    height = this->_control & 0x20 ? 16 : 8;
+    count = 0;
+
+    for (unsigned int i = 0; i < 64; i++) {
+        const uint8_t *sprite;
+        sprite = this->_oam + i * 4;
+
+        unsigned int row;
+        row = line - 1 - sprite[0];
+
+        if (row >= height) {
+            continue;
+        }
+
+        if (++count > 8) {
+            this->_status |= 0x20;
+            break;
+        }
+
+        uint8_t attributes;
+        attributes = sprite[2];
+
+        if (attributes & 0x80) {
+            row = height - 1 - row;
+        }
+
+        uint16_t address;
+        if (height == 16) {
+            address = (sprite[1] & 0x01) << 12 | (sprite[1] & 0xfe) << 4 | (row & 0x08) << 1 | (row & 0x07);
+        } else {
+            address = (this->_control & 0x08) << 9 | sprite[1] << 4 | row;
+        }
+
+        uint64_t bits;
+        bits = this->_pattern(address);
+
+        if (attributes & 0x40) {
+            bits = __builtin_bswap64(bits);
+        }
+
+        uint8_t flags;
+        flags = 0x10 | (attributes & 0x03) << 2 | (attributes & 0x20) | (i == 0 ? 0x40 : 0);
+
+        for (unsigned int x = sprite[3], j = 0; j < 8 && x < NES_SCREEN_WIDTH; x++, j++) {
+            uint8_t colour;
+            colour = (bits >> (j * 8)) & 0x03;
+
+            if (colour != 0 && pixels[x] == 0) {
+                pixels[x] = flags | colour;
+            }
+        }
+    }
+}
+
+/**
+ * Decoded pattern row at a PPU address, through the tile cache.
+ */
+uint64_t
+ppu_t::_pattern(uint16_t address)
+{
+    const uint8_t *page;
+    page = this->_video.code_page(address);
+
+    if (page == NULL) {
+        return (0);
+    }
+
+    return (this->_tiles.row(page + (address & NES_PAGE_MASK & ~0x0f), address & 0x07));
+}
+
+/**
+ * Palette RAM through the greyscale bit into colours, done on every
+ * palette or mask write so the renderer looks colours up directly.
+ */
+void
+ppu_t::_resolve_colours(void)
+{
+    uint8_t grey;
+    grey = this->_mask & 0x01 ? 0x30 : 0x3f;
+
+    for (unsigned int i = 0; i < NES_PALETTE_SIZE; i++) {
+        this->_colours[i] = colours[this->_palette[i] & grey];
+    }
+}
+
+uint8_t
+ppu_t::_read_vram(uint16_t address)
+{
+    if (address >= NES_PALETTE_OFFSET) {
+        address &= NES_PALETTE_SIZE - 1;
+
+        if ((address & 0x13) == 0x10) {
+            address &= ~0x10;
+        }
+
+        return (this->_palette[address]);
+    }
+
+    return (this->_video.read_byte(address));
+}
+
+void
+ppu_t::_write_vram(uint16_t address, uint8_t value)
+{
+    if (address >= NES_PALETTE_OFFSET) {
+        address &= NES_PALETTE_SIZE - 1;
+
+        if ((address & 0x13) == 0x10) {
+            address &= ~0x10;
+        }
+
+        this->_palette[address] = value & 0x3f;
+        this->_resolve_colours();
+        return;
+    }
+
+    if (address < NES_PATTERN_SIZE) {
+        const uint8_t *page;
+        page = this->_video.code_page(address);
+
+        if (page != NULL) {
+            this->_tiles.invalidate(page + (address & NES_PAGE_MASK));
+        }
+    }
+
+    this->_video.write_byte(address, value);
+}
+
+/**
+ * Coarse X with the wrap into the other nametable.
+ */
+void
+ppu_t::_increment_x(void)
+{
+    if ((this->_v & 0x001f) == 0x001f) {
+        this->_v = (this->_v & ~0x001f) ^ 0x0400;
+    } else {
+        this->_v++;
+    }
+}
+
+/**
+ * Fine Y, then coarse Y with the wrap at row 29 into the other
+ * nametable.
+ */
+void
+ppu_t::_increment_y(void)
+{
+    if ((this->_v & 0x7000) != 0x7000) {
+        this->_v += 0x1000;
+        return;
+    }
+
+    this->_v &= ~0x7000;
+
+    unsigned int y;
+    y = (this->_v & 0x03e0) >> 5;
+
+    if (y == 29) {
+        y = 0;
+        this->_v ^= 0x0800;
+    } else if (y == 31) {
+        y = 0;
+    } else {
+        y++;
+    }
+
+    this->_v = (this->_v & ~0x03e0) | y << 5;
+}
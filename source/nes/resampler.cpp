@@ -0,0 +1,454 @@
+/**
+ * Copyright (c) 2009 Roy van Dam <roy@8bit.cx>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include <math.h>
+#include <string.h>
+
+#include <algorithm>
+using namespace std;
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define AUDIO_X86
+#endif
+
+#include "nes/resampler.hpp"
+using namespace nes;
+
+/**
+ * The NES mixer in a form without singularities: both halves are zero
+ * for silent input rather than a division by zero, and stay smooth
+ * through the small negative swings of band-limited steps.
+ */
+#define PULSE_GAIN      95.88f
+#define PULSE_BIAS      8128.0f
+#define TND_GAIN        159.79f
+#define TRIANGLE_SCALE  (1.0f / 8227.0f)
+#define NOISE_SCALE     (1.0f / 12241.0f)
+#define DMC_SCALE       (1.0f / 22638.0f)
+
+static void
+mix_scalar(const float *const *channels, float *output, size_t count)
+{
+    for (size_t i = 0; i < count; i++) {
+        float pulse, tnd;
+        pulse = channels[NES_APU_PULSE1][i] + channels[NES_APU_PULSE2][i];
+        tnd = channels[NES_APU_TRIANGLE][i] * TRIANGLE_SCALE + channels[NES_APU_NOISE][i] * NOISE_SCALE +
+            channels[NES_APU_DMC][i] * DMC_SCALE;
+
+        output[i] = PULSE_GAIN * pulse / (PULSE_BIAS + 100.0f * pulse) +
+            TND_GAIN * tnd / (1.0f + 100.0f * tnd);
+    }
+}
+
+static float
+dot_scalar(const float *samples, const float *taps)
+{
+    float sum = 0;
+
+    for (unsigned int i = 0; i < RESAMPLER_TAPS; i++) {
+        sum += samples[i] * taps[i];
+    }
+
+    return (sum);
+}
+
+static const audio_kernels_t scalar = {
+    "scalar", mix_scalar, dot_scalar
+};
+
+#if defined(AUDIO_X86)
+
+/**
+ * SSE2: four samples per step.
+ */
+__attribute__((target("sse2"))) static void
+mix_sse2(const float *const *channels, float *output, size_t count)
+{
+    const __m128 pulse_gain = _mm_set1_ps(PULSE_GAIN), pulse_bias = _mm_set1_ps(PULSE_BIAS);
+    const __m128 tnd_gain = _mm_set1_ps(TND_GAIN), hundred = _mm_set1_ps(100.0f), one = _mm_set1_ps(1.0f);
+    const __m128 triangle = _mm_set1_ps(TRIANGLE_SCALE), noise = _mm_set1_ps(NOISE_SCALE);
+    const __m128 dmc = _mm_set1_ps(DMC_SCALE);
+
+    size_t i;
+    for (i = 0; i + 4 <= count; i += 4) {
+        __m128 pulse, tnd;
+        pulse = _mm_add_ps(_mm_loadu_ps(channels[NES_APU_PULSE1] + i), _mm_loadu_ps(channels[NES_APU_PULSE2] + i));
+        tnd = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_loadu_ps(channels[NES_APU_TRIANGLE] + i), triangle),
+            _mm_mul_ps(_mm_loadu_ps(channels[NES_APU_NOISE] + i), noise)),
+            _mm_mul_ps(_mm_loadu_ps(channels[NES_APU_DMC] + i), dmc));
+
+        pulse = _mm_div_ps(_mm_mul_ps(pulse_gain, pulse), _mm_add_ps(pulse_bias, _mm_mul_ps(hundred, pulse)));
+        tnd = _mm_div_ps(_mm_mul_ps(tnd_gain, tnd), _mm_add_ps(one, _mm_mul_ps(hundred, tnd)));
+
+        _mm_storeu_ps(output + i, _mm_add_ps(pulse, tnd));
+    }
+
+    const float *rest[NES_APU_CHANNELS];
+    for (unsigned int c = 0; c < NES_APU_CHANNELS; c++) {
+        rest[c] = channels[c] + i;
+    }
+
+    mix_scalar(rest, output + i, count - i);
+}
+
+__attribute__((target("sse2"))) static float
+dot_sse2(const float *samples, const float *taps)
+{
+    __m128 a, b;
+    a = _mm_setzero_ps();
+    b = _mm_setzero_ps();
+
+    for (unsigned int i = 0; i < RESAMPLER_TAPS; i += 8) {
+        a = _mm_add_ps(a, _mm_mul_ps(_mm_loadu_ps(samples + i), _mm_loadu_ps(taps + i)));
+        b = _mm_add_ps(b, _mm_mul_ps(_mm_loadu_ps(samples + i + 4), _mm_loadu_ps(taps + i + 4)));
+    }
+
+    a = _mm_add_ps(a, b);
+    a = _mm_add_ps(a, _mm_movehl_ps(a, a));
+    a = _mm_add_ss(a, _mm_shuffle_ps(a, a, 1));
+
+    return (_mm_cvtss_f32(a));
+}
+
+static const audio_kernels_t sse2 = {
+    "sse2", mix_sse2, dot_sse2
+};
+
+/**
+ * AVX2: eight samples per step.
+ */
+__attribute__((target("avx2"))) static void
+mix_avx2(const float *const *channels, float *output, size_t count)
+{
+    const __m256 pulse_gain = _mm256_set1_ps(PULSE_GAIN), pulse_bias = _mm256_set1_ps(PULSE_BIAS);
+    const __m256 tnd_gain = _mm256_set1_ps(TND_GAIN), hundred = _mm256_set1_ps(100.0f);
+    const __m256 one = _mm256_set1_ps(1.0f), triangle = _mm256_set1_ps(TRIANGLE_SCALE);
+    const __m256 noise = _mm256_set1_ps(NOISE_SCALE), dmc = _mm256_set1_ps(DMC_SCALE);
+
+    size_t i;
+    for (i = 0; i + 8 <= count; i += 8) {
+        __m256 pulse, tnd;
+        pulse = _mm256_add_ps(_mm256_loadu_ps(channels[NES_APU_PULSE1] + i),
+            _mm256_loadu_ps(channels[NES_APU_PULSE2] + i));
+        tnd = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(channels[NES_APU_TRIANGLE] + i), triangle),
+            _mm256_mul_ps(_mm256_loadu_ps(channels[NES_APU_NOISE] + i), noise)),
+            _mm256_mul_ps(_mm256_loadu_ps(channels[NES_APU_DMC] + i), dmc));
+
+        pulse = _mm256_div_ps(_mm256_mul_ps(pulse_gain, pulse),
+            _mm256_add_ps(pulse_bias, _mm256_mul_ps(hundred, pulse)));
+        tnd = _mm256_div_ps(_mm256_mul_ps(tnd_gain, tnd), _mm256_add_ps(one, _mm256_mul_ps(hundred, tnd)));
+
+        _mm256_storeu_ps(output + i, _mm256_add_ps(pulse, tnd));
+    }
+
+    const float *rest[NES_APU_CHANNELS];
+    for (unsigned int c = 0; c < NES_APU_CHANNELS; c++) {
+        rest[c] = channels[c] + i;
+    }
+
+    mix_scalar(rest, output + i, count - i);
+}
+
+__attribute__((target("avx2"))) static float
+dot_avx2(const float *samples, const float *taps)
+{
+    __m256 a, b;
+    a = _mm256_setzero_ps();
+    b = _mm256_setzero_ps();
+
+    for (unsigned int i = 0; i < RESAMPLER_TAPS; i += 16) {
+        a = _mm256_add_ps(a, _mm256_mul_ps(_mm256_loadu_ps(samples + i), _mm256_loadu_ps(taps + i)));
+        b = _mm256_add_ps(b, _mm256_mul_ps(_mm256_loadu_ps(samples + i + 8), _mm256_loadu_ps(taps + i + 8)));
+    }
+
+    a = _mm256_add_ps(a, b);
+
+    __m128 sum;
+    sum = _mm_add_ps(_mm256_castps256_ps128(a), _mm256_extractf128_ps(a, 1));
+    sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+    sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+
+    return (_mm_cvtss_f32(sum));
+}
+
+static const audio_kernels_t avx2 = {
+    "avx2", mix_avx2, dot_avx2
+};
+
+#endif // AUDIO_X86
+
+const audio_kernels_t *
+nes::audio_kernels(const char *name)
+{
+    const audio_kernels_t *supported[3];
+    size_t count = 0;
+
+#if defined(AUDIO_X86)
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("avx2")) {
+        supported[count++] = &avx2;
+    }
+
+    if (__builtin_cpu_supports("sse2")) {
+        supported[count++] = &sse2;
+    }
+#endif
+
+    supported[count++] = &scalar;
+
+    if (name == NULL) {
+        return (supported[0]);
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        if (strcmp(supported[i]->name, name) == 0) {
+            return (supported[i]);
+        }
+    }
+
+    return (NULL);
+}
+
+resampler_t::resampler_t(void)
+{
+    this->configure(NES_APU_RATE, NES_AUDIO_RATE);
+}
+
+/**
+ * A resampler at the rates of another, without its input. The filter
+ * is built again on the first read.
+ */
+resampler_t::resampler_t(const resampler_t &other)
+{
+    this->configure(other._input_rate, other._output_rate, other._kernels);
+    this->adjust(other._adjust);
+}
+
+/**
+ * Set up for a pair of rates. The filter is only built on the first
+ * read, instances that never produce audio do not pay for it.
+ */
+void
+resampler_t::configure(double input_rate, double output_rate, const audio_kernels_t *kernels)
+{
+    this->_kernels = kernels != NULL ? kernels : audio_kernels();
+    this->_input_rate = input_rate;
+    this->_output_rate = output_rate;
+    this->_adjust = 1.0;
+    this->_update_step();
+    this->_taps.clear();
+
+    this->clear();
+}
+
+/**
+ * A Blackman windowed sinc cut off below the lower of the two Nyquist
+ * rates, one set of taps per phase plus the closing one for the
+ * interpolation. Each phase sums to one.
+ */
+void
+resampler_t::_build_taps(void)
+{
+    double cutoff;
+    cutoff = 0.45 * min(1.0, this->_output_rate / this->_input_rate);
+
+    this->_taps.resize((RESAMPLER_PHASES + 1) * RESAMPLER_TAPS);
+
+    for (unsigned int p = 0; p <= RESAMPLER_PHASES; p++) {
+        float *taps;
+        taps = &this->_taps[p * RESAMPLER_TAPS];
+
+        double sum = 0;
+
+        for (unsigned int i = 0; i < RESAMPLER_TAPS; i++) {
+            double x, u, sinc, window;
+            x = (double)i - (RESAMPLER_TAPS / 2 - 1) - (double)p / RESAMPLER_PHASES;
+            u = (x + RESAMPLER_TAPS / 2) / RESAMPLER_TAPS;
+            sinc = x == 0 ? 1 : sin(2 * M_PI * cutoff * x) / (2 * M_PI * cutoff * x);
+            window = 0.42 - 0.5 * cos(2 * M_PI * u) + 0.08 * cos(4 * M_PI * u);
+
+            taps[i] = sinc * window;
+            sum += taps[i];
+        }
+
+        for (unsigned int i = 0; i < RESAMPLER_TAPS; i++) {
+            taps[i] /= sum;
+        }
+    }
+}
+
+/**
+ * Dynamic rate control: ratio above one makes more output from the
+ * same input, to fill a host buffer that runs low, and below one
+ * drains it. It is kept within half a percent so the pitch change
+ * stays inaudible.
+ */
+void
+resampler_t::adjust(double ratio)
+{
+    this->_adjust = min(max(ratio, 0.995), 1.005);
+    this->_update_step();
+}
+
+/**
+ * Drop all input, the history starts over as silence.
+ */
+void
+resampler_t::clear(void)
+{
+    this->_history.assign(RESAMPLER_TAPS, 0.0f);
+    this->_position = 0;
+}
+
+double
+resampler_t::output_rate(void) const
+{
+    return (this->_output_rate);
+}
+
+/**
+ * Output samples there will be to read after feeding another input
+ * samples.
+ */
+size_t
+resampler_t::available(size_t input) const
+{
+    uint64_t last;
+    last = (uint64_t)(this->_history.size() + input - RESAMPLER_TAPS) << 32;
+
+    if (this->_position > last) {
+        return (0);
+    }
+
+    return ((last - this->_position) / this->_step + 1);
+}
+
+/**
+ * Mix count samples of the channel streams into the history. Input the
+ * reader never caught up with is skipped beyond a second.
+ */
+void
+resampler_t::feed(const float *const *channels, size_t count)
+{
+    size_t size;
+    size = this->_history.size();
+
+    this->_history.resize(size + count);
+    this->_kernels->mix(channels, &this->_history[size], count);
+
+    size_t index, unread, limit;
+    index = min((size_t)(this->_position >> 32), this->_history.size());
+    unread = this->_history.size() - index;
+    limit = (size_t)this->_input_rate + RESAMPLER_TAPS;
+
+    if (unread > limit) {
+        this->_position += (uint64_t)(unread - limit) << 32;
+    }
+}
+
+/**
+ * Fill output with up to count samples, as many as the history allows.
+ * The consumed history is only compacted once it outgrows what is left,
+ * so small reads stay cheap, and never below one filter length: the
+ * history always holds RESAMPLER_TAPS samples, even when drained.
+ */
+size_t
+resampler_t::read(float *output, size_t count)
+{
+    if (this->_taps.empty()) {
+        this->_build_taps();
+    }
+
+    const float *history, *taps;
+    history = &this->_history[0];
+    taps = &this->_taps[0];
+
+    size_t limit;
+    limit = this->_history.size() - RESAMPLER_TAPS;
+
+    size_t produced;
+    for (produced = 0; produced < count; produced++) {
+        size_t index;
+        index = this->_position >> 32;
+
+        if (index > limit) {
+            break;
+        }
+
+        uint32_t fraction;
+        fraction = this->_position;
+
+        unsigned int phase;
+        phase = fraction >> (32 - RESAMPLER_PHASE_BITS);
+
+        float a, b, t;
+        a = this->_kernels->dot(history + index, taps + phase * RESAMPLER_TAPS);
+        b = this->_kernels->dot(history + index, taps + (phase + 1) * RESAMPLER_TAPS);
+        t = (fraction & ((1U << (32 - RESAMPLER_PHASE_BITS)) - 1)) *
+            (1.0f / (1U << (32 - RESAMPLER_PHASE_BITS)));
+
+        output[produced] = a + (b - a) * t;
+        this->_position += this->_step;
+    }
+
+    size_t index;
+    index = min((size_t)(this->_position >> 32), this->_history.size() - RESAMPLER_TAPS);
+
+    if (index * 2 >= this->_history.size()) {
+        this->_history.erase(this->_history.begin(), this->_history.begin() + index);
+        this->_position -= (uint64_t)index << 32;
+    }
+
+    return (produced);
+}
+
+/**
+ * Take everything the APU produced so far and fill output from it.
+ */
+size_t
+resampler_t::pull(apu_t &apu, float *output, size_t count)
+{
+    const float *channels[NES_APU_CHANNELS];
+    for (unsigned int i = 0; i < NES_APU_CHANNELS; i++) {
+        channels[i] = apu.stream(i);
+    }
+
+    size_t input;
+    input = apu.available();
+
+    this->feed(channels, input);
+    apu.consume(input);
+
+    return (this->read(output, count));
+}
+
+void
+resampler_t::_update_step(void)
+{
+    this->_step = (uint64_t)(this->_input_rate / (this->_output_rate * this->_adjust) * 4294967296.0);
+}
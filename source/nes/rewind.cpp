@@ -0,0 +1,340 @@
+/**
+ * Copyright (c) 2009 Roy van Dam <roy@8bit.cx>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include <string.h>
+
+#include <algorithm>
+using namespace std;
+
+#include "nes/rewind.hpp"
+using namespace nes;
+
+rewind_t::rewind_t(void)
+{
+    this->_tail = 0;
+    this->_stored = 0;
+    this->_interval = NES_REWIND_KEYFRAMES;
+    this->_count = 0;
+}
+
+/**
+ * Keep up to budget bytes of compressed history with a keyframe every
+ * interval snapshots, a budget of zero turns rewinding off.
+ */
+void
+rewind_t::configure(size_t budget, unsigned int interval)
+{
+    vector<uint8_t>(budget).swap(this->_buffer);
+    this->_interval = max(interval, 1U);
+    this->clear();
+}
+
+void
+rewind_t::clear(void)
+{
+    this->_snapshots.clear();
+    this->_tail = 0;
+    this->_stored = 0;
+    this->_count = 0;
+}
+
+/**
+ * Take the snapshot of a frame. A delta whose keyframe had to make room
+ * for it is stored as the keyframe of a new group instead.
+ */
+void
+rewind_t::capture(unsigned long frame, const uint8_t *state, size_t size)
+{
+    if (!this->enabled()) {
+        return;
+    }
+
+    this->_encoded.resize(size * 3 + 16);
+
+    if (this->_count > 0 && this->_keyframe.size() == size) {
+        size_t length;
+        length = _encode(state, &this->_keyframe[0], size, &this->_encoded[0]);
+
+        if (this->_store(frame, false, length)) {
+            this->_count = (this->_count + 1) % this->_interval;
+            return;
+        }
+    }
+
+    this->_keyframe.assign(state, state + size);
+    this->_zeros.assign(size, 0);
+
+    size_t length;
+    length = _encode(state, &this->_zeros[0], size, &this->_encoded[0]);
+
+    if (this->_store(frame, true, length)) {
+        this->_count = 1 % this->_interval;
+    }
+}
+
+/**
+ * Restore the latest snapshot at or before a frame into state, or the
+ * oldest one when the history does not reach back that far, and drop
+ * the history after it. Returns its frame, or -1 without history.
+ */
+long
+rewind_t::seek(unsigned long frame, uint8_t *state, size_t size)
+{
+    if (this->_snapshots.empty() || this->_keyframe.size() != size) {
+        return (-1);
+    }
+
+    deque<snapshot_t>::iterator snapshot;
+    snapshot = upper_bound(this->_snapshots.begin(), this->_snapshots.end(), frame, _before);
+
+    if (snapshot != this->_snapshots.begin()) {
+        --snapshot;
+    }
+
+    deque<snapshot_t>::iterator keyframe;
+    for (keyframe = snapshot; !keyframe->keyframe; --keyframe);
+
+    memset(state, 0, size);
+    _apply(&this->_buffer[keyframe->offset], keyframe->size, state);
+
+    if (snapshot != keyframe) {
+        _apply(&this->_buffer[snapshot->offset], snapshot->size, state);
+    }
+
+    for (deque<snapshot_t>::iterator i = snapshot + 1; i != this->_snapshots.end(); ++i) {
+        this->_stored -= i->size;
+    }
+
+    this->_snapshots.erase(snapshot + 1, this->_snapshots.end());
+
+    const snapshot_t &last = this->_snapshots.back();
+    this->_tail = last.offset + last.size;
+    this->_count = 0;
+
+    return (last.frame);
+}
+
+rewind_stats_t
+rewind_t::stats(void) const
+{
+    rewind_stats_t stats = rewind_stats_t();
+
+    stats.snapshots = this->_snapshots.size();
+    stats.raw_bytes = stats.snapshots * this->_keyframe.size();
+    stats.stored_bytes = this->_stored;
+    stats.ratio = this->_stored > 0 ? (double)stats.raw_bytes / this->_stored : 0;
+
+    deque<snapshot_t>::const_iterator snapshot;
+    for (snapshot = this->_snapshots.begin(); snapshot != this->_snapshots.end(); ++snapshot) {
+        stats.keyframes += snapshot->keyframe;
+    }
+
+    if (!this->_snapshots.empty()) {
+        stats.frames = this->_snapshots.back().frame - this->_snapshots.front().frame;
+    }
+
+    return (stats);
+}
+
+/**
+ * Append a snapshot at the tail of the ring, wrapping around when it
+ * does not fit before the end and dropping the oldest groups it runs
+ * into. Wrapping first drops the groups still between the tail and the
+ * end of the buffer, they are the oldest and the write starts over them
+ * from the front. Fails for a delta that lost its own keyframe that way.
+ */
+bool
+rewind_t::_store(unsigned long frame, bool keyframe, size_t size)
+{
+    if (size > this->_buffer.size()) {
+        this->clear();
+        return (false);
+    }
+
+    if (this->_tail + size > this->_buffer.size()) {
+        while (!this->_snapshots.empty() && this->_snapshots.front().offset >= this->_tail) {
+            this->_drop_group();
+        }
+
+        this->_tail = 0;
+    }
+
+    while (!this->_snapshots.empty()) {
+        const snapshot_t &oldest = this->_snapshots.front();
+
+        if (oldest.offset >= this->_tail + size || oldest.offset + oldest.size <= this->_tail) {
+            break;
+        }
+
+        this->_drop_group();
+    }
+
+    if (!keyframe && this->_snapshots.empty()) {
+        return (false);
+    }
+
+    memcpy(&this->_buffer[this->_tail], &this->_encoded[0], size);
+
+    snapshot_t snapshot = { frame, this->_tail, size, keyframe };
+    this->_snapshots.push_back(snapshot);
+
+    this->_tail += size;
+    this->_stored += size;
+
+    return (true);
+}
+
+bool
+rewind_t::_before(unsigned long frame, const snapshot_t &snapshot)
+{
+    return (frame < snapshot.frame);
+}
+
+/**
+ * Drop the oldest keyframe with the deltas that depend on it.
+ */
+void
+rewind_t::_drop_group(void)
+{
+    do {
+        this->_stored -= this->_snapshots.front().size;
+        this->_snapshots.pop_front();
+    } while (!this->_snapshots.empty() && !this->_snapshots.front().keyframe);
+}
+
+static inline uint8_t *
+put_varint(uint8_t *output, size_t value)
+{
+    while (value >= 0x80) {
+        *output++ = value | 0x80;
+        value >>= 7;
+    }
+
+    *output++ = value;
+    return (output);
+}
+
+static inline const uint8_t *
+get_varint(const uint8_t *input, size_t &value)
+{
+    unsigned int shift;
+
+    for (value = 0, shift = 0; *input & 0x80; shift += 7) {
+        value |= (size_t)(*input++ & 0x7f) << shift;
+    }
+
+    value |= (size_t)*input++ << shift;
+    return (input);
+}
+
+static inline uint64_t
+load_word(const uint8_t *data)
+{
+    uint64_t word;
+    memcpy(&word, data, sizeof word);
+
+    return (word);
+}
+
+/**
+ * Run-length code state XORed with reference: a varint count of bytes
+ * to skip, a varint count of bytes that follow, then those bytes, over
+ * and over. Unchanged stretches are skipped a word at a time, and a
+ * literal run only ends at four unchanged bytes since shorter gaps cost
+ * as much to encode as to store. Trailing unchanged bytes are implied.
+ * The output takes at most 2.5 times the input plus a few bytes.
+ */
+size_t
+rewind_t::_encode(const uint8_t *state, const uint8_t *reference, size_t size, uint8_t *output)
+{
+    uint8_t *start;
+    start = output;
+
+    size_t i;
+    i = 0;
+
+    while (i < size) {
+        size_t skip;
+        skip = i;
+
+        while (i + 8 <= size && load_word(state + i) == load_word(reference + i)) {
+            i += 8;
+        }
+
+        while (i < size && state[i] == reference[i]) {
+            i++;
+        }
+
+        if (i == size) {
+            break;
+        }
+
+        skip = i - skip;
+
+        size_t literal, same;
+        literal = i;
+
+        for (same = 0; i < size && same < 4; i++) {
+            same = state[i] == reference[i] ? same + 1 : 0;
+        }
+
+        i -= same;
+
+        output = put_varint(output, skip);
+        output = put_varint(output, i - literal);
+
+        for (size_t j = literal; j < i; j++) {
+            *output++ = state[j] ^ reference[j];
+        }
+    }
+
+    return (output - start);
+}
+
+/**
+ * XOR an encoded snapshot into state.
+ */
+void
+rewind_t::_apply(const uint8_t *input, size_t length, uint8_t *state)
+{
+    const uint8_t *end;
+    end = input + length;
+
+    while (input < end) {
+        size_t skip, count;
+        input = get_varint(input, skip);
+        input = get_varint(input, count);
+
+        state += skip;
+
+        for (size_t i = 0; i < count; i++) {
+            state[i] ^= input[i];
+        }
+
+        state += count;
+        input += count;
+    }
+}
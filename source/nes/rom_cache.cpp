@@ -0,0 +1,311 @@
+/**
+ * Copyright (c) 2009 Roy van Dam <roy@8bit.cx>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <map>
+#include <mutex>
+#include <tuple>
+#include <vector>
+using namespace std;
+
+#include "nes/rom_cache.hpp"
+using namespace nes;
+
+/**
+ * Identity of a file on disk: device, inode, size and modification
+ * time in nanoseconds.
+ */
+typedef tuple<dev_t, ino_t, off_t, int64_t> rom_file_t;
+
+static mutex                            rom_lock;
+static multimap<uint64_t, rom_image_t *> rom_images;
+static map<rom_file_t, rom_image_t *>   rom_files;
+static bool                             rom_hugepages;
+static unsigned long                    rom_hits;
+static unsigned long                    rom_misses;
+
+static uint64_t
+fnv1a(const uint8_t *data, size_t size)
+{
+    uint64_t hash;
+    hash = 0xcbf29ce484222325ULL;
+
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ data[i]) * 0x100000001b3ULL;
+    }
+
+    return (hash);
+}
+
+static size_t
+page_round(size_t size, size_t page)
+{
+    return ((size + page - 1) & ~(page - 1));
+}
+
+/**
+ * Copy an image into anonymous memory on huge pages, reserved ones
+ * when there are any and transparent ones otherwise. The transparent
+ * mapping is trimmed to a huge page boundary so the kernel can
+ * actually back it with one.
+ */
+static uint8_t *
+huge_copy(const uint8_t *data, size_t size, size_t &mapped)
+{
+    void *copy;
+    mapped = page_round(size, NES_HUGE_PAGE);
+
+    copy = mmap(NULL, mapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+
+    if (copy == MAP_FAILED) {
+        uint8_t *area;
+        area = (uint8_t *)mmap(NULL, mapped + NES_HUGE_PAGE, PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+        if (area == MAP_FAILED) {
+            return (NULL);
+        }
+
+        uint8_t *aligned;
+        aligned = (uint8_t *)page_round((uintptr_t)area, NES_HUGE_PAGE);
+
+        if (aligned > area) {
+            munmap(area, aligned - area);
+        }
+
+        munmap(aligned + mapped, area + NES_HUGE_PAGE - aligned);
+        madvise(aligned, mapped, MADV_HUGEPAGE);
+
+        copy = aligned;
+    }
+
+    memcpy(copy, data, size);
+    mprotect(copy, mapped, PROT_READ);
+
+    return ((uint8_t *)copy);
+}
+
+/**
+ * Take a reference to the image of a file, mapping and hashing it only
+ * when the file was not seen before.
+ */
+rom_image_t *
+nes::rom_acquire(const std::string &filename)
+{
+    int fd;
+    struct stat st;
+
+    if ((fd = open(filename.c_str(), O_RDONLY)) < 0) {
+        perror("open");
+        return (NULL);
+    }
+
+    if (fstat(fd, &st) == -1) {
+        perror("fstat");
+        close(fd);
+        return (NULL);
+    }
+
+    if (st.st_size == 0) {
+        fprintf(stderr, "%s: Empty file\n", filename.c_str());
+        close(fd);
+        return (NULL);
+    }
+
+    rom_file_t file;
+    file = rom_file_t(st.st_dev, st.st_ino, st.st_size,
+        (int64_t)st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec);
+
+    {
+        lock_guard<mutex> guard(rom_lock);
+        map<rom_file_t, rom_image_t *>::iterator known;
+
+        if ((known = rom_files.find(file)) != rom_files.end()) {
+            known->second->references++;
+            rom_hits++;
+
+            close(fd);
+            return (known->second);
+        }
+    }
+
+    uint8_t *data;
+    data = (uint8_t *)mmap(NULL, st.st_size, PROT_READ, MAP_FILE | MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (data == MAP_FAILED) {
+        perror("mmap");
+        return (NULL);
+    }
+
+    // Hashing reads it all, let the kernel read ahead for it.
+    madvise(data, st.st_size, MADV_WILLNEED);
+
+    size_t size, mapped;
+    size = st.st_size;
+    mapped = page_round(size, sysconf(_SC_PAGESIZE));
+
+    uint64_t hash;
+    hash = fnv1a(data, size);
+
+    lock_guard<mutex> guard(rom_lock);
+    pair<multimap<uint64_t, rom_image_t *>::iterator, multimap<uint64_t, rom_image_t *>::iterator> range;
+    range = rom_images.equal_range(hash);
+
+    for (; range.first != range.second; ++range.first) {
+        rom_image_t *image;
+        image = range.first->second;
+
+        if (image->size == size && memcmp(image->data, data, size) == 0) {
+            image->references++;
+            rom_files[file] = image;
+            rom_hits++;
+
+            munmap(data, mapped);
+            return (image);
+        }
+    }
+
+    bool huge = false;
+
+    if (rom_hugepages) {
+        uint8_t *copy;
+        size_t length;
+
+        if ((copy = huge_copy(data, size, length)) != NULL) {
+            munmap(data, mapped);
+
+            data = copy;
+            mapped = length;
+            huge = true;
+        }
+    }
+
+    rom_image_t *image = new rom_image_t();
+    image->data = data;
+    image->size = size;
+    image->mapped = mapped;
+    image->hash = hash;
+    image->huge = huge;
+    image->references = 1;
+
+    rom_images.insert(make_pair(hash, image));
+    rom_files[file] = image;
+    rom_misses++;
+
+    return (image);
+}
+
+/**
+ * Another reference for a holder of one, no lookup needed.
+ */
+void
+nes::rom_retain(rom_image_t *image)
+{
+    image->references++;
+}
+
+void
+nes::rom_release(rom_image_t *image)
+{
+    lock_guard<mutex> guard(rom_lock);
+
+    if (--image->references != 0) {
+        return;
+    }
+
+    multimap<uint64_t, rom_image_t *>::iterator entry;
+    entry = rom_images.lower_bound(image->hash);
+
+    while (entry->second != image) {
+        ++entry;
+    }
+
+    rom_images.erase(entry);
+
+    for (map<rom_file_t, rom_image_t *>::iterator file = rom_files.begin(); file != rom_files.end();) {
+        if (file->second == image) {
+            rom_files.erase(file++);
+        } else {
+            ++file;
+        }
+    }
+
+    munmap(image->data, image->mapped);
+    delete image;
+}
+
+/**
+ * Copy images loaded from now on to huge pages.
+ */
+void
+nes::rom_set_hugepages(bool enable)
+{
+    lock_guard<mutex> guard(rom_lock);
+    rom_hugepages = enable;
+}
+
+rom_cache_stats_t
+nes::rom_cache_stats(void)
+{
+    lock_guard<mutex> guard(rom_lock);
+
+    rom_cache_stats_t stats = rom_cache_stats_t();
+    stats.hits = rom_hits;
+    stats.misses = rom_misses;
+
+    size_t page;
+    page = sysconf(_SC_PAGESIZE);
+
+    vector<unsigned char> residency;
+    multimap<uint64_t, rom_image_t *>::iterator entry;
+
+    for (entry = rom_images.begin(); entry != rom_images.end(); ++entry) {
+        rom_image_t *image;
+        image = entry->second;
+
+        stats.images++;
+        stats.references += image->references;
+        stats.mapped_bytes += image->mapped;
+
+        residency.resize(image->mapped / page);
+
+        if (mincore(image->data, image->mapped, &residency[0]) == 0) {
+            for (size_t i = 0; i < residency.size(); i++) {
+                stats.resident_bytes += (residency[i] & 1) * page;
+            }
+        }
+    }
+
+    return (stats);
+}
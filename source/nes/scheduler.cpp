@@ -0,0 +1,178 @@
+/**
+ * Copyright (c) 2009 Roy van Dam <roy@8bit.cx>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include "nes/scheduler.hpp"
+using namespace nes;
+
+int
+scheduler_t::add(event_handler_t *handler)
+{
+    slot_t slot;
+
+    slot.handler = handler;
+    slot.deadline = 0;
+    slot.position = -1;
+
+    this->_slots.push_back(slot);
+    return (this->_slots.size() - 1);
+}
+
+/**
+ * Hand an event over to another handler, the copy of its device in a
+ * copy of the scheduler.
+ */
+void
+scheduler_t::rebind(int event, event_handler_t *handler)
+{
+    this->_slots[event].handler = handler;
+}
+
+void
+scheduler_t::schedule(int event, uint64_t deadline)
+{
+    slot_t &slot = this->_slots[event];
+
+    if (slot.position < 0) {
+        this->_heap.push_back(event);
+        slot.position = this->_heap.size() - 1;
+    }
+
+    slot.deadline = deadline;
+    this->_sift_up(slot.position);
+    this->_sift_down(slot.position);
+}
+
+void
+scheduler_t::cancel(int event)
+{
+    if (this->_slots[event].position >= 0) {
+        this->_remove(event);
+    }
+}
+
+bool
+scheduler_t::pending(int event) const
+{
+    return (this->_slots[event].position >= 0);
+}
+
+/**
+ * Fire every event that is due at the given cycle, earliest first. A
+ * handler may schedule itself or any other event again, events that
+ * become due by that are fired within the same call.
+ */
+void
+scheduler_t::run(uint64_t now)
+{
+    while (!this->_heap.empty()) {
+        int event;
+        event = this->_heap[0];
+
+        slot_t &slot = this->_slots[event];
+        if (slot.deadline > now) {
+            break;
+        }
+
+        this->_remove(event);
+        slot.handler->event(slot.deadline);
+    }
+}
+
+void
+scheduler_t::_place(int position, int event)
+{
+    this->_heap[position] = event;
+    this->_slots[event].position = position;
+}
+
+void
+scheduler_t::_sift_up(int position)
+{
+    int event;
+    event = this->_heap[position];
+
+    while (position > 0) {
+        int parent;
+        parent = (position - 1) / 2;
+
+        if (this->_slots[this->_heap[parent]].deadline <= this->_slots[event].deadline) {
+            break;
+        }
+
+        this->_place(position, this->_heap[parent]);
+        position = parent;
+    }
+
+    this->_place(position, event);
+}
+
+void
+scheduler_t::_sift_down(int position)
+{
+    int event, size;
+    event = this->_heap[position];
+    size = this->_heap.size();
+
+    for (;;) {
+        int child;
+        child = 2 * position + 1;
+
+        if (child >= size) {
+            break;
+        }
+
+        if (child + 1 < size &&
+            this->_slots[this->_heap[child + 1]].deadline < this->_slots[this->_heap[child]].deadline) {
+            child++;
+        }
+
+        if (this->_slots[event].deadline <= this->_slots[this->_heap[child]].deadline) {
+            break;
+        }
+
+        this->_place(position, this->_heap[child]);
+        position = child;
+    }
+
+    this->_place(position, event);
+}
+
+void
+scheduler_t::_remove(int event)
+{
+    int position, last;
+    position = this->_slots[event].position;
+    last = this->_heap.back();
+
+    this->_heap.pop_back();
+    this->_slots[event].position = -1;
+
+    if (last != event) {
+        this->_place(position, last);
+        this->_sift_up(position);
+        this->_sift_down(this->_slots[last].position);
+    }
+}
@@ -0,0 +1,289 @@
+/**
+ * Copyright (c) 2009 Roy van Dam <roy@8bit.cx>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <thread>
+
+#include "trace.hpp"
+
+#define TRACE_RING_SIZE     (1 << 14)
+#define TRACE_RING_MASK     (TRACE_RING_SIZE - 1)
+
+uint8_t trace_levels[TRACE_CATEGORIES];
+
+static const char * const trace_names[TRACE_CATEGORIES] = {
+    "cpu",
+    "memory",
+    "stack",
+    "interrupt",
+    "mapper",
+};
+
+/**
+ * Bounded multi-producer ring buffer. Every slot carries a sequence
+ * number that tells producers and the drain thread whose turn it is,
+ * so neither side ever takes a lock. Producers never wait either: a
+ * record that finds the ring full is dropped and counted.
+ */
+struct trace_slot_t
+{
+    std::atomic<size_t>     sequence;
+    trace_record_t          record;
+};
+
+static trace_slot_t         trace_ring[TRACE_RING_SIZE];
+static std::atomic<size_t>  trace_head;
+static size_t               trace_tail;
+static std::atomic<unsigned long> trace_dropped;
+
+static std::thread          trace_thread;
+static std::atomic<bool>    trace_running;
+
+void
+trace_push(const trace_record_t &record)
+{
+    trace_slot_t *slot;
+    size_t position;
+
+    position = trace_head.load(std::memory_order_relaxed);
+
+    for (;;) {
+        slot = &trace_ring[position & TRACE_RING_MASK];
+
+        intptr_t distance;
+        distance = (intptr_t)slot->sequence.load(std::memory_order_acquire) - (intptr_t)position;
+
+        if (distance == 0) {
+            if (trace_head.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (distance < 0) {
+            trace_dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        } else {
+            position = trace_head.load(std::memory_order_relaxed);
+        }
+    }
+
+    slot->record = record;
+    slot->sequence.store(position + 1, std::memory_order_release);
+}
+
+static bool
+trace_pop(trace_record_t &record)
+{
+    trace_slot_t *slot;
+    slot = &trace_ring[trace_tail & TRACE_RING_MASK];
+
+    if (slot->sequence.load(std::memory_order_acquire) != trace_tail + 1) {
+        return (false);
+    }
+
+    record = slot->record;
+    slot->sequence.store(trace_tail + TRACE_RING_SIZE, std::memory_order_release);
+    trace_tail++;
+
+    return (true);
+}
+
+/**
+ * Expand a record one conversion at a time, handing each argument to
+ * fprintf as the type its conversion expects rather than as the
+ * uintptr_t it was stored as. Short integers are promoted to int in
+ * varargs anyway, so only long, long long and size_t need their own
+ * type; strings and pointers are cast back.
+ */
+static void
+trace_format(const trace_record_t &record)
+{
+    const char *format;
+    format = record.format;
+
+    unsigned int index = 0;
+
+    while (*format != '\0') {
+        if (format[0] != '%' || format[1] == '%') {
+            fputc(format[0], stderr);
+            format += format[0] == '%' ? 2 : 1;
+            continue;
+        }
+
+        size_t length;
+        length = strcspn(format + 1, "csdiouxXp") + 2;
+
+        char spec[32];
+
+        if (format[length - 1] == '\0' || length >= sizeof spec) {
+            fputs(format, stderr);
+            break;
+        }
+
+        memcpy(spec, format, length);
+        spec[length] = '\0';
+        format += length;
+
+        uintptr_t value;
+        value = index < TRACE_ARGS ? record.args[index++] : 0;
+
+        char conversion, modifier;
+        conversion = spec[length - 1];
+        modifier = spec[length - 2];
+
+        bool is_signed;
+        is_signed = conversion == 'd' || conversion == 'i' || conversion == 'c';
+
+        if (conversion == 's') {
+            fprintf(stderr, spec, (const char *)value);
+        } else if (conversion == 'p') {
+            fprintf(stderr, spec, (void *)value);
+        } else if (modifier == 'l' && spec[length - 3] == 'l') {
+            if (is_signed) {
+                fprintf(stderr, spec, (long long)value);
+            } else {
+                fprintf(stderr, spec, (unsigned long long)value);
+            }
+        } else if (modifier == 'l') {
+            if (is_signed) {
+                fprintf(stderr, spec, (long)value);
+            } else {
+                fprintf(stderr, spec, (unsigned long)value);
+            }
+        } else if (modifier == 'z') {
+            fprintf(stderr, spec, (size_t)value);
+        } else if (is_signed) {
+            fprintf(stderr, spec, (int)value);
+        } else {
+            fprintf(stderr, spec, (unsigned int)value);
+        }
+    }
+}
+
+static void
+trace_drain(void)
+{
+    trace_record_t record;
+
+    while (trace_pop(record)) {
+        fprintf(stderr, "[%s] ", trace_names[record.category]);
+        trace_format(record);
+    }
+}
+
+static void
+trace_main(void)
+{
+    while (trace_running.load(std::memory_order_acquire)) {
+        trace_drain();
+        usleep(1000);
+    }
+}
+
+/**
+ * Stop the drain thread and write out whatever is left in the ring.
+ */
+void
+trace_flush(void)
+{
+    if (trace_running.exchange(false)) {
+        trace_thread.join();
+    }
+
+    trace_drain();
+
+    unsigned long dropped;
+    dropped = trace_dropped.exchange(0);
+
+    if (dropped > 0) {
+        fprintf(stderr, "Trace: %lu records dropped\n", dropped);
+    }
+}
+
+/**
+ * Parse a comma separated list of category[:level] and start the drain
+ * thread. The category "all" sets every category, the level defaults
+ * to TRACE_VERBOSE.
+ */
+int
+trace_configure(const char *spec)
+{
+#if !defined(WITH_TRACE)
+    fprintf(stderr, "Tracing is not compiled in\n");
+    return (1);
+#endif
+
+    uint8_t levels[TRACE_CATEGORIES];
+    memcpy(levels, trace_levels, sizeof levels);
+
+    char *copy, *token, *state;
+    copy = strdup(spec);
+
+    for (token = strtok_r(copy, ",", &state); token != NULL; token = strtok_r(NULL, ",", &state)) {
+        char *separator;
+        int level, category;
+
+        level = TRACE_VERBOSE;
+        if ((separator = strchr(token, ':')) != NULL) {
+            *separator = '\0';
+            level = atoi(separator + 1);
+        }
+
+        for (category = 0; category < TRACE_CATEGORIES; category++) {
+            if (strcmp(token, "all") == 0 || strcmp(token, trace_names[category]) == 0) {
+                levels[category] = level;
+                if (strcmp(token, "all") != 0) {
+                    break;
+                }
+            }
+        }
+
+        if (category == TRACE_CATEGORIES && strcmp(token, "all") != 0) {
+            fprintf(stderr, "Unknown trace category: %s\n", token);
+            free(copy);
+            return (1);
+        }
+    }
+
+    free(copy);
+
+    if (!trace_running.exchange(true)) {
+        for (size_t i = 0; i < TRACE_RING_SIZE; i++) {
+            trace_ring[i].sequence.store(i, std::memory_order_relaxed);
+        }
+
+        trace_head.store(0);
+        trace_tail = 0;
+        trace_thread = std::thread(trace_main);
+        atexit(trace_flush);
+    }
+
+    memcpy(trace_levels, levels, sizeof trace_levels);
+    return (0);
+}